@@ -0,0 +1,121 @@
+// File: arena.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the arena allocator. Blocks are linked newest first and only the
+ * newest one is allocated from; a request that does not fit in the rest of it starts a
+ * new block. Requests larger than a quarter of a block get a block of their own, which
+ * is linked behind the newest block so that the space left in it is not wasted.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "defines.h"
+#include "arena.h"
+
+#define ARENA_BLOCKSIZE 65536
+#define ARENA_ALIGNMENT 8
+
+void init_arena(arena_t *arena) {
+        arena->blocks = NULL;
+        arena->adoptions = NULL;
+        arena->nbytes_reserved = 0;
+}
+
+void *reserve_inarena(arena_t *arena, size_t size) {
+        arenablock_t *block;
+        size_t block_size;
+        void *memory;
+
+        size = (size + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+
+        block = arena->blocks;
+        if(size > ARENA_BLOCKSIZE / 4 && block != NULL) {
+                block = malloc(sizeof(*block) + size);
+                if(block == NULL)
+                        return NULL;
+                block->size = block->used = size;
+                block->next = arena->blocks->next;
+                arena->blocks->next = block;
+                arena->nbytes_reserved += size;
+                return block->data;
+        }
+
+        if(block == NULL || block->size - block->used < size) {
+                block_size = (size > ARENA_BLOCKSIZE) ? size : ARENA_BLOCKSIZE;
+                block = malloc(sizeof(*block) + block_size);
+                if(block == NULL)
+                        return NULL;
+                block->size = block_size;
+                block->used = 0;
+                block->next = arena->blocks;
+                arena->blocks = block;
+        }
+
+        memory = block->data + block->used;
+        block->used += size;
+        arena->nbytes_reserved += size;
+
+        return memory;
+}
+
+char *storein_arena(arena_t *arena, const char *string) {
+        size_t size;
+        char *copy;
+
+        size = strlen(string) + 1;
+        copy = reserve_inarena(arena, size);
+        if(copy != NULL)
+                memcpy(copy, string, size);
+
+        return copy;
+}
+
+/* Makes memory obtained from malloc part of the arena, so that it is freed together
+   with the arena. */
+status_t adopt_inarena(arena_t *arena, void *memory) {
+        arenaadoption_t *adoption;
+
+        adoption = reserve_inarena(arena, sizeof(*adoption));
+        if(adoption == NULL)
+                return ERROR;
+        adoption->memory = memory;
+        adoption->next = arena->adoptions;
+        arena->adoptions = adoption;
+
+        return NO_ERROR;
+}
+
+void free_arena(arena_t *arena) {
+        arenablock_t *block, *next;
+        arenaadoption_t *adoption;
+
+        for(adoption = arena->adoptions; adoption != NULL; adoption = adoption->next)
+                free(adoption->memory);
+
+        for(block = arena->blocks; block != NULL; block = next) {
+                next = block->next;
+                free(block);
+        }
+
+        init_arena(arena);
+}
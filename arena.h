@@ -0,0 +1,64 @@
+// File: arena.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the arena that holds the names and records made while assembling
+ * a source file. Allocations are carved out of large blocks and are never released one
+ * at a time; the whole arena is released at once when assembly is done. Memory that had
+ * to be grown with realloc can be handed over to the arena once it has its final size.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include "defines.h"
+
+typedef struct arenablock_t {
+        struct arenablock_t *next;
+        size_t size;
+        size_t used;
+        unsigned char data[];
+} arenablock_t;
+
+typedef struct arenaadoption_t {
+        struct arenaadoption_t *next;
+        void *memory;
+} arenaadoption_t;
+
+typedef struct arena_t {
+        arenablock_t *blocks;
+        arenaadoption_t *adoptions;
+        size_t nbytes_reserved;
+} arena_t;
+
+void init_arena(arena_t *arena);
+
+void *reserve_inarena(arena_t *arena, size_t size);
+
+char *storein_arena(arena_t *arena, const char *string);
+
+status_t adopt_inarena(arena_t *arena, void *memory);
+
+void free_arena(arena_t *arena);
+
+#endif
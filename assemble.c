@@ -19,23 +19,60 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "defines.h"
 #include "assemble.h"
+#include "stats.h"
+#include "lexer.h"
+#include "task.h"
+#include "parse.h"
+#include "intern.h"
+#include "expr.h"
+#include "image.h"
+#include "source.h"
+#include "object.h"
 
-void assemble_instruction(FILE *infile_handle, FILE *outfile_handle,  char *instruction,
+/* Takes a two-byte value as a byte, down to -128 as for DB. */
+static void narrow_operand(const tokenrange_t *operand, uint8_t *operand_valuelength,
+                           const uint8_t operand_value[]) {
+        uint16_t value;
+
+        value = operand_value[0] | (operand_value[1] << 8);
+        if(value > 0xFF && value < 0xFF80) {
+                STDERR("line %u: the operand does not fit in a byte\n",
+                       operand->tokens[0].line);
+                EFAILURE;
+        }
+        *operand_valuelength = 1;
+}
+
+void assemble_instruction(tokenstream_t *tokenstream, outputimage_t *outputimage,
+                          atom_t instruction,
                           instruction_parameters_t **instruction_set,
                           symboltable_t *symboltable_list,
-                          uint8_t symboltable_currentsize, line_status_t *line_status,
-                          uint16_t *current_address, uint16_t *beginning_address,
-                          uint16_t *previous_address) {
-        char operand1[20], operand2[20];
+                          uint32_t symboltable_currentsize, line_status_t *line_status,
+                          uint16_t *current_address) {
+        tokenrange_t operand1, operand2;
         uint8_t operand1_type, operand2_type;
         uint8_t n_operands;
         uint8_t operand1_valuelength, operand2_valuelength,
                 operand1_value[2], operand2_value[2];
+        uint8_t form1_type, form2_type;
+        int index1, index2;
+        const token_t *statement;
 
-        extract_operands(infile_handle, operand1, operand2, line_status, &n_operands);
+        statement = &tokenstream->tokens[tokenstream->position - 1];
+
+        /* As in the first pass, the operands are only extracted when the instruction
+           is not the last word on its line; otherwise the next line would be taken as
+           the operands of an instruction that does not have any. */
+        if(*line_status == ENDOFFILE_DETECTED || *line_status == COMMNTDELIM_DETECTED ||
+           *line_status == NEWLINE_DETECTED || *line_status == CARRIAGERETURN_DETECTED)
+                n_operands = 0;
+        else
+                extract_operands(tokenstream, &operand1, &operand2, line_status,
+                                 &n_operands);
 
         if(n_operands == 0) {
                 operand1_type = NONE;
@@ -46,120 +83,119 @@ void assemble_instruction(FILE *infile_handle, FILE *outfile_handle,  char *inst
                 operand2_value[0] = operand2_value[1] = 0;
         }
         else if(n_operands == 1) {
-                retrieve_opcharac(operand1, &operand1_type, &operand1_valuelength,
-                                  operand1_value, symboltable_list,
+                retrieve_opcharac(&operand1, &operand1_type, &operand1_valuelength,
+                                  operand1_value, *current_address, symboltable_list,
                                   symboltable_currentsize);
+                tag_relocations(OP1);
                 operand2_type = NONE;
                 operand2_valuelength = 0;
                 operand2_value[0] = operand2_value[1] = 0;
         }
         else {
-                retrieve_opcharac(operand1, &operand1_type, &operand1_valuelength,
-                                  operand1_value, symboltable_list,
+                retrieve_opcharac(&operand1, &operand1_type, &operand1_valuelength,
+                                  operand1_value, *current_address, symboltable_list,
                                   symboltable_currentsize);
-                retrieve_opcharac(operand2, &operand2_type, &operand2_valuelength,
-                                  operand2_value, symboltable_list,
+                tag_relocations(OP1);
+                retrieve_opcharac(&operand2, &operand2_type, &operand2_valuelength,
+                                  operand2_value, *current_address, symboltable_list,
                                   symboltable_currentsize);
+                tag_relocations(OP2);
         }
 
-        assemble(outfile_handle, instruction_set, instruction, operand1_type,
-                 operand2_type, operand1_valuelength, operand2_valuelength, operand1_value,
-                 operand2_value, current_address, beginning_address, previous_address);
+        /* The form is found as the first pass found it, which may take a two-byte
+           value as a byte. */
+        form1_type = operand1_type;
+        form2_type = operand2_type;
+        find_instructionform(instruction, instruction_set, &form1_type, &form2_type,
+                             &index1, &index2);
+        if(form1_type != operand1_type)
+                narrow_operand(&operand1, &operand1_valuelength, operand1_value);
+        if(form2_type != operand2_type)
+                narrow_operand(&operand2, &operand2_valuelength, operand2_value);
+
+        assemble(outputimage, instruction_set, instruction, form1_type,
+                 form2_type, operand1_valuelength, operand2_valuelength, operand1_value,
+                 operand2_value, current_address, statement);
 }
 
 
-void retrieve_opcharac(char *operand, uint8_t *operand_type, uint8_t *operand_valuelength,
-                       uint8_t operand_value[], symboltable_t *symboltable_list,
-                       uint8_t symboltable_currentsize) {
-        int index, i, boundary, index2;
-        uint8_t value_toconvert[20];
+void retrieve_opcharac(const tokenrange_t *operand, uint8_t *operand_type,
+                       uint8_t *operand_valuelength, uint8_t operand_value[],
+                       uint16_t current_address, symboltable_t *symboltable_list,
+                       uint32_t symboltable_currentsize) {
+        int i;
+        tokenrange_t expression;
+        exprnode_t *node;
+        uint32_t symbol_index;
+        uint16_t value;
         enum operand_status_t {UNKNOWN = 0, DETERMINED} operand_status;
         uint8_t byte_length;
-        data_status_t data_status, memory_status, indexreg_status;
+        data_status_t data_status, memory_status, indexreg_status, relocation_status;
+        atom_t atom;
 
         operand_status = UNKNOWN;
-        
-        index = strlen(operand) - 1;
-
-        if(!strcmp(operand, "(BC)") || !strcmp(operand, "(DE)") ||
-           !strcmp(operand, "(HL)") || !strcmp(operand, "(SP)") ||
-           !strcmp(operand, "(C)")) {
-                if(!strcmp(operand, "(BC)"))
-                        *operand_type = BC_REGISTER_MEMREF;
-                else if(!strcmp(operand, "(DE)"))
-                        *operand_type = DE_REGISTER_MEMREF;
-                else if(!strcmp(operand, "(HL)"))
-                        *operand_type = HL_REGISTER_MEMREF;
-                else if(!strcmp(operand, "(SP)"))
-                        *operand_type = SP_REGISTER_MEMREF;
-                else
-                        *operand_type = C_REGISTER_MEMREF;
-                operand_status = DETERMINED;
+
+        /* Registers and symbols are recognized by the atom the lexer gave them, and a
+           memory reference through a register by the atom of the whole reference. */
+        atom = get_operandatom(operand);
+
+        operand_status = DETERMINED;
+        switch(atom) {
+        case ATOM_BCMEMREF:
+                *operand_type = BC_REGISTER_MEMREF;
+                break;
+        case ATOM_DEMEMREF:
+                *operand_type = DE_REGISTER_MEMREF;
+                break;
+        case ATOM_HLMEMREF:
+                *operand_type = HL_REGISTER_MEMREF;
+                break;
+        case ATOM_SPMEMREF:
+                *operand_type = SP_REGISTER_MEMREF;
+                break;
+        case ATOM_CMEMREF:
+                *operand_type = C_REGISTER_MEMREF;
+                break;
+        default:
+                operand_status = UNKNOWN;
+                break;
         }
         
-        if(operand[0] == '(' && operand[index] == ')' && operand_status == UNKNOWN) {
-                if(operand[index - 1] == 'H' || operand[index - 1] == 'h')
-                        boundary = index - 1;
-                else
-                        boundary = index;
-                memory_status = VALID;
-                for(index = 1; index < boundary; ++index) {
-                        if((operand[index] < '0' || operand[index] > '9') &&
-                           (operand[index] < 'A' || operand[index] > 'F') &&
-                           (operand[index] < 'a' || operand[index] > 'f'))
-                                memory_status = INVALID;
-                }
+        if(operand_status == UNKNOWN) {
+                memory_status = testif_memlocvalid(operand, &value);
                 if(memory_status == VALID) {
                         *operand_type = MEMORY_16_BIT;
-                        for(index = 1; index < (strlen(operand) - 1); ++index)
-                                value_toconvert[index - 1] = operand[index];
-                        value_toconvert[index - 1] = '\0';
                         *operand_valuelength = 2;
-                        operand_value[0] = (uint8_t)
-                                asciistr_to16bitnum(value_toconvert);
-                        operand_value[1] = (uint8_t)
-                                (asciistr_to16bitnum(value_toconvert) >> 8);
+                        operand_value[0] = (uint8_t) value;
+                        operand_value[1] = (uint8_t) (value >> 8);
                         operand_status = DETERMINED;
                 }
                 else {
-                        indexreg_status = testif_indexregwoffset(operand, operand_type);
+                        indexreg_status = testif_indexregwoffset(operand, operand_type,
+                                                                 &operand_value[0]);
                         if(indexreg_status == VALID) {
                                 *operand_valuelength = 1;
-                                index = 0;
-                                while((operand[index] < '0' || operand[index] > '9') &&
-                                      (operand[index] < 'A' || operand[index] > 'F') &&
-                                      (operand[index] < 'a' || operand[index] > 'f'))
-                                        ++index;
-                                index2 = 0;
-                                do {
-                                        value_toconvert[index2++] = operand[index++];
-                                } while(operand[index] != ')' && operand[index] != ' ' &&
-                                        operand[index] != '\t');
-                                value_toconvert[index2] = '\0';
-                                operand_value[0] = (uint8_t)
-                                        asciistr_to16bitnum(value_toconvert);
                                 operand_status = DETERMINED;
                         }
                 }
                
         }
 
-        if(operand_status == UNKNOWN) {
-                data_status = testif_numvalid(operand, &byte_length);
+        if(operand_status == UNKNOWN && operand->n_tokens == 1) {
+                data_status = parse_literal(&operand->tokens[0], &value, &byte_length);
 
                 if(data_status == VALID) {
                         if(byte_length == 1) {
                                 *operand_type = VALUE_8_BIT;
                                 *operand_valuelength = 1;
-                                operand_value[0] = (uint8_t) asciistr_to16bitnum(operand);
+                                operand_value[0] = (uint8_t) value;
                                 operand_value[1] = 0;
                         }
                         else {
                                 *operand_type = VALUE_16_BIT;
                                 *operand_valuelength = 2;
-                                operand_value[0] = (uint8_t) asciistr_to16bitnum(operand);
-                                operand_value[1] = (uint8_t)
-                                        (asciistr_to16bitnum(operand) >> 8);
+                                operand_value[0] = (uint8_t) value;
+                                operand_value[1] = (uint8_t) (value >> 8);
                         }
                         operand_status = DETERMINED;
                 }
@@ -167,38 +203,201 @@ void retrieve_opcharac(char *operand, uint8_t *operand_type, uint8_t *operand_va
                         operand_status = UNKNOWN;
         }
 
-        if(operand_status == UNKNOWN) {
-                for(index = 0; index < symboltable_currentsize; ++index) {
-                        if(!strcmp(operand, symboltable_list[index].name)) {
-                                *operand_type = symboltable_list[index].value_type;
-                                *operand_valuelength =
-                                        symboltable_list[index].value_nbytes;
-                                for(i = 0; i < *operand_valuelength; ++i) {
-                                        operand_value[i] =
-                                                symboltable_list[index].value[i];
-                                }
+        /* The expressions of the operands were compiled by the first pass and their
+           symbols are all defined by now, except in a module, where the linker gives
+           the values of some. */
+        if(operand_status == UNKNOWN && atom == ATOM_NONE &&
+           split_operandexpression(operand, operand_type, &expression) == VALID) {
+                node = find_expression(expression.tokens);
+                if(node == NULL)
+                        node = compile_expression(expression.tokens, expression.n_tokens,
+                                                  current_address, symboltable_list);
+                data_status = relocation_status = INVALID;
+                if(node != NULL)
+                        data_status = evaluate_expression(node, symboltable_list, &value);
+                if(node != NULL && data_status != VALID)
+                        relocation_status = hold_relocation(node, symboltable_list,
+                                                            &value);
+                if(data_status != VALID && relocation_status != VALID) {
+                        STDERR("line %u: the operand could not be evaluated\n",
+                               operand->tokens[0].line);
+                        EFAILURE;
+                }
+
+                if(relocation_status == VALID &&
+                   (*operand_type == IX_REGISTER_WOFFSET ||
+                    *operand_type == IY_REGISTER_WOFFSET)) {
+                        STDERR("line %u: the offset cannot be given its value by the "
+                               "linker\n", operand->tokens[0].line);
+                        EFAILURE;
+                }
+                if(*operand_type == IX_REGISTER_WOFFSET ||
+                   *operand_type == IY_REGISTER_WOFFSET) {
+                        if(value > 0xFF && value < 0xFF80) {
+                                STDERR("line %u: the offset does not fit in a byte\n",
+                                       operand->tokens[0].line);
+                                EFAILURE;
+                        }
+                        *operand_valuelength = 1;
+                }
+                else {
+                        if(*operand_type == NONE)
+                                *operand_type = node->type;
+                        *operand_valuelength = (*operand_type == VALUE_8_BIT) ? 1 : 2;
+                }
+                operand_value[0] = (uint8_t) value;
+                operand_value[1] = (uint8_t) (value >> 8);
+                operand_status = DETERMINED;
+        }
+
+        if(operand_status == UNKNOWN && lookup_symbol(atom, &symbol_index) == VALID) {
+                *operand_type = symboltable_list[symbol_index].value_type;
+                *operand_valuelength = symboltable_list[symbol_index].value_nbytes;
+                for(i = 0; i < *operand_valuelength; ++i)
+                        operand_value[i] = symboltable_list[symbol_index].value[i];
+
+                /* In a module a name may still be given its value by the linker. */
+                if(symboltable_list[symbol_index].value_status != DEFINED) {
+                        node = compile_expression(operand->tokens, 1, current_address,
+                                                  symboltable_list);
+                        if(node == NULL ||
+                           hold_relocation(node, symboltable_list, &value) != VALID) {
+                                STDERR("line %u: the operand could not be evaluated\n",
+                                       operand->tokens[0].line);
+                                EFAILURE;
                         }
+                        operand_value[0] = (uint8_t) value;
+                        operand_value[1] = (uint8_t) (value >> 8);
                 }
         }
 }
 
-void assemble(FILE *outputfile_handle, instruction_parameters_t **instruction_set,
-              char *instruction,
+/* Gives the value of an item of a data directive, which must fit in n_bytes. In a
+   module the item may be left to the linker, which fills in its bytes at the offset in
+   the output image; NO_RELOCATION is given for an item that cannot be. */
+static uint16_t evaluate_dataitem(const tokenrange_t *item, uint16_t current_address,
+                                  symboltable_t *symboltable_list, uint8_t n_bytes,
+                                  uint32_t offset) {
+        exprnode_t *node;
+        uint16_t value;
+        uint8_t byte_length;
+        data_status_t data_status;
+
+        if(item->n_tokens != 1 ||
+           parse_literal(&item->tokens[0], &value, &byte_length) != VALID) {
+                node = compile_expression(item->tokens, item->n_tokens, current_address,
+                                          symboltable_list);
+                data_status = INVALID;
+                if(node != NULL)
+                        data_status = evaluate_expression(node, symboltable_list, &value);
+                if(node != NULL && data_status != VALID && offset != NO_RELOCATION)
+                        data_status = relocate_dataitem(node, symboltable_list, offset,
+                                                        n_bytes, &value);
+                if(data_status != VALID) {
+                        STDERR("line %u: the data item could not be evaluated\n",
+                               item->tokens[0].line);
+                        EFAILURE;
+                }
+        }
+
+        /* A byte may be given as a negative number, down to -128. */
+        if(n_bytes == 1 && value > 0xFF && value < 0xFF80) {
+                STDERR("line %u: the data item does not fit in a byte\n",
+                       item->tokens[0].line);
+                EFAILURE;
+        }
+
+        return value;
+}
+
+/* Emits the bytes of DB, DW, DS, ALIGN or INCBIN. The room for all of them is reserved
+   in the image at once and filled in place: a string is copied, the block of DS or
+   ALIGN is set with a single memset and the part of the file INCBIN names is copied
+   from its mapping. */
+void assemble_data(tokenstream_t *tokenstream, outputimage_t *outputimage,
+                   atom_t directive, symboltable_t *symboltable_list,
+                   line_status_t *line_status, uint16_t *current_address) {
+        tokenrange_t dir_arg, item;
+        const token_t *name, *statement;
+        uint32_t size, position, length, offset;
+        uint16_t value;
+        uint8_t *output;
+
+        statement = &tokenstream->tokens[tokenstream->position - 1];
+        extract_direxpression(tokenstream, line_status, &dir_arg);
+        if(measure_data(directive, &dir_arg, *current_address, symboltable_list,
+                        &size) != VALID || size == 0)
+                return;
+
+        output = reserve_inimage(outputimage, *current_address, size, statement);
+        if(output == NULL) {
+                STDERR("the output image could not be extended\n");
+                EFAILURE;
+        }
+
+        position = 0;
+        if(directive == ATOM_INCBIN) {
+                measure_binaryfile(&dir_arg, *current_address, symboltable_list, &name,
+                                   &offset, &length);
+                if(copy_binaryfile(name, offset, length, output) == ERROR) {
+                        STDERR("line %u: the binary file could not be read\n",
+                               name->line);
+                        EFAILURE;
+                }
+        }
+        else if(directive == ATOM_DS || directive == ATOM_DEFS ||
+                directive == ATOM_ALIGN) {
+                extract_dataitem(&dir_arg, &position, &item);
+                value = 0;
+                if(extract_dataitem(&dir_arg, &position, &item) == VALID)
+                        value = evaluate_dataitem(&item, *current_address,
+                                                  symboltable_list, 1, NO_RELOCATION);
+                memset(output, (uint8_t) value, size);
+        }
+        else {
+                while(extract_dataitem(&dir_arg, &position, &item) == VALID) {
+                        if((directive == ATOM_DB || directive == ATOM_DEFB) &&
+                           item.n_tokens == 1 && item.tokens[0].type == TOKEN_STRING) {
+                                get_stringtext(&item.tokens[0], output, &length);
+                                output += length;
+                        }
+                        else if(directive == ATOM_DB || directive == ATOM_DEFB) {
+                                value = evaluate_dataitem(&item, *current_address,
+                                                          symboltable_list, 1,
+                                                          output - outputimage->bytes);
+                                *output++ = (uint8_t) value;
+                        }
+                        else {
+                                value = evaluate_dataitem(&item, *current_address,
+                                                          symboltable_list, 2,
+                                                          output - outputimage->bytes);
+                                *output++ = (uint8_t) value;
+                                *output++ = (uint8_t) (value >> 8);
+                        }
+                }
+        }
+
+        *current_address += size;
+}
+
+void assemble(outputimage_t *outputimage, instruction_parameters_t **instruction_set,
+              atom_t instruction,
               uint8_t operand1_type, uint8_t operand2_type, uint8_t operand1_valuelength,
               uint8_t operand2_valuelength, uint8_t operand1_value[],
               uint8_t operand2_value[], uint16_t *current_address,
-              uint16_t *beginning_address, uint16_t *previous_address) {
+              const token_t *statement) {
         int index1, index2, i;
         loop_status_t loop_status = CONTINUE;
         uint8_t instruction_length;
         uint8_t bitmask, value_atinterest, value[4], lval, nshift;
 
-        index1 = instruction[0] - 65;
+        index1 = get_atomname(instruction)[0] - 65;
 
         index2 = 0;
         while(instruction_set[index1][index2].instruction_name != NULL &&
               loop_status == CONTINUE) {
-               if(!strcmp(instruction, instruction_set[index1][index2].instruction_name) &&
+               COUNT(instruction_probes);
+               if(get_instructionatom(index1, index2) == instruction &&
                   operand1_type == instruction_set[index1][index2].operand_type[0] &&
                   operand2_type == instruction_set[index1][index2].operand_type[1]) {
                        loop_status = EXIT;
@@ -327,95 +526,26 @@ void assemble(FILE *outputfile_handle, instruction_parameters_t **instruction_se
                 }
         }
 
-        output_tofile(outputfile_handle, instruction_length, value, current_address,
-                      beginning_address, previous_address);
-}
+        record_instructionmix(index1, index2, instruction_length, value);
 
-static fpos_t addressfield_filepos;
-static fpos_t original_filepos;
-static fpos_t bytecountfield_filepos;
-static uint8_t nbytes_oncurrentline;
-
-void output_tofile(FILE *outputfile_handle, uint8_t instruction_length, uint8_t value[],
-                   uint16_t *current_address, uint16_t *beginning_address,
-                   uint16_t *previous_address) {
-        uint16_t threshold;
-        uint8_t lval;
-        int index;
-
-        threshold = *beginning_address + 16;
-
-        if(*current_address == *beginning_address) {
-                fputc(':', outputfile_handle);
-                fgetpos(outputfile_handle, &bytecountfield_filepos);
-                fputs("  ", outputfile_handle);
-                lval = (uint8_t) (*current_address >> 8);
-                put8bitval_inhex(outputfile_handle, lval);
-                lval = (uint8_t) *current_address;
-                put8bitval_inhex(outputfile_handle, lval);
-                fputs("00", outputfile_handle);
-                nbytes_oncurrentline = 0;
-        }
-
-        for(index = 0; index < instruction_length; ++index) {
-                if(*current_address >= *beginning_address &&
-                   *current_address < threshold &&
-                   (*previous_address == *current_address ||
-                    *previous_address == (*current_address - 1))) {
-                        put8bitval_inhex(outputfile_handle, value[index]);
-                        *previous_address = *current_address;
-                        ++(*current_address);
-                        ++nbytes_oncurrentline;
-                }
-                else {
-                        *beginning_address = *current_address;
-                        threshold = *beginning_address + 16;
-                        fgetpos(outputfile_handle, &original_filepos);
-                        fsetpos(outputfile_handle, &bytecountfield_filepos);
-                        put8bitval_inhex(outputfile_handle, nbytes_oncurrentline);
-                        fsetpos(outputfile_handle, &original_filepos);
-                        checksum(outputfile_handle);
-                        fputs("\r\n:", outputfile_handle);
-                        fgetpos(outputfile_handle, &bytecountfield_filepos);
-                        fputs("  ", outputfile_handle);
-                        lval = (uint8_t) (*current_address >> 8);
-                        put8bitval_inhex(outputfile_handle, lval);
-                        lval = (uint8_t) *current_address;
-                        put8bitval_inhex(outputfile_handle, lval);
-                        fputs("00", outputfile_handle);
-                        nbytes_oncurrentline = 0;
-                        put8bitval_inhex(outputfile_handle, value[index]);
-                        *previous_address = *current_address;
-                        ++(*current_address);
-                        ++nbytes_oncurrentline;
-                }
-        }
+        output_toimage(outputimage, instruction_length, value, current_address,
+                       statement);
+        place_relocations(outputimage, instruction_set[index1][index2].binary_code,
+                          instruction_length, statement->line);
 }
 
-void checksum(FILE *outputfile_handle) {
-        int index;
-        char c[3];
-        uint8_t value = 0, checksum, temp;
-
-        fsetpos(outputfile_handle, &bytecountfield_filepos);
-        for(index = bytecountfield_filepos; index < original_filepos; ++index) {
-                c[0] = fgetc(outputfile_handle);
-                ++index;
-                c[1] = fgetc(outputfile_handle);
-                c[2] = '\0';
-                value += hexstr_todecnum(c);
+void output_toimage(outputimage_t *outputimage, uint8_t instruction_length,
+                    uint8_t value[], uint16_t *current_address,
+                    const token_t *statement) {
+        uint8_t *output;
+
+        output = reserve_inimage(outputimage, *current_address, instruction_length,
+                                 statement);
+        if(output == NULL) {
+                STDERR("the output image could not be extended\n");
+                EFAILURE;
         }
-        checksum = value ^ 0xFF;
-        checksum += 1;
-        fsetpos(outputfile_handle, &original_filepos);
-        put8bitval_inhex(outputfile_handle, checksum);
-}
 
-void finish_outputhexfile(FILE *outputfile_handle) {
-        fgetpos(outputfile_handle, &original_filepos);
-        fsetpos(outputfile_handle, &bytecountfield_filepos);
-        put8bitval_inhex(outputfile_handle, nbytes_oncurrentline);
-        fsetpos(outputfile_handle, &original_filepos);
-        checksum(outputfile_handle);
-        fputs("\r\n:00000001FF", outputfile_handle);
+        memcpy(output, value, instruction_length);
+        *current_address += instruction_length;
 }
@@ -21,30 +21,35 @@
 #ifndef ASSEMBLE_H
 #define ASSEMBLE_H
 
-void assemble_instruction(FILE *infile_handle, FILE *outfile_handle, char *instruction,
+#include <stdio.h>
+#include "defines.h"
+#include "lexer.h"
+#include "image.h"
+
+void assemble_instruction(tokenstream_t *tokenstream, outputimage_t *outputimage,
+                          atom_t instruction,
                           instruction_parameters_t **instruction_set,
                           symboltable_t *symboltable_list,
-                          uint8_t symboltable_currentsize, line_status_t *line_status,
-                          uint16_t *current_address, uint16_t *beginning_address,
-                          uint16_t *previous_address);
+                          uint32_t symboltable_currentsize, line_status_t *line_status,
+                          uint16_t *current_address);
+
+void retrieve_opcharac(const tokenrange_t *operand, uint8_t *operand_type,
+                       uint8_t *operand_valuelength, uint8_t operand_value[],
+                       uint16_t current_address, symboltable_t *symboltable_list,
+                       uint32_t symboltable_currentsize);
 
-void retrieve_opcharac(char *operand, uint8_t *operand_type, uint8_t *operand_valuelength,
-                       uint8_t operand_value[], symboltable_t *symboltable_list,
-                       uint8_t symboltable_currentsize);
+void assemble_data(tokenstream_t *tokenstream, outputimage_t *outputimage,
+                   atom_t directive, symboltable_t *symboltable_list,
+                   line_status_t *line_status, uint16_t *current_address);
 
-void assemble(FILE *outputfile, instruction_parameters_t **instruction_set,
-              char *instruction, uint8_t operand1_type, uint8_t operand2_type,
+void assemble(outputimage_t *outputimage, instruction_parameters_t **instruction_set,
+              atom_t instruction, uint8_t operand1_type, uint8_t operand2_type,
               uint8_t operand1_valuelength, uint8_t operand2_valuelength,
               uint8_t operand1_value[], uint8_t operand2_value[],
-              uint16_t *current_address, uint16_t *beginning_address,
-              uint16_t *previous_address);
- 
-void output_tofile(FILE *outputfile_handle, uint8_t instruction_length,
-                   uint8_t value[], uint16_t *current_address,
-                   uint16_t *beginning_address, uint16_t *previous_address);
-
-void checksum(FILE *outputfile_handle);
+              uint16_t *current_address, const token_t *statement);
 
-void finish_outputhexfile(FILE *outputfile_handle);
+void output_toimage(outputimage_t *outputimage, uint8_t instruction_length,
+                    uint8_t value[], uint16_t *current_address,
+                    const token_t *statement);
 
 #endif
@@ -0,0 +1,205 @@
+// File: bank.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the banks. BANK is given the number of the bank and, where the bank
+ * is first selected, the window it is switched in through: the first address and the
+ * address after the last, 0000H standing for the top of the address space.
+ *
+ *      BANK 1, 4000H, 8000H
+ *      ...
+ *      BANK 2, 4000H, 8000H
+ *      ...
+ *      BANK 1
+ *
+ * Without a window a bank takes the whole address space. Every bank has a location
+ * counter of its own, which starts at the first address of its window, and a bank that
+ * is selected again is carried on where it was left. Bank n lies n times the size of
+ * its window into the physical memory, so that banks of the same window follow each
+ * other; the code outside banks lies at its own addresses. Once a bank has been selected
+ * the code outside banks cannot be gone back to.
+ *
+ * The labels of a bank are known to every other bank, and BANK label gives the number of
+ * the bank a label was defined in.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "defines.h"
+#include "intern.h"
+#include "lexer.h"
+#include "parse.h"
+#include "section.h"
+#include "image.h"
+#include "object.h"
+#include "bank.h"
+
+#define N_BANKS 256
+#define NO_BANK UINT32_MAX
+
+typedef struct bank_t {
+        /* The line the bank was first selected on, or 0 if it has not been. */
+        uint32_t line;
+        uint16_t first;
+        uint32_t end;
+        /* The location counters of the bank in the first and in the second pass when
+           it was last left. */
+        uint16_t counter, replay_counter;
+} bank_t;
+
+static bank_t banks[N_BANKS];
+/* The bank selected in the first pass and in the second. */
+static uint32_t current_bank = NO_BANK, replayed_bank = NO_BANK;
+
+/* The bank selected by every BANK met in the first pass, in order. */
+static uint8_t *bankrecords;
+static uint32_t bankrecords_currentsize, bankrecords_actualsize;
+static uint32_t next_bankrecord;
+
+static void record_bank(uint8_t bank) {
+        uint8_t *bankrecords_newlist;
+
+        if(bankrecords_currentsize == bankrecords_actualsize) {
+                bankrecords_newlist = realloc(bankrecords, bankrecords_actualsize * 2 + 16);
+                if(bankrecords_newlist == NULL) {
+                        STDERR("the banks could not be recorded\n");
+                        EFAILURE;
+                }
+                bankrecords = bankrecords_newlist;
+                bankrecords_actualsize = bankrecords_actualsize * 2 + 16;
+        }
+
+        bankrecords[bankrecords_currentsize++] = bank;
+}
+
+void handle_bank(tokenstream_t *tokenstream, symboltable_t *symboltable_list,
+                 uint16_t *location_counter, line_status_t *line_status) {
+        bank_t *bank;
+        tokenrange_t dir_arg, number, first, end;
+        uint32_t line, position, window_end;
+        uint16_t value, window_first, value_end;
+        int windowed;
+
+        line = tokenstream->tokens[tokenstream->position - 1].line;
+        extract_direxpression(tokenstream, line_status, &dir_arg);
+
+        if(testif_objectoutput()) {
+                STDERR("line %u: BANK cannot be used in a module\n", line);
+                EFAILURE;
+        }
+
+        position = 0;
+        if(extract_dataitem(&dir_arg, &position, &number) != VALID ||
+           evaluate_dirarg(&number, *location_counter, symboltable_list,
+                           &value) != VALID || value >= N_BANKS) {
+                STDERR("line %u: BANK needs the number of the bank, from 0 to %u, known "
+                       "when it is met\n", line, N_BANKS - 1);
+                EFAILURE;
+        }
+
+        window_first = 0;
+        window_end = 0x10000;
+        windowed = position <= dir_arg.n_tokens;
+        if(windowed) {
+                if(extract_dataitem(&dir_arg, &position, &first) != VALID ||
+                   extract_dataitem(&dir_arg, &position, &end) != VALID ||
+                   position <= dir_arg.n_tokens ||
+                   evaluate_dirarg(&first, *location_counter, symboltable_list,
+                                   &window_first) != VALID ||
+                   evaluate_dirarg(&end, *location_counter, symboltable_list,
+                                   &value_end) != VALID) {
+                        STDERR("line %u: the window of BANK needs the first address and "
+                               "the address after the last, known when it is met\n",
+                               line);
+                        EFAILURE;
+                }
+                window_end = (value_end == 0) ? 0x10000 : value_end;
+                if(window_end <= window_first) {
+                        STDERR("line %u: the window of the bank ends before it starts\n",
+                               line);
+                        EFAILURE;
+                }
+        }
+
+        bank = &banks[value];
+        if(bank->line != 0 && windowed &&
+           (bank->first != window_first || bank->end != window_end)) {
+                STDERR("line %u: the window of bank %u is given where it is first "
+                       "selected, on line %u\n", line, value, bank->line);
+                EFAILURE;
+        }
+
+        /* The code that is left keeps its location counter. */
+        if(current_bank == NO_BANK)
+                move_origin(line, ATOM_BANK, *location_counter, *location_counter);
+        else
+                banks[current_bank].counter = *location_counter;
+
+        if(bank->line == 0) {
+                bank->line = line;
+                bank->first = window_first;
+                bank->end = window_end;
+                bank->counter = bank->replay_counter = window_first;
+        }
+
+        record_bank((uint8_t) value);
+        current_bank = value;
+        *location_counter = bank->counter;
+}
+
+/* Tells whether a bank has been selected. */
+int testif_banked(void) {
+        return current_bank != NO_BANK;
+}
+
+/* Gives the bank that is selected, or 0 outside banks. */
+uint8_t get_currentbank(void) {
+        return (current_bank == NO_BANK) ? 0 : (uint8_t) current_bank;
+}
+
+void replay_bank(tokenstream_t *tokenstream, outputimage_t *outputimage,
+                 uint16_t *current_address, line_status_t *line_status) {
+        tokenrange_t dir_arg;
+        bank_t *bank;
+
+        extract_direxpression(tokenstream, line_status, &dir_arg);
+
+        if(replayed_bank != NO_BANK)
+                banks[replayed_bank].replay_counter = *current_address;
+
+        replayed_bank = bankrecords[next_bankrecord++];
+        bank = &banks[replayed_bank];
+        *current_address = bank->replay_counter;
+        map_imagewindow(outputimage, (uint8_t) replayed_bank, bank->first, bank->end,
+                        replayed_bank * (bank->end - bank->first));
+}
+
+void free_banks(void) {
+        uint32_t index;
+
+        for(index = 0; index < N_BANKS; ++index)
+                banks[index].line = 0;
+        current_bank = replayed_bank = NO_BANK;
+
+        free(bankrecords);
+        bankrecords = NULL;
+        bankrecords_currentsize = bankrecords_actualsize = next_bankrecord = 0;
+}
@@ -0,0 +1,48 @@
+// File: bank.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the banks. BANK selects one of up to 256 banks of memory that are
+ * switched in through a window of the address space; the code that follows is assembled
+ * at the addresses of the window and emitted at the physical address of the bank.
+ */
+
+#ifndef BANK_H
+#define BANK_H
+
+#include <stdint.h>
+#include "defines.h"
+#include "lexer.h"
+#include "image.h"
+
+void handle_bank(tokenstream_t *tokenstream, symboltable_t *symboltable_list,
+                 uint16_t *location_counter, line_status_t *line_status);
+
+int testif_banked(void);
+
+uint8_t get_currentbank(void);
+
+void replay_bank(tokenstream_t *tokenstream, outputimage_t *outputimage,
+                 uint16_t *current_address, line_status_t *line_status);
+
+void free_banks(void);
+
+#endif
@@ -0,0 +1,131 @@
+#!/bin/sh
+# File: bench/bench.sh
+# Created: 19, October 2026
+
+#  Copyright (C) 2014 Jarielle Catbagan
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Description:
+
+# Times z80asm on generated sources of increasing size and compares the throughput
+# against the stored baseline. Each size is assembled BENCH_RUNS times and the fastest
+# run is kept. A size whose lines/sec drops more than BENCH_THRESHOLD percent below
+# the baseline is flagged and makes the script exit with a failure status.
+#
+# usage: bench.sh [--update-baseline]
+#
+# environment:
+#   BENCH_SIZES      source sizes in lines (default "10000 100000")
+#   BENCH_RUNS       runs per size (default 3)
+#   BENCH_THRESHOLD  allowed slowdown in percent (default 10)
+#   Z80ASM           assembler to time (default ./z80asm)
+#   GENSOURCE        source generator (default bench/gensource)
+
+BENCH_DIR=$(dirname "$0")
+BASELINE=$BENCH_DIR/baseline.txt
+Z80ASM=${Z80ASM:-./z80asm}
+GENSOURCE=${GENSOURCE:-$BENCH_DIR/gensource}
+SIZES=${BENCH_SIZES:-"10000 100000"}
+RUNS=${BENCH_RUNS:-3}
+THRESHOLD=${BENCH_THRESHOLD:-10}
+WORK_DIR=${TMPDIR:-/tmp}/z80asm-bench.$$
+
+update_baseline=no
+if [ "$1" = "--update-baseline" ]; then
+        update_baseline=yes
+fi
+
+get_time() {
+        date +%s%N
+}
+
+# Pull one number out of the single-line JSON written by --stats json.
+get_statsfield() {
+        sed -n "s/.*\"$1\": \([0-9.]*\).*/\1/p" "$2" | head -n 1
+}
+
+mkdir -p "$WORK_DIR" || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+status=0
+new_baseline=$WORK_DIR/baseline.txt
+echo "# size lines/sec MB/s, written by bench.sh --update-baseline" > "$new_baseline"
+
+printf "%9s %9s %10s %12s %8s %9s %9s %9s %9s\n" "lines" "bytes" "wall ms" "lines/sec" \
+       "MB/s" "pass1 ms" "pass2 ms" "hex ms" "baseline"
+
+for size in $SIZES; do
+        source_file=$WORK_DIR/bench$size.s
+        "$GENSOURCE" "$size" > "$source_file" || exit 1
+        n_lines=$(wc -l < "$source_file")
+        n_bytes=$(wc -c < "$source_file")
+
+        best=
+        run=0
+        while [ $run -lt "$RUNS" ]; do
+                start=$(get_time)
+                # The ORGs of the generated sources are random, so their blocks may
+                # overlap.
+                if ! "$Z80ASM" -s "$source_file" --allow-overlap --stats json \
+                     > "$WORK_DIR/stats.json"; then
+                        echo "error: z80asm failed on $source_file" >&2
+                        exit 1
+                fi
+                end=$(get_time)
+                elapsed=$((end - start))
+                if [ -z "$best" ] || [ $elapsed -lt $best ]; then
+                        best=$elapsed
+                        cp "$WORK_DIR/stats.json" "$WORK_DIR/best.json"
+                fi
+                run=$((run + 1))
+        done
+
+        pass1=$(get_statsfield "pass one" "$WORK_DIR/best.json")
+        pass2=$(get_statsfield "pass two" "$WORK_DIR/best.json")
+        hex=$(get_statsfield "hex emission" "$WORK_DIR/best.json")
+        reference=$(awk -v size="$size" '$1 == size { print $2 }' "$BASELINE" 2>/dev/null)
+
+        awk -v size="$size" -v lines="$n_lines" -v bytes="$n_bytes" -v ns="$best" \
+            -v pass1="$pass1" -v pass2="$pass2" -v hex="$hex" \
+            -v reference="$reference" -v threshold="$THRESHOLD" \
+            -v baseline_file="$new_baseline" '
+        BEGIN {
+                seconds = ns / 1e9
+                rate = lines / seconds
+                printf "%9d %9d %10.1f %12.0f %8.2f %9.1f %9.1f %9.1f", lines, bytes,
+                       seconds * 1e3, rate, bytes / seconds / 1e6, pass1 * 1e3,
+                       pass2 * 1e3, hex * 1e3
+                printf "%d %.0f %.2f\n", size, rate, bytes / seconds / 1e6 >> baseline_file
+                if (reference == "") {
+                        printf " %9s\n", "-"
+                        exit 0
+                }
+                change = (rate - reference) * 100 / reference
+                printf " %+8.1f%%", change
+                if (change < -threshold) {
+                        printf "  REGRESSION\n"
+                        exit 1
+                }
+                printf "\n"
+        }' || status=1
+done
+
+if [ $update_baseline = yes ]; then
+        cp "$new_baseline" "$BASELINE"
+        echo "baseline written to $BASELINE"
+        status=0
+fi
+
+exit $status
@@ -0,0 +1,239 @@
+// File: bench/gensource.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file generates synthetic assembly sources for benchmarking z80asm. The output
+ * is deterministic for a given number of lines and seed and resembles hand-written
+ * code: a label every few lines, forward and backward references, IX/IY indexed
+ * operands, EQU chains, comments and ORGs scattered over the address space. Only
+ * whole blocks are generated, so the number of lines is approximate.
+ *
+ * With --symbols the output is instead one labelled jump per line, each to the label
+ * half the file away, so that the symbol table and the list of forward references grow
+ * with exactly the number of lines. This is what the scaling tests use.
+ *
+ * usage: gensource <lines> [seed]
+ *        gensource --symbols <count>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LINES_PERBLOCK 8
+#define BLOCKS_PERORG 512
+#define BLOCKS_PEREQUCHAIN 64
+#define EQUCHAIN_LENGTH 4
+
+static uint32_t random_state;
+
+static uint32_t get_random(uint32_t bound) {
+        /* xorshift32; good enough to vary the templates and cheap to reproduce. */
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 17;
+        random_state ^= random_state << 5;
+
+        return random_state % bound;
+}
+
+static const char *registers_8bit[] = {"B", "C", "D", "E", "H", "L"};
+static const char *registers_16bit[] = {"BC", "DE", "HL"};
+static const char *alu_mnemonics[] = {"ADD", "ADC", "SUB", "SBC", "AND", "XOR", "OR",
+                                      "CP"};
+static const char *index_registers[] = {"IX", "IY"};
+
+static const char *get_8bitregister(void) {
+        return registers_8bit[get_random(6)];
+}
+
+static void put_instruction(unsigned long block, unsigned long n_blocks,
+                            unsigned long equ_count) {
+        unsigned long target;
+
+        switch(get_random(24)) {
+        case 0:
+                printf("LD %s, %s", get_8bitregister(), get_8bitregister());
+                break;
+        case 1:
+                printf("LD %s, 0%02XH", get_8bitregister(), get_random(256));
+                break;
+        case 2:
+                printf("LD A, 0%02XH", get_random(256));
+                break;
+        case 3:
+                printf("LD %s, 0%04XH", registers_16bit[get_random(3)],
+                       0x100 + get_random(0xFF00));
+                break;
+        case 4:
+                printf("LD (%s+0%02XH), A", index_registers[get_random(2)],
+                       get_random(128));
+                break;
+        case 5:
+                printf("LD %s, (%s+0%02XH)", get_8bitregister(),
+                       index_registers[get_random(2)], get_random(128));
+                break;
+        case 6:
+                printf("%s A, %s", alu_mnemonics[get_random(8)], get_8bitregister());
+                break;
+        case 7:
+                printf("%s A, 0%02XH", alu_mnemonics[get_random(8)], get_random(256));
+                break;
+        case 8:
+                printf("%s A, (%s+0%02XH)", alu_mnemonics[get_random(8)],
+                       index_registers[get_random(2)], get_random(128));
+                break;
+        case 9:
+                printf("%s A, (HL)", alu_mnemonics[get_random(8)]);
+                break;
+        case 10:
+                printf("%s %s", get_random(2) ? "INC" : "DEC", get_8bitregister());
+                break;
+        case 11:
+                printf("%s %s", get_random(2) ? "INC" : "DEC",
+                       registers_16bit[get_random(3)]);
+                break;
+        case 12:
+                fputs(get_random(2) ? "PUSH HL" : "POP DE", stdout);
+                break;
+        case 13:
+                /* Forward reference to a label a few blocks ahead. */
+                target = block + 1 + get_random(32);
+                if(target >= n_blocks)
+                        target = n_blocks - 1;
+                printf("JP L%06lu", target);
+                break;
+        case 14:
+                /* Backward reference. */
+                printf("JP $NZ, L%06lu", block - get_random(block + 1));
+                break;
+        case 15:
+                target = block + get_random(64);
+                if(target >= n_blocks)
+                        target = n_blocks - 1;
+                printf("LD A, L%06lu", target);
+                break;
+        case 16:
+                if(equ_count > 0)
+                        printf("LD HL, K%06u", get_random(equ_count));
+                else
+                        printf("LD HL, 01000H");
+                break;
+        case 17:
+                printf("LD A, (0%04XH)", get_random(0x10000));
+                break;
+        case 18:
+                printf("BIT B%u, %s", get_random(8), get_8bitregister());
+                break;
+        case 19:
+                printf("%s B%u, (%s+0%02XH)", get_random(2) ? "SET" : "RES",
+                       get_random(8), index_registers[get_random(2)],
+                       get_random(128));
+                break;
+        case 20:
+                printf("LD %s, 0%04XH", index_registers[get_random(2)],
+                       0x100 + get_random(0xFF00));
+                break;
+        case 21:
+                fputs(get_random(2) ? "EXX" : "NOP", stdout);
+                break;
+        case 22:
+                fputs(get_random(2) ? "RET $Z" : "DJNZ 0F0H", stdout);
+                break;
+        default:
+                printf("LDIR");
+                break;
+        }
+}
+
+static void put_symbols(unsigned long n_symbols) {
+        unsigned long index;
+
+        printf("; synthetic source: %lu symbols\n", n_symbols);
+
+        for(index = 0; index < n_symbols; ++index)
+                printf("S%07lu: JP S%07lu\n", index,
+                       (index + n_symbols / 2) % n_symbols);
+}
+
+int main(int argc, char **argv) {
+        unsigned long n_lines, n_blocks, block, equ_count, index;
+
+        if(argc > 2 && !strcmp(argv[1], "--symbols") &&
+           (n_lines = strtoul(argv[2], NULL, 10)) != 0) {
+                put_symbols(n_lines);
+                return EXIT_SUCCESS;
+        }
+
+        if(argc < 2 || (n_lines = strtoul(argv[1], NULL, 10)) == 0) {
+                fprintf(stderr, "usage: %s <lines> [seed]\n"
+                        "       %s --symbols <count>\n", argv[0], argv[0]);
+                return EXIT_FAILURE;
+        }
+        random_state = (argc > 2) ? strtoul(argv[2], NULL, 10) : 2014;
+        if(random_state == 0)
+                random_state = 2014;
+
+        n_blocks = (n_lines * BLOCKS_PEREQUCHAIN) /
+                (BLOCKS_PEREQUCHAIN * LINES_PERBLOCK + EQUCHAIN_LENGTH);
+        if(n_blocks == 0)
+                n_blocks = 1;
+        equ_count = 0;
+
+        printf("; synthetic source: %lu lines, seed %u\n", n_lines, random_state);
+
+        for(block = 0; block < n_blocks; ++block) {
+                if(block % BLOCKS_PERORG == 0)
+                        printf("        ORG 0%04XH\n", get_random(0xF0) << 8);
+
+                if(block % BLOCKS_PEREQUCHAIN == 0) {
+                        /* The first constant is a literal, every following one refers
+                           to the previous so the chain has to be resolved in order. */
+                        printf("        EQU K%06lu 0%04XH\n", equ_count,
+                               0x100 + get_random(0xFF00));
+                        ++equ_count;
+                        for(index = 1; index < EQUCHAIN_LENGTH; ++index) {
+                                printf("        EQU K%06lu K%06lu\n", equ_count,
+                                       equ_count - 1);
+                                ++equ_count;
+                        }
+                }
+
+                printf("L%06lu: ", block);
+                put_instruction(block, n_blocks, equ_count);
+                putchar('\n');
+
+                for(index = 1; index < LINES_PERBLOCK; ++index) {
+                        if(get_random(20) == 0) {
+                                printf("; block %lu, line %lu\n", block, index);
+                        }
+                        else {
+                                printf("        ");
+                                put_instruction(block, n_blocks, equ_count);
+                                if(get_random(10) == 0)
+                                        printf(" ; trailing comment");
+                                putchar('\n');
+                        }
+                }
+        }
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#!/bin/sh
+# File: bench/scaling.sh
+# Created: 19, October 2026
+
+#  Copyright (C) 2014 Jarielle Catbagan
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Description:
+
+# Assembles sources with a doubling number of symbols and forward references and
+# checks that time and memory grow close to linearly. The growth exponent is measured
+# between the largest size and the size SCALING_SPAN doublings below it; linear code
+# gives about 1 and the old quadratic lookups gave 2. An exponent above
+# SCALING_LIMIT makes the script exit with a failure status.
+#
+# usage: scaling.sh
+#
+# environment:
+#   SCALING_MIN    smallest number of symbols (default 1000)
+#   SCALING_MAX    largest number of symbols (default 1024000)
+#   SCALING_SPAN   doublings the exponent is measured over (default 3)
+#   SCALING_LIMIT  largest accepted exponent (default 1.3)
+#   Z80ASM         assembler to run (default ./z80asm)
+#   GENSOURCE      source generator (default bench/gensource)
+
+BENCH_DIR=$(dirname "$0")
+Z80ASM=${Z80ASM:-./z80asm}
+GENSOURCE=${GENSOURCE:-$BENCH_DIR/gensource}
+MIN=${SCALING_MIN:-1000}
+MAX=${SCALING_MAX:-1024000}
+SPAN=${SCALING_SPAN:-3}
+LIMIT=${SCALING_LIMIT:-1.3}
+WORK_DIR=${TMPDIR:-/tmp}/z80asm-scaling.$$
+
+get_statsfield() {
+        sed -n "s/.*\"$1\": \([0-9.]*\).*/\1/p" "$2" | head -n 1
+}
+
+mkdir -p "$WORK_DIR" || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+results=$WORK_DIR/results.txt
+: > "$results"
+
+printf "%9s %10s %12s %9s\n" "symbols" "time ms" "ns/symbol" "peak KB"
+
+size=$MIN
+while [ "$size" -le "$MAX" ]; do
+        source_file=$WORK_DIR/scaling$size.s
+        "$GENSOURCE" --symbols "$size" > "$source_file" || exit 1
+        # A million jumps take more than the address space, so the code wraps around
+        # over itself.
+        if ! "$Z80ASM" -s "$source_file" --allow-overlap --stats json \
+             > "$WORK_DIR/stats.json"; then
+                echo "error: z80asm failed on $source_file" >&2
+                exit 1
+        fi
+        total=$(get_statsfield "total" "$WORK_DIR/stats.json")
+        memory=$(get_statsfield "peak_memory_kb" "$WORK_DIR/stats.json")
+        echo "$size $total $memory" >> "$results"
+        awk -v size="$size" -v total="$total" -v memory="$memory" 'BEGIN {
+                printf "%9d %10.1f %12.1f %9d\n", size, total * 1e3,
+                       total * 1e9 / size, memory
+        }'
+        rm -f "$source_file"
+        size=$((size * 2))
+done
+
+# Memory is measured above the footprint of the smallest run so that the fixed cost of
+# the process does not hide the growth.
+awk -v span="$SPAN" -v limit="$LIMIT" '
+{
+        size[NR] = $1
+        total[NR] = $2
+        memory[NR] = $3
+}
+END {
+        if (NR <= span) {
+                printf "error: need more than %d sizes\n", span > "/dev/stderr"
+                exit 1
+        }
+        small = NR - span
+        ratio = log(size[NR] / size[small])
+        time_exponent = log(total[NR] / total[small]) / ratio
+        grown = memory[NR] - memory[1] + 1
+        memory_exponent = log(grown / (memory[small] - memory[1] + 1)) / ratio
+        printf "growth from %d to %d symbols: time n^%.2f, memory n^%.2f\n",
+               size[small], size[NR], time_exponent, memory_exponent
+        if (time_exponent > limit || memory_exponent > limit) {
+                printf "SUPERLINEAR: exponent above %s\n", limit
+                exit 1
+        }
+}' "$results"
@@ -0,0 +1,265 @@
+// File: cond.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains conditional assembly. Every conditional directive must be the first
+ * word of its line:
+ *
+ *      IF VERSION-2            lines kept when the value is not zero
+ *      IFDEF DEBUG             lines kept when the symbol is defined so far
+ *      IFNDEF DEBUG            lines kept when it is not
+ *      ELSE
+ *      ENDIF
+ *
+ * The lines left out are stepped over by looking at the first token of every line for
+ * another conditional directive, so that nested blocks are skipped as a whole; nothing
+ * else on those lines is looked at. Every step is recorded in the order it is taken,
+ * under the directive it is taken at, and the second pass takes the recorded steps one
+ * after the other.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "defines.h"
+#include "intern.h"
+#include "lexer.h"
+#include "task.h"
+#include "parse.h"
+#include "cond.h"
+
+typedef struct condblock_t {
+        uint32_t line;
+        int in_else;
+} condblock_t;
+
+/* A step over left out lines, from the directive that starts it to the end of the ELSE
+   or ENDIF line that ends it. The directive is kept by its token, since the tokens of
+   every expansion are numbered from 0 again. */
+typedef struct condskip_t {
+        const token_t *directive;
+        uint32_t to;
+} condskip_t;
+
+static condblock_t *condblocks;
+static uint32_t condblocks_currentsize, condblocks_actualsize;
+
+static condskip_t *condskips;
+static uint32_t condskips_currentsize, condskips_actualsize;
+static uint32_t next_condskip;
+
+static uint32_t find_lineend(const tokenstream_t *tokenstream, uint32_t position) {
+        while(tokenstream->tokens[position].type != TOKEN_NEWLINE &&
+              tokenstream->tokens[position].type != TOKEN_COMMENT &&
+              tokenstream->tokens[position].type != TOKEN_END)
+                ++position;
+
+        return position;
+}
+
+/* Steps over the lines from the position on up to the ELSE or the ENDIF that belongs to
+   the block, and gives the position of the end of that line. */
+static uint32_t skip_block(const tokenstream_t *tokenstream, uint32_t position,
+                           atom_t *stop_directive) {
+        const token_t *tokens = tokenstream->tokens;
+        uint32_t depth;
+        atom_t atom;
+
+        depth = 0;
+        for(; tokens[position].type != TOKEN_END; ++position) {
+                if(tokens[position].type != TOKEN_NEWLINE ||
+                   tokens[position + 1].type != TOKEN_IDENTIFIER)
+                        continue;
+
+                atom = tokens[position + 1].atom;
+                if(atom < ATOM_IF || atom > ATOM_ENDIF)
+                        continue;
+
+                if(atom == ATOM_ENDIF && depth > 0)
+                        --depth;
+                else if(atom == ATOM_ENDIF || (atom == ATOM_ELSE && depth == 0)) {
+                        *stop_directive = atom;
+                        return find_lineend(tokenstream, position + 2);
+                }
+                else if(atom != ATOM_ELSE)
+                        ++depth;
+        }
+
+        return position;
+}
+
+static void record_condskip(const token_t *directive, uint32_t to) {
+        condskip_t *condskips_newlist;
+
+        if(condskips_currentsize == condskips_actualsize) {
+                condskips_newlist = realloc(condskips, (condskips_actualsize + 64) *
+                                            sizeof(*condskips_newlist));
+                if(condskips_newlist == NULL) {
+                        STDERR("the conditional blocks could not be recorded\n");
+                        EFAILURE;
+                }
+                condskips = condskips_newlist;
+                condskips_actualsize += 64;
+        }
+
+        condskips[condskips_currentsize].directive = directive;
+        condskips[condskips_currentsize++].to = to;
+}
+
+static void push_condblock(uint32_t line) {
+        condblock_t *condblocks_newlist;
+
+        if(condblocks_currentsize == condblocks_actualsize) {
+                condblocks_newlist = realloc(condblocks, (condblocks_actualsize + 16) *
+                                             sizeof(*condblocks_newlist));
+                if(condblocks_newlist == NULL) {
+                        STDERR("the conditional blocks could not be recorded\n");
+                        EFAILURE;
+                }
+                condblocks = condblocks_newlist;
+                condblocks_actualsize += 16;
+        }
+
+        condblocks[condblocks_currentsize].line = line;
+        condblocks[condblocks_currentsize++].in_else = 0;
+}
+
+/* Decides whether the lines after IF, IFDEF or IFNDEF are kept. */
+static int evaluate_condition(atom_t directive, const tokenrange_t *dir_arg,
+                              symboltable_t *symboltable_list, uint16_t location_counter,
+                              uint32_t line) {
+        uint32_t index;
+        uint16_t value;
+        int defined;
+
+        if(directive == ATOM_IF) {
+                if(evaluate_dirarg(dir_arg, location_counter, symboltable_list,
+                                   &value) != VALID) {
+                        STDERR("line %u: the value of IF must be known when it is met\n",
+                               line);
+                        EFAILURE;
+                }
+                return value != 0;
+        }
+
+        if(dir_arg->n_tokens != 1 || dir_arg->tokens[0].type != TOKEN_IDENTIFIER) {
+                STDERR("line %u: %s needs the name of a symbol\n", line,
+                       get_atomname(directive));
+                EFAILURE;
+        }
+        defined = lookup_symbol(dir_arg->tokens[0].atom, &index) == VALID &&
+                  symboltable_list[index].value_status != UNDEFINED;
+
+        return (directive == ATOM_IFDEF) ? defined : !defined;
+}
+
+void handle_conditional(tokenstream_t *tokenstream, atom_t directive,
+                        symboltable_t *symboltable_list, uint16_t location_counter,
+                        line_status_t *line_status) {
+        tokenrange_t dir_arg;
+        uint32_t word, line, from;
+        atom_t stop_directive;
+
+        word = tokenstream->position - 1;
+        line = tokenstream->tokens[word].line;
+        if(word > 0 && tokenstream->tokens[word - 1].type != TOKEN_NEWLINE) {
+                STDERR("line %u: %s must be the first word of its line\n", line,
+                       get_atomname(directive));
+                EFAILURE;
+        }
+
+        extract_direxpression(tokenstream, line_status, &dir_arg);
+        from = tokenstream->position;
+        stop_directive = ATOM_NONE;
+
+        if(directive == ATOM_ELSE) {
+                if(condblocks_currentsize == 0 ||
+                   condblocks[condblocks_currentsize - 1].in_else) {
+                        STDERR("line %u: ELSE without IF\n", line);
+                        EFAILURE;
+                }
+                tokenstream->position = skip_block(tokenstream, from, &stop_directive);
+                if(stop_directive == ATOM_ELSE) {
+                        STDERR("line %u: ELSE without IF\n",
+                               tokenstream->tokens[tokenstream->position].line);
+                        EFAILURE;
+                }
+        }
+        else if(directive == ATOM_ENDIF) {
+                if(condblocks_currentsize == 0) {
+                        STDERR("line %u: ENDIF without IF\n", line);
+                        EFAILURE;
+                }
+                --condblocks_currentsize;
+                return;
+        }
+        else {
+                push_condblock(line);
+                if(evaluate_condition(directive, &dir_arg, symboltable_list,
+                                      location_counter, line))
+                        return;
+                tokenstream->position = skip_block(tokenstream, from, &stop_directive);
+        }
+
+        if(stop_directive == ATOM_NONE) {
+                STDERR("line %u: IF without ENDIF\n",
+                       condblocks[condblocks_currentsize - 1].line);
+                EFAILURE;
+        }
+        if(stop_directive == ATOM_ELSE)
+                condblocks[condblocks_currentsize - 1].in_else = 1;
+        else
+                --condblocks_currentsize;
+
+        record_condskip(&tokenstream->tokens[word], tokenstream->position);
+        *line_status = get_linestatus(tokenstream);
+}
+
+/* Checks at the end of the first pass that every block was closed. */
+void end_conditionals(void) {
+        if(condblocks_currentsize > 0) {
+                STDERR("line %u: IF without ENDIF\n",
+                       condblocks[condblocks_currentsize - 1].line);
+                EFAILURE;
+        }
+}
+
+void replay_conditional(tokenstream_t *tokenstream, line_status_t *line_status) {
+        const token_t *directive;
+
+        directive = &tokenstream->tokens[tokenstream->position - 1];
+        tokenstream->position = find_lineend(tokenstream, tokenstream->position);
+
+        if(next_condskip < condskips_currentsize &&
+           condskips[next_condskip].directive == directive)
+                tokenstream->position = condskips[next_condskip++].to;
+
+        *line_status = get_linestatus(tokenstream);
+}
+
+void free_conditionals(void) {
+        free(condblocks);
+        condblocks = NULL;
+        condblocks_currentsize = condblocks_actualsize = 0;
+
+        free(condskips);
+        condskips = NULL;
+        condskips_currentsize = condskips_actualsize = next_condskip = 0;
+}
@@ -0,0 +1,45 @@
+// File: cond.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains conditional assembly. IF, IFDEF and IFNDEF are decided in the
+ * first pass, and the lines they leave out are stepped over without being parsed. The
+ * second pass takes the same steps as the first, since a symbol defined later would
+ * otherwise change the outcome of IFDEF between the passes.
+ */
+
+#ifndef COND_H
+#define COND_H
+
+#include "defines.h"
+#include "lexer.h"
+
+void handle_conditional(tokenstream_t *tokenstream, atom_t directive,
+                        symboltable_t *symboltable_list, uint16_t location_counter,
+                        line_status_t *line_status);
+
+void end_conditionals(void);
+
+void replay_conditional(tokenstream_t *tokenstream, line_status_t *line_status);
+
+void free_conditionals(void);
+
+#endif
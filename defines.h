@@ -25,6 +25,7 @@
 #include <stdint.h>
 
 #define STDERR(str, ...) fprintf(stderr, "error: " str, ##__VA_ARGS__)
+#define WARNING(str, ...) fprintf(stderr, "warning: " str, ##__VA_ARGS__)
 #define EFAILURE exit(EXIT_FAILURE);
 #define ESUCCESS exit(EXIT_SUCCESS);
 #define DEBUG(str, ...) fprintf(stdout, str, ##__VA_ARGS__)
@@ -99,6 +100,10 @@
 
 #define UNDEFINED 0
 #define DEFINED 1
+// the symbol is defined by an expression whose value is not known yet
+#define DEFERRED 2
+// the value of the symbol is given by the linker: it is EXTERN or names a floating section
+#define RELOCATABLE 3
 
 typedef enum loop_status_t {EXIT = 0, CONTINUE} loop_status_t;
 typedef enum action_status_t{STOP_ACTION = 0, LOOKFOR_NONWHITESPACE,
@@ -111,6 +116,8 @@ typedef enum line_status_t {ENDOFFILE_DETECTED = 0, NEWLINE_DETECTED,
                             NONE_DETECTED} line_status_t;
 typedef enum status_t {ERROR = 0, NO_ERROR} status_t;
 typedef enum data_status_t {VALIDITY_UNKNOWN = 0, INVALID, VALID} data_status_t;
+typedef enum report_format_t {REPORT_NONE = 0, REPORT_TEXT, REPORT_JSON} report_format_t;
+typedef uint32_t atom_t;
 
 typedef struct instruction_parameters_t {
         char *instruction_name;
@@ -122,11 +129,16 @@ typedef struct instruction_parameters_t {
 } instruction_parameters_t;
 
 typedef struct symboltable_t {
-        char *name;
+        const char *name;
         uint8_t value_type;
         uint8_t value_nbytes;
         uint8_t value[2];
         uint8_t value_status;
+        struct exprnode_t *value_expression;
+        // the bank a label was defined in; 0 for every other symbol
+        uint8_t bank;
+        // set for a symbol read from a symbol file, which a symbol of the source hides
+        uint8_t imported;
 } symboltable_t; 
 
 #endif
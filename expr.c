@@ -0,0 +1,695 @@
+// File: expr.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the expression compiler and evaluator. Expressions are parsed by
+ * precedence climbing with the precedence of C, from highest to lowest:
+ *
+ *      - ~ + HIGH LOW BANK     (unary)
+ *      * / %
+ *      + -
+ *      << >>
+ *      &
+ *      ^
+ *      |
+ *
+ * $ stands for the address of the instruction or directive the expression is part of,
+ * and BANK label for the number of the bank the label was defined in.
+ * In a floating section, whose address is not known before it is placed, it stands for
+ * the symbol of the section moved by the offset into the section.
+ * Arithmetic wraps around at 16 bits. Since %1010 is a binary number, a % that follows
+ * an operand and is directly followed by digits is taken as the remainder operator.
+ *
+ * When a module is assembled, an expression that depends on a symbol given its value by
+ * the linker is split into that symbol and the offset added to it, for a relocation.
+ *
+ * The expressions of operands are recorded under their first token, so that the second
+ * pass finds the tree compiled by the first pass instead of compiling it again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defines.h"
+#include "arena.h"
+#include "intern.h"
+#include "lexer.h"
+#include "task.h"
+#include "expr.h"
+
+typedef struct exprparser_t {
+        const token_t *token, *end;
+        /* A number that followed a % operator, whose digits are the right operand. */
+        const token_t *pending;
+        uint16_t address;
+        symboltable_t *symboltable_list;
+} exprparser_t;
+
+typedef struct exprrecord_t {
+        const token_t *first;
+        exprnode_t *node;
+} exprrecord_t;
+
+static arena_t *expression_arena;
+static atom_t high_atom, low_atom;
+static exprrecord_t *expression_records;
+static uint32_t records_currentsize, records_actualsize;
+static int records_sorted;
+static atom_t address_base;
+/* Until the first pass is over, the source may still define a symbol that hides one
+   read from a symbol file, so a value taken from a symbol file is not remembered. */
+static int imports_settled;
+static int tentative_value;
+
+static exprnode_t *parse_binary(exprparser_t *parser, int min_precedence);
+
+status_t init_expressions(arena_t *arena) {
+        expression_arena = arena;
+        expression_records = NULL;
+        records_currentsize = records_actualsize = 0;
+        records_sorted = 1;
+        address_base = ATOM_NONE;
+        imports_settled = 0;
+        tentative_value = 0;
+
+        high_atom = intern_string("HIGH", 4);
+        low_atom = intern_string("LOW", 3);
+        if(high_atom == ATOM_NONE || low_atom == ATOM_NONE)
+                return ERROR;
+
+        return NO_ERROR;
+}
+
+void free_expressions(void) {
+        free(expression_records);
+        expression_records = NULL;
+        records_currentsize = records_actualsize = 0;
+}
+
+static uint8_t get_valuetype(uint16_t value) {
+        return (value < 256) ? VALUE_8_BIT : VALUE_16_BIT;
+}
+
+static int testif_punctuation(const token_t *token, const char *punctuation) {
+        return token->type == TOKEN_PUNCTUATION &&
+                token->length == strlen(punctuation) &&
+                !memcmp(token->text, punctuation, token->length);
+}
+
+static exprnode_t *new_node(uint8_t operation, uint32_t line) {
+        exprnode_t *node;
+
+        node = reserve_inarena(expression_arena, sizeof(*node));
+        if(node != NULL) {
+                memset(node, 0, sizeof(*node));
+                node->operation = operation;
+                node->line = line;
+        }
+
+        return node;
+}
+
+static data_status_t evaluate_symbolentry(symboltable_t *entry,
+                                          symboltable_t *symboltable_list,
+                                          uint16_t *value) {
+        exprnode_t *node;
+        data_status_t data_status;
+
+        if(entry->value_status == DEFINED) {
+                if(entry->value_nbytes == 1)
+                        *value = entry->value[0];
+                else
+                        *value = entry->value[0] | (entry->value[1] << 8);
+                return VALID;
+        }
+        if(entry->value_status != DEFERRED)
+                return INVALID;
+
+        node = entry->value_expression;
+        if(node->state == EXPR_EVALUATING) {
+                STDERR("line %u: the symbol \"%s\" is defined in terms of itself\n",
+                       node->line, entry->name);
+                EFAILURE;
+        }
+
+        node->state = EXPR_EVALUATING;
+        data_status = evaluate_expression(node, symboltable_list, value);
+        if(data_status != VALID || tentative_value) {
+                node->state = EXPR_UNRESOLVED;
+                return data_status;
+        }
+
+        entry->value[0] = (uint8_t) *value;
+        entry->value[1] = (uint8_t) (*value >> 8);
+        entry->value_nbytes = (entry->value_type == VALUE_8_BIT) ? 1 : 2;
+        entry->value_status = DEFINED;
+
+        return VALID;
+}
+
+data_status_t evaluate_expression(exprnode_t *node, symboltable_t *symboltable_list,
+                                  uint16_t *value) {
+        uint16_t left, right, result;
+        uint32_t index;
+        int outer_tentative;
+
+        if(node->state == EXPR_RESOLVED) {
+                *value = node->value;
+                return VALID;
+        }
+
+        outer_tentative = tentative_value;
+        tentative_value = 0;
+
+        if(node->operation == EXPR_SYMBOL) {
+                if(lookup_symbol(node->symbol, &index) == INVALID ||
+                   evaluate_symbolentry(&symboltable_list[index], symboltable_list,
+                                        &result) != VALID) {
+                        tentative_value = outer_tentative;
+                        return INVALID;
+                }
+                if(symboltable_list[index].imported && !imports_settled)
+                        tentative_value = 1;
+        }
+        else {
+                if(evaluate_expression(node->left, symboltable_list, &left) != VALID ||
+                   (node->right != NULL &&
+                    evaluate_expression(node->right, symboltable_list, &right) != VALID)) {
+                        tentative_value = outer_tentative;
+                        return INVALID;
+                }
+
+                switch(node->operation) {
+                case EXPR_NEGATE:
+                        result = -left;
+                        break;
+                case EXPR_COMPLEMENT:
+                        result = ~left;
+                        break;
+                case EXPR_HIGH:
+                        result = left >> 8;
+                        break;
+                case EXPR_LOW:
+                        result = left & 0xFF;
+                        break;
+                case EXPR_BANK:
+                        lookup_symbol(node->left->symbol, &index);
+                        result = symboltable_list[index].bank;
+                        break;
+                case EXPR_MULTIPLY:
+                        result = left * right;
+                        break;
+                case EXPR_DIVIDE:
+                case EXPR_REMAINDER:
+                        if(right == 0) {
+                                STDERR("line %u: division by zero\n", node->line);
+                                EFAILURE;
+                        }
+                        result = (node->operation == EXPR_DIVIDE) ? left / right :
+                                left % right;
+                        break;
+                case EXPR_ADD:
+                        result = left + right;
+                        break;
+                case EXPR_SUBTRACT:
+                        result = left - right;
+                        break;
+                case EXPR_SHIFTLEFT:
+                        result = (right < 16) ? left << right : 0;
+                        break;
+                case EXPR_SHIFTRIGHT:
+                        result = (right < 16) ? left >> right : 0;
+                        break;
+                case EXPR_AND:
+                        result = left & right;
+                        break;
+                case EXPR_XOR:
+                        result = left ^ right;
+                        break;
+                default:
+                        result = left | right;
+                        break;
+                }
+        }
+
+        *value = result;
+        if(tentative_value) {
+                tentative_value = 1;
+                return VALID;
+        }
+        tentative_value = outer_tentative;
+        node->value = result;
+        node->state = EXPR_RESOLVED;
+
+        return VALID;
+}
+
+/* Gives the type of a value that is not an address: its width if it is known already,
+   two bytes otherwise. */
+static uint8_t get_nodevaluetype(exprparser_t *parser, exprnode_t *node) {
+        uint16_t value;
+
+        if(evaluate_expression(node, parser->symboltable_list, &value) == VALID)
+                return get_valuetype(value);
+
+        return VALUE_16_BIT;
+}
+
+static exprnode_t *make_unary(exprparser_t *parser, uint8_t operation,
+                              const token_t *token) {
+        exprnode_t *node, *operand;
+
+        operand = parse_binary(parser, 6);
+        if(operand == NULL)
+                return NULL;
+
+        node = new_node(operation, token->line);
+        if(node == NULL)
+                return NULL;
+        node->left = operand;
+
+        /* Only a name has a bank. */
+        if(operation == EXPR_BANK && operand->operation != EXPR_SYMBOL)
+                return NULL;
+
+        if(operation == EXPR_HIGH || operation == EXPR_LOW || operation == EXPR_BANK)
+                node->type = VALUE_8_BIT;
+        else
+                node->type = get_nodevaluetype(parser, node);
+
+        return node;
+}
+
+static exprnode_t *parse_primary(exprparser_t *parser) {
+        const token_t *token;
+        token_t digits;
+        exprnode_t *node;
+        uint16_t value;
+        uint8_t byte_length;
+        uint32_t index;
+
+        if(parser->pending != NULL) {
+                digits = *parser->pending;
+                ++digits.text;
+                --digits.length;
+                parser->pending = NULL;
+                token = &digits;
+        }
+        else {
+                if(parser->token >= parser->end)
+                        return NULL;
+                token = parser->token++;
+        }
+
+        if(testif_punctuation(token, "(")) {
+                node = parse_binary(parser, 0);
+                if(node == NULL || parser->token >= parser->end ||
+                   !testif_punctuation(parser->token, ")"))
+                        return NULL;
+                ++parser->token;
+                return node;
+        }
+
+        if(testif_punctuation(token, "-"))
+                return make_unary(parser, EXPR_NEGATE, token);
+        if(testif_punctuation(token, "~"))
+                return make_unary(parser, EXPR_COMPLEMENT, token);
+        if(testif_punctuation(token, "+"))
+                return parse_binary(parser, 6);
+        if(token->type == TOKEN_IDENTIFIER && token->atom == high_atom)
+                return make_unary(parser, EXPR_HIGH, token);
+        if(token->type == TOKEN_IDENTIFIER && token->atom == low_atom)
+                return make_unary(parser, EXPR_LOW, token);
+        if(token->type == TOKEN_IDENTIFIER && token->atom == ATOM_BANK)
+                return make_unary(parser, EXPR_BANK, token);
+
+        if(testif_punctuation(token, "$") && address_base != ATOM_NONE)
+                return compile_address(address_base, parser->address);
+        if(testif_punctuation(token, "$")) {
+                node = new_node(EXPR_LITERAL, token->line);
+                if(node != NULL) {
+                        node->value = parser->address;
+                        node->type = MEMORY_16_BIT;
+                        node->state = EXPR_RESOLVED;
+                }
+                return node;
+        }
+
+        if(parse_literal(token, &value, &byte_length) == VALID) {
+                node = new_node(EXPR_LITERAL, token->line);
+                if(node != NULL) {
+                        node->value = value;
+                        node->type = get_valuetype(value);
+                        node->state = EXPR_RESOLVED;
+                }
+                return node;
+        }
+
+        if(token->type != TOKEN_IDENTIFIER)
+                return NULL;
+
+        node = new_node(EXPR_SYMBOL, token->line);
+        if(node == NULL)
+                return NULL;
+        node->symbol = token->atom;
+
+        /* A symbol that is not defined yet is taken to be an address, as a forward
+           reference to a label always is. */
+        node->type = MEMORY_16_BIT;
+        if(lookup_symbol(token->atom, &index) == VALID) {
+                node->type = parser->symboltable_list[index].value_type;
+                if(node->type != VALUE_8_BIT && node->type != VALUE_16_BIT &&
+                   node->type != MEMORY_16_BIT)
+                        return NULL;
+                evaluate_expression(node, parser->symboltable_list, &value);
+        }
+
+        return node;
+}
+
+static int get_binaryoperator(exprparser_t *parser, uint8_t *operation) {
+        const token_t *token;
+
+        if(parser->token >= parser->end)
+                return -1;
+        token = parser->token;
+
+        if(token->type == TOKEN_NUMBER && token->text[0] == '%') {
+                *operation = EXPR_REMAINDER;
+                return 5;
+        }
+        if(token->type != TOKEN_PUNCTUATION)
+                return -1;
+
+        if(token->length == 2) {
+                if(!memcmp(token->text, "<<", 2)) {
+                        *operation = EXPR_SHIFTLEFT;
+                        return 3;
+                }
+                if(!memcmp(token->text, ">>", 2)) {
+                        *operation = EXPR_SHIFTRIGHT;
+                        return 3;
+                }
+                return -1;
+        }
+
+        switch(token->text[0]) {
+        case '*':
+                *operation = EXPR_MULTIPLY;
+                return 5;
+        case '/':
+                *operation = EXPR_DIVIDE;
+                return 5;
+        case '%':
+                *operation = EXPR_REMAINDER;
+                return 5;
+        case '+':
+                *operation = EXPR_ADD;
+                return 4;
+        case '-':
+                *operation = EXPR_SUBTRACT;
+                return 4;
+        case '&':
+                *operation = EXPR_AND;
+                return 2;
+        case '^':
+                *operation = EXPR_XOR;
+                return 1;
+        case '|':
+                *operation = EXPR_OR;
+                return 0;
+        }
+
+        return -1;
+}
+
+static exprnode_t *parse_binary(exprparser_t *parser, int min_precedence) {
+        exprnode_t *left, *right, *node;
+        const token_t *token;
+        uint8_t operation;
+        int precedence;
+
+        left = parse_primary(parser);
+
+        while(left != NULL && parser->pending == NULL &&
+              (precedence = get_binaryoperator(parser, &operation)) >= min_precedence) {
+                token = parser->token++;
+                if(token->type == TOKEN_NUMBER)
+                        parser->pending = token;
+
+                right = parse_binary(parser, precedence + 1);
+                if(right == NULL)
+                        return NULL;
+
+                node = new_node(operation, token->line);
+                if(node == NULL)
+                        return NULL;
+                node->left = left;
+                node->right = right;
+
+                /* An address moved by an offset is still an address, while the
+                   distance between two addresses is not. */
+                if(operation == EXPR_ADD &&
+                   (left->type == MEMORY_16_BIT) != (right->type == MEMORY_16_BIT))
+                        node->type = MEMORY_16_BIT;
+                else if(operation == EXPR_SUBTRACT && left->type == MEMORY_16_BIT &&
+                        right->type != MEMORY_16_BIT)
+                        node->type = MEMORY_16_BIT;
+                else
+                        node->type = get_nodevaluetype(parser, node);
+
+                left = node;
+        }
+
+        return left;
+}
+
+/* Compiles the tokens into an expression tree. The parts that are already known are
+   evaluated right away. NULL is returned if the tokens are not a valid expression. */
+exprnode_t *compile_expression(const token_t *tokens, uint32_t n_tokens, uint16_t address,
+                               symboltable_t *symboltable_list) {
+        exprparser_t parser;
+        exprnode_t *node;
+
+        parser.token = tokens;
+        parser.end = tokens + n_tokens;
+        parser.pending = NULL;
+        parser.address = address;
+        parser.symboltable_list = symboltable_list;
+
+        node = parse_binary(&parser, 0);
+        if(node == NULL || parser.token != parser.end || parser.pending != NULL)
+                return NULL;
+
+        return node;
+}
+
+/* Gives the address the given number of bytes into the floating section whose symbol
+   is base, as the expression base+offset. */
+exprnode_t *compile_address(atom_t base, uint16_t offset) {
+        exprnode_t *node;
+
+        node = new_node(EXPR_ADD, 0);
+        if(node == NULL)
+                return NULL;
+        node->type = MEMORY_16_BIT;
+
+        node->left = new_node(EXPR_SYMBOL, 0);
+        node->right = new_node(EXPR_LITERAL, 0);
+        if(node->left == NULL || node->right == NULL)
+                return NULL;
+        node->left->symbol = base;
+        node->left->type = MEMORY_16_BIT;
+        node->right->value = offset;
+        node->right->type = get_valuetype(offset);
+        node->right->state = EXPR_RESOLVED;
+
+        return node;
+}
+
+/* Makes $ stand for an address in the floating section whose symbol is base, or for
+   the address itself again if base is ATOM_NONE. */
+void set_addressbase(atom_t base) {
+        address_base = base;
+}
+
+/* Works out the value of every symbol defined by an expression that could not be
+   evaluated when the symbol was defined. The symbols of the symbol files that the
+   source did not hide are final from here on. */
+status_t resolve_deferredsymbols(symboltable_t *symboltable_list,
+                                 uint32_t symboltable_currentsize) {
+        uint32_t index;
+        uint16_t value;
+        status_t status;
+
+        status = NO_ERROR;
+        imports_settled = 1;
+
+        for(index = 0; index < symboltable_currentsize; ++index) {
+                if(symboltable_list[index].value_status == DEFERRED &&
+                   evaluate_symbolentry(&symboltable_list[index], symboltable_list,
+                                        &value) != VALID &&
+                   testif_relocatable(symboltable_list[index].value_expression,
+                                      symboltable_list) != VALID) {
+                        STDERR("the value of \"%s\" depends on an undefined symbol\n",
+                               symboltable_list[index].name);
+                        status = ERROR;
+                }
+        }
+
+        return status;
+}
+
+/* Splits an expression that depends on a symbol given its value by the linker into that
+   symbol and the offset added to it. The expression must come down to the symbol moved
+   by a known value; the distance between two addresses relative to the same symbol is
+   known, and gives ATOM_NONE as the symbol. */
+data_status_t split_relocation(exprnode_t *node, symboltable_t *symboltable_list,
+                               atom_t *symbol, uint16_t *offset) {
+        symboltable_t *entry;
+        exprnode_t *definition;
+        atom_t left_symbol, right_symbol;
+        uint16_t left, right;
+        uint32_t index;
+        data_status_t data_status;
+
+        if(evaluate_expression(node, symboltable_list, offset) == VALID) {
+                *symbol = ATOM_NONE;
+                return VALID;
+        }
+
+        if(node->operation == EXPR_SYMBOL) {
+                if(lookup_symbol(node->symbol, &index) == INVALID)
+                        return INVALID;
+                entry = &symboltable_list[index];
+                if(entry->value_status == RELOCATABLE) {
+                        *symbol = node->symbol;
+                        *offset = 0;
+                        return VALID;
+                }
+                if(entry->value_status != DEFERRED)
+                        return INVALID;
+
+                definition = entry->value_expression;
+                if(definition->state == EXPR_EVALUATING) {
+                        STDERR("line %u: the symbol \"%s\" is defined in terms of "
+                               "itself\n", definition->line, entry->name);
+                        EFAILURE;
+                }
+                definition->state = EXPR_EVALUATING;
+                data_status = split_relocation(definition, symboltable_list, symbol,
+                                               offset);
+                definition->state = EXPR_UNRESOLVED;
+                return data_status;
+        }
+
+        if(node->operation != EXPR_ADD && node->operation != EXPR_SUBTRACT)
+                return INVALID;
+        if(split_relocation(node->left, symboltable_list, &left_symbol, &left) != VALID ||
+           split_relocation(node->right, symboltable_list, &right_symbol,
+                            &right) != VALID)
+                return INVALID;
+
+        if(node->operation == EXPR_ADD) {
+                if(left_symbol != ATOM_NONE && right_symbol != ATOM_NONE)
+                        return INVALID;
+                *symbol = (left_symbol != ATOM_NONE) ? left_symbol : right_symbol;
+                *offset = left + right;
+        }
+        else {
+                if(right_symbol != ATOM_NONE && right_symbol != left_symbol)
+                        return INVALID;
+                *symbol = (right_symbol != ATOM_NONE) ? ATOM_NONE : left_symbol;
+                *offset = left - right;
+        }
+
+        return VALID;
+}
+
+/* Tells whether the expression can be given its value by the linker. */
+data_status_t testif_relocatable(exprnode_t *node, symboltable_t *symboltable_list) {
+        atom_t symbol;
+        uint16_t offset;
+
+        if(split_relocation(node, symboltable_list, &symbol, &offset) != VALID ||
+           symbol == ATOM_NONE)
+                return INVALID;
+
+        return VALID;
+}
+
+static int compare_records(const void *record1, const void *record2) {
+        const token_t *first1 = ((const exprrecord_t *) record1)->first;
+        const token_t *first2 = ((const exprrecord_t *) record2)->first;
+
+        return (first1 > first2) - (first1 < first2);
+}
+
+status_t record_expression(const token_t *first, exprnode_t *node) {
+        exprrecord_t *expression_newrecords;
+
+        if(records_currentsize == records_actualsize) {
+                expression_newrecords = realloc(expression_records,
+                                                (records_actualsize * 2 + 16) *
+                                                sizeof(*expression_newrecords));
+                if(expression_newrecords == NULL)
+                        return ERROR;
+                expression_records = expression_newrecords;
+                records_actualsize = records_actualsize * 2 + 16;
+        }
+
+        /* The first pass meets the expressions in the order of the source, so the
+           records normally stay sorted without any effort. */
+        if(records_currentsize > 0 &&
+           expression_records[records_currentsize - 1].first > first)
+                records_sorted = 0;
+
+        expression_records[records_currentsize].first = first;
+        expression_records[records_currentsize].node = node;
+        ++records_currentsize;
+
+        return NO_ERROR;
+}
+
+exprnode_t *find_expression(const token_t *first) {
+        uint32_t low, high, middle;
+
+        if(!records_sorted) {
+                qsort(expression_records, records_currentsize,
+                      sizeof(*expression_records), compare_records);
+                records_sorted = 1;
+        }
+
+        low = 0;
+        high = records_currentsize;
+        while(low < high) {
+                middle = low + (high - low) / 2;
+                if(expression_records[middle].first < first)
+                        low = middle + 1;
+                else
+                        high = middle;
+        }
+
+        if(low < records_currentsize && expression_records[low].first == first)
+                return expression_records[low].node;
+
+        return NULL;
+}
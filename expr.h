@@ -0,0 +1,86 @@
+// File: expr.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the constant expressions used as operands and directive arguments.
+ * An expression is compiled once into a tree of nodes kept in the arena. A node is
+ * evaluated when its value is asked for and remembers the value once every symbol it
+ * depends on is defined, so forward references are resolved as soon as they can be and
+ * never more than once.
+ */
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stdint.h>
+#include "defines.h"
+#include "arena.h"
+#include "lexer.h"
+
+typedef enum expr_operation_t {EXPR_LITERAL = 0, EXPR_SYMBOL, EXPR_NEGATE,
+                               EXPR_COMPLEMENT, EXPR_HIGH, EXPR_LOW, EXPR_MULTIPLY,
+                               EXPR_DIVIDE, EXPR_REMAINDER, EXPR_ADD, EXPR_SUBTRACT,
+                               EXPR_SHIFTLEFT, EXPR_SHIFTRIGHT, EXPR_AND, EXPR_XOR,
+                               EXPR_OR, EXPR_BANK} expr_operation_t;
+
+typedef enum expr_state_t {EXPR_UNRESOLVED = 0, EXPR_EVALUATING,
+                           EXPR_RESOLVED} expr_state_t;
+
+typedef struct exprnode_t {
+        uint8_t operation;
+        uint8_t state;
+        /* The operand type of the value: MEMORY_16_BIT for an address, VALUE_8_BIT or
+           VALUE_16_BIT otherwise. It is settled when the node is compiled so that both
+           passes agree on the size of the instruction. */
+        uint8_t type;
+        uint16_t value;
+        uint32_t line;
+        atom_t symbol;
+        struct exprnode_t *left, *right;
+} exprnode_t;
+
+status_t init_expressions(arena_t *arena);
+
+void free_expressions(void);
+
+exprnode_t *compile_expression(const token_t *tokens, uint32_t n_tokens, uint16_t address,
+                               symboltable_t *symboltable_list);
+
+data_status_t evaluate_expression(exprnode_t *node, symboltable_t *symboltable_list,
+                                  uint16_t *value);
+
+exprnode_t *compile_address(atom_t base, uint16_t offset);
+
+void set_addressbase(atom_t base);
+
+status_t resolve_deferredsymbols(symboltable_t *symboltable_list,
+                                 uint32_t symboltable_currentsize);
+
+data_status_t split_relocation(exprnode_t *node, symboltable_t *symboltable_list,
+                               atom_t *symbol, uint16_t *offset);
+
+data_status_t testif_relocatable(exprnode_t *node, symboltable_t *symboltable_list);
+
+status_t record_expression(const token_t *first, exprnode_t *node);
+
+exprnode_t *find_expression(const token_t *first);
+
+#endif
@@ -0,0 +1,152 @@
+// File: hash.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the hash table. Entries are kept in a single array with linear
+ * probing; the array is doubled whenever it becomes half full so that probe sequences
+ * stay short. The hash of every key is stored next to it, which lets most mismatches
+ * be rejected without comparing the strings.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "defines.h"
+#include "hash.h"
+#include "stats.h"
+
+static status_t grow_hashtable(hashtable_t *hashtable, uint32_t capacity) {
+        hashentry_t *entries;
+        uint32_t index, slot, mask;
+
+        entries = calloc(capacity, sizeof(*entries));
+        if(entries == NULL)
+                return ERROR;
+
+        mask = capacity - 1;
+        for(index = 0; index < hashtable->capacity; ++index) {
+                if(hashtable->entries[index].key == NULL)
+                        continue;
+                slot = hashtable->entries[index].hash & mask;
+                while(entries[slot].key != NULL)
+                        slot = (slot + 1) & mask;
+                entries[slot] = hashtable->entries[index];
+        }
+
+        free(hashtable->entries);
+        hashtable->entries = entries;
+        hashtable->capacity = capacity;
+
+        return NO_ERROR;
+}
+
+status_t init_hashtable(hashtable_t *hashtable, uint32_t expected_entries) {
+        uint32_t capacity;
+
+        capacity = 16;
+        while(capacity < 2 * expected_entries)
+                capacity *= 2;
+
+        hashtable->entries = NULL;
+        hashtable->capacity = 0;
+        hashtable->n_entries = 0;
+
+        return grow_hashtable(hashtable, capacity);
+}
+
+void free_hashtable(hashtable_t *hashtable) {
+        free(hashtable->entries);
+        hashtable->entries = NULL;
+        hashtable->capacity = 0;
+        hashtable->n_entries = 0;
+}
+
+/* FNV-1a */
+uint32_t get_hash(const char *key, size_t length) {
+        uint32_t hash = 2166136261u;
+
+        while(length-- > 0) {
+                hash ^= (uint8_t) *key++;
+                hash *= 16777619u;
+        }
+
+        return hash;
+}
+
+static int testif_keyequal(hashentry_t *entry, uint32_t hash, const char *key,
+                           size_t length) {
+        if(entry->hash != hash || entry->length != length)
+                return 0;
+        COUNT(strcmp_calls);
+        return !memcmp(entry->key, key, length);
+}
+
+status_t insert_hashtable(hashtable_t *hashtable, const char *key, size_t length,
+                          uint32_t value) {
+        uint32_t hash, slot, mask;
+
+        /* A zeroed table has no entries yet and starts at the smallest capacity. */
+        if(2 * (hashtable->n_entries + 1) > hashtable->capacity &&
+           grow_hashtable(hashtable, hashtable->capacity ? 2 * hashtable->capacity :
+                          16) == ERROR)
+                return ERROR;
+
+        hash = get_hash(key, length);
+        mask = hashtable->capacity - 1;
+        slot = hash & mask;
+
+        while(hashtable->entries[slot].key != NULL) {
+                if(testif_keyequal(&hashtable->entries[slot], hash, key, length)) {
+                        hashtable->entries[slot].value = value;
+                        return NO_ERROR;
+                }
+                slot = (slot + 1) & mask;
+        }
+
+        hashtable->entries[slot].key = key;
+        hashtable->entries[slot].length = length;
+        hashtable->entries[slot].hash = hash;
+        hashtable->entries[slot].value = value;
+        ++hashtable->n_entries;
+
+        return NO_ERROR;
+}
+
+data_status_t lookup_hashtable(hashtable_t *hashtable, const char *key, size_t length,
+                               uint32_t *value) {
+        uint32_t hash, slot, mask;
+
+        if(hashtable->capacity == 0)
+                return INVALID;
+
+        hash = get_hash(key, length);
+        mask = hashtable->capacity - 1;
+        slot = hash & mask;
+
+        while(hashtable->entries[slot].key != NULL) {
+                if(testif_keyequal(&hashtable->entries[slot], hash, key, length)) {
+                        *value = hashtable->entries[slot].value;
+                        return VALID;
+                }
+                slot = (slot + 1) & mask;
+        }
+
+        return INVALID;
+}
@@ -0,0 +1,61 @@
+// File: hash.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains a hash table mapping names to 32-bit values. It backs the intern
+ * table, so that looking a name up does not depend on how many names are stored. Keys
+ * are given as a pointer and a length and need not be NUL-terminated. The table does
+ * not own the names; they must stay valid for as long as they are in the table.
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "defines.h"
+
+typedef struct hashentry_t {
+        const char *key;
+        uint32_t length;
+        uint32_t hash;
+        uint32_t value;
+} hashentry_t;
+
+typedef struct hashtable_t {
+        hashentry_t *entries;
+        uint32_t capacity;
+        uint32_t n_entries;
+} hashtable_t;
+
+status_t init_hashtable(hashtable_t *hashtable, uint32_t expected_entries);
+
+void free_hashtable(hashtable_t *hashtable);
+
+uint32_t get_hash(const char *key, size_t length);
+
+status_t insert_hashtable(hashtable_t *hashtable, const char *key, size_t length,
+                          uint32_t value);
+
+data_status_t lookup_hashtable(hashtable_t *hashtable, const char *key, size_t length,
+                               uint32_t *value);
+
+#endif
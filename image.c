@@ -0,0 +1,434 @@
+// File: image.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the output image. Space is reserved in the image before it is
+ * filled in, so that an instruction is copied in with memcpy and a block of data with
+ * a single memcpy or memset. A run is continued as long as each reservation starts
+ * where the previous one ended; any other address starts a new run, and with it a new
+ * record in the HEX file.
+ *
+ * The physical addresses of banked code go past 64K, so the HEX file gives their upper
+ * 16 bits in an extended linear address record (type 04) whenever they change. A program
+ * without banks is written without one.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "defines.h"
+#include "stats.h"
+#include "source.h"
+#include "sourcemap.h"
+#include "image.h"
+
+/* The number of data bytes in a HEX record. */
+#define HEXRECORD_LENGTH 16
+
+/* The addresses a run takes, from first up to the address before end. */
+typedef struct imageinterval_t {
+        uint32_t first, end;
+        uint32_t run;
+} imageinterval_t;
+
+void init_outputimage(outputimage_t *outputimage) {
+        outputimage->bytes = NULL;
+        outputimage->size = outputimage->capacity = 0;
+        outputimage->runs = NULL;
+        outputimage->n_runs = outputimage->runs_capacity = 0;
+        outputimage->statements = NULL;
+        outputimage->n_statements = outputimage->statements_capacity = 0;
+        outputimage->banked = outputimage->bank = 0;
+        outputimage->window_first = 0;
+        outputimage->window_end = 0x10000;
+        outputimage->window_physical = 0;
+        outputimage->section = NO_SECTION;
+}
+
+/* Emits the bytes that follow through the window of the bank, from first up to the
+   address before end, which shows the physical memory from the given address on. */
+void map_imagewindow(outputimage_t *outputimage, uint8_t bank, uint16_t first,
+                     uint32_t end, uint32_t physical) {
+        outputimage->banked = 1;
+        outputimage->bank = bank;
+        outputimage->window_first = first;
+        outputimage->window_end = end;
+        outputimage->window_physical = physical;
+}
+
+void free_outputimage(outputimage_t *outputimage) {
+        free(outputimage->bytes);
+        free(outputimage->runs);
+        free(outputimage->statements);
+        init_outputimage(outputimage);
+}
+
+/* Gives room for length bytes at the address, emitted by the statement that starts
+   with the given token. The room stays valid until the next reservation. */
+static uint8_t *extend_image(outputimage_t *outputimage, uint16_t address,
+                             uint32_t length, const token_t *statement) {
+        uint8_t *newbytes;
+        imagerun_t *newruns, *run;
+        uint32_t capacity, physical;
+
+        physical = address;
+        if(outputimage->banked) {
+                if(address < outputimage->window_first ||
+                   address + length > outputimage->window_end) {
+                        STDERR("line %u of %s: the bytes from %04XH to %04XH are outside "
+                               "the window of bank %u from %04XH to %04XH\n",
+                               statement->line, get_sourcefilename(statement->file),
+                               address, address + length - 1, outputimage->bank,
+                               outputimage->window_first, outputimage->window_end - 1);
+                        EFAILURE;
+                }
+                physical = outputimage->window_physical + address -
+                        outputimage->window_first;
+        }
+
+        if(outputimage->size + length > outputimage->capacity) {
+                capacity = outputimage->capacity ? outputimage->capacity : 4096;
+                while(capacity < outputimage->size + length)
+                        capacity *= 2;
+                newbytes = realloc(outputimage->bytes, capacity);
+                if(newbytes == NULL)
+                        return NULL;
+                outputimage->bytes = newbytes;
+                outputimage->capacity = capacity;
+        }
+
+        run = (outputimage->n_runs > 0) ? &outputimage->runs[outputimage->n_runs - 1] :
+                NULL;
+
+        if(run == NULL || (uint16_t) (run->address + run->length) != address ||
+           run->banked != outputimage->banked ||
+           run->section != outputimage->section ||
+           (run->banked && run->physical + run->length != physical)) {
+                if(outputimage->n_runs == outputimage->runs_capacity) {
+                        capacity = outputimage->runs_capacity * 2 + 16;
+                        newruns = realloc(outputimage->runs, capacity * sizeof(*newruns));
+                        if(newruns == NULL)
+                                return NULL;
+                        outputimage->runs = newruns;
+                        outputimage->runs_capacity = capacity;
+                }
+                run = &outputimage->runs[outputimage->n_runs++];
+                run->address = address;
+                run->physical = physical;
+                run->banked = outputimage->banked;
+                run->section = outputimage->section;
+                run->offset = outputimage->size;
+                run->length = 0;
+                run->statement = statement;
+        }
+
+        run->length += length;
+        outputimage->size += length;
+        stats_counters.bytes_emitted += length;
+
+        return &outputimage->bytes[outputimage->size - length];
+}
+
+/* Keeps the offset of the first byte of the statement, or of the copies of the length
+   bytes in front of it when there is no statement. */
+static status_t record_imagestatement(outputimage_t *outputimage, uint32_t offset,
+                                      const token_t *statement, uint32_t length) {
+        imagestatement_t *newstatements;
+        uint32_t capacity;
+
+        if(outputimage->n_statements > 0 && statement != NULL &&
+           outputimage->statements[outputimage->n_statements - 1].statement == statement)
+                return NO_ERROR;
+
+        if(outputimage->n_statements == outputimage->statements_capacity) {
+                capacity = outputimage->statements_capacity * 2 + 64;
+                newstatements = realloc(outputimage->statements,
+                                        capacity * sizeof(*newstatements));
+                if(newstatements == NULL)
+                        return ERROR;
+                outputimage->statements = newstatements;
+                outputimage->statements_capacity = capacity;
+        }
+
+        outputimage->statements[outputimage->n_statements].offset = offset;
+        outputimage->statements[outputimage->n_statements].statement = statement;
+        outputimage->statements[outputimage->n_statements++].length = length;
+
+        return NO_ERROR;
+}
+
+/* Gives room for the bytes as extend_image() does, and maps them to the line of the
+   statement in the source map. The copies made by REPT are not mapped. */
+uint8_t *reserve_inimage(outputimage_t *outputimage, uint16_t address, uint32_t length,
+                         const token_t *statement) {
+        uint8_t *output;
+
+        output = extend_image(outputimage, address, length, statement);
+        if(output == NULL || record_imagestatement(outputimage, outputimage->size - length,
+                                                   statement, length) == ERROR)
+                return NULL;
+        map_sourceline(statement, address, length);
+
+        return output;
+}
+
+/* Repeats the length bytes that end at the address count more times right after them.
+   The block copied doubles every time, so the copies take a handful of memcpy calls. */
+status_t repeat_inimage(outputimage_t *outputimage, uint16_t address, uint32_t length,
+                        uint32_t count) {
+        imagerun_t *run;
+        uint8_t *output;
+        uint32_t n_copied, n_total, n_bytes;
+
+        if(length == 0 || count == 0)
+                return NO_ERROR;
+
+        run = (outputimage->n_runs > 0) ? &outputimage->runs[outputimage->n_runs - 1] :
+                NULL;
+        if(run == NULL || run->length < length ||
+           (uint16_t) (run->address + run->length) != address)
+                return ERROR;
+
+        if(extend_image(outputimage, address, length * count, run->statement) == NULL ||
+           record_imagestatement(outputimage, outputimage->size - length * count, NULL,
+                                 length) == ERROR)
+                return ERROR;
+        output = &outputimage->bytes[outputimage->size - length * (count + 1)];
+
+        n_copied = length;
+        n_total = length * (count + 1);
+        while(n_copied < n_total) {
+                n_bytes = (n_copied < n_total - n_copied) ? n_copied : n_total - n_copied;
+                memcpy(output + n_copied, output, n_bytes);
+                n_copied += n_bytes;
+        }
+
+        return NO_ERROR;
+}
+
+/* Gives the statement that emitted the byte at the physical address in the run. A byte
+   copied by REPT is traced back to the byte it was copied from. */
+static const token_t *find_imagestatement(const outputimage_t *outputimage,
+                                          const imagerun_t *run, uint32_t physical) {
+        const imagestatement_t *statement;
+        uint32_t offset, low, high, middle;
+
+        offset = physical - run->physical;
+        if(!run->banked)
+                offset &= 0xFFFF;
+        offset += run->offset;
+
+        for(;;) {
+                low = 0;
+                high = outputimage->n_statements;
+                while(low < high) {
+                        middle = low + (high - low) / 2;
+                        if(outputimage->statements[middle].offset <= offset)
+                                low = middle + 1;
+                        else
+                                high = middle;
+                }
+                if(low == 0)
+                        return run->statement;
+
+                statement = &outputimage->statements[low - 1];
+                if(statement->statement != NULL)
+                        return statement->statement;
+                offset = statement->offset - statement->length +
+                         (offset - statement->offset) % statement->length;
+        }
+}
+
+static int compare_intervals(const void *interval1, const void *interval2) {
+        const imageinterval_t *first1 = interval1, *first2 = interval2;
+
+        if(first1->first != first2->first)
+                return (first1->first > first2->first) - (first1->first < first2->first);
+
+        return (first1->run > first2->run) - (first1->run < first2->run);
+}
+
+/* Reports every run that is emitted over bytes of an earlier run. The runs are sorted
+   by physical address, with a run that wraps around split in two, and swept once while
+   keeping the run that reaches furthest so far; a run that starts before that reach
+   overlaps it. The statements of both runs that emitted the first byte overlapped are
+   named. */
+status_t check_imageoverlaps(const outputimage_t *outputimage) {
+        imageinterval_t *intervals;
+        const imagerun_t *run, *earlier, *later;
+        const token_t *earlier_statement, *later_statement;
+        uint32_t index, n_intervals, reach, owner, end;
+        status_t status;
+
+        if(outputimage->n_runs < 2 && (outputimage->n_runs == 0 ||
+                                       outputimage->runs[0].length <= 0x10000))
+                return NO_ERROR;
+
+        intervals = malloc(2 * outputimage->n_runs * sizeof(*intervals));
+        if(intervals == NULL) {
+                STDERR("the output image could not be checked for overlaps\n");
+                return ERROR;
+        }
+
+        status = NO_ERROR;
+        n_intervals = 0;
+        for(index = 0; index < outputimage->n_runs; ++index) {
+                run = &outputimage->runs[index];
+                if(run->length > 0x10000) {
+                        STDERR("line %u of %s: the bytes emitted from here on take more "
+                               "than the whole address space\n", run->statement->line,
+                               get_sourcefilename(run->statement->file));
+                        status = ERROR;
+                }
+
+                end = run->physical + run->length;
+                if(end > 0x10000 && !run->banked) {
+                        intervals[n_intervals].first = 0;
+                        intervals[n_intervals].end = end - 0x10000;
+                        intervals[n_intervals++].run = index;
+                        end = 0x10000;
+                }
+                intervals[n_intervals].first = run->physical;
+                intervals[n_intervals].end = end;
+                intervals[n_intervals++].run = index;
+        }
+
+        qsort(intervals, n_intervals, sizeof(*intervals), compare_intervals);
+
+        reach = owner = 0;
+        for(index = 0; index < n_intervals; ++index) {
+                if(intervals[index].first < reach && intervals[index].run != owner) {
+                        earlier = &outputimage->runs[(owner < intervals[index].run) ?
+                                                     owner : intervals[index].run];
+                        later = &outputimage->runs[(owner < intervals[index].run) ?
+                                                   intervals[index].run : owner];
+                        end = (intervals[index].end < reach) ? intervals[index].end :
+                                reach;
+                        later_statement = find_imagestatement(outputimage, later,
+                                                              intervals[index].first);
+                        earlier_statement = find_imagestatement(outputimage, earlier,
+                                                                intervals[index].first);
+                        STDERR("line %u of %s: the bytes from %04XH to %04XH overlap "
+                               "those emitted from line %u of %s\n",
+                               later_statement->line,
+                               get_sourcefilename(later_statement->file),
+                               intervals[index].first, end - 1,
+                               earlier_statement->line,
+                               get_sourcefilename(earlier_statement->file));
+                        status = ERROR;
+                }
+                if(intervals[index].end > reach) {
+                        reach = intervals[index].end;
+                        owner = intervals[index].run;
+                }
+        }
+
+        free(intervals);
+
+        return status;
+}
+
+static char *put_hexbyte(char *output, uint8_t value) {
+        static const char digits[] = "0123456789ABCDEF";
+
+        output[0] = digits[value >> 4];
+        output[1] = digits[value & 0x0F];
+
+        return output + 2;
+}
+
+/* Puts one record of the given type, preceded by CR LF unless it is the first. */
+static char *put_hexrecord(char *output, uint8_t type, uint16_t address,
+                           const uint8_t *bytes, uint32_t length, int first) {
+        uint32_t n_bytes;
+        uint8_t checksum;
+
+        if(!first) {
+                *output++ = '\r';
+                *output++ = '\n';
+        }
+        *output++ = ':';
+        output = put_hexbyte(output, length);
+        output = put_hexbyte(output, address >> 8);
+        output = put_hexbyte(output, address);
+        output = put_hexbyte(output, type);
+        checksum = length + (address >> 8) + address + type;
+
+        for(n_bytes = 0; n_bytes < length; ++n_bytes) {
+                output = put_hexbyte(output, bytes[n_bytes]);
+                checksum += bytes[n_bytes];
+        }
+
+        return put_hexbyte(output, -checksum);
+}
+
+/* Writes every run as data records of up to 16 bytes, ending with the end-of-file
+   record. Records are separated by CR LF. */
+status_t write_hexfile(outputimage_t *outputimage, FILE *outputfile_handle) {
+        char record[2 * HEXRECORD_LENGTH + 64], *output;
+        imagerun_t *run;
+        uint32_t index, position, length, address, upper;
+        uint8_t segment[2];
+        int first;
+
+        begin_phasetimer(PHASE_HEXEMISSION);
+
+        first = 1;
+        upper = 0;
+        for(index = 0; index < outputimage->n_runs; ++index) {
+                run = &outputimage->runs[index];
+                for(position = 0; position < run->length; position += length) {
+                        address = run->physical + position;
+                        if(!run->banked)
+                                address &= 0xFFFF;
+                        length = run->length - position;
+                        if(length > HEXRECORD_LENGTH)
+                                length = HEXRECORD_LENGTH;
+                        /* A run may wrap around the end of the address space or cross
+                           a 64K boundary of the physical memory, but a record does
+                           not. */
+                        if((address & 0xFFFF) + length > 0x10000)
+                                length = 0x10000 - (address & 0xFFFF);
+
+                        output = record;
+                        if(address >> 16 != upper) {
+                                upper = address >> 16;
+                                segment[0] = (uint8_t) (upper >> 8);
+                                segment[1] = (uint8_t) upper;
+                                output = put_hexrecord(output, 0x04, 0, segment, 2,
+                                                       first);
+                                first = 0;
+                        }
+                        output = put_hexrecord(output, 0x00, address,
+                                               &outputimage->bytes[run->offset +
+                                                                   position],
+                                               length, first);
+                        first = 0;
+
+                        fwrite(record, 1, output - record, outputfile_handle);
+                }
+        }
+
+        fputs(first ? ":00000001FF" : "\r\n:00000001FF", outputfile_handle);
+
+        end_phasetimer(PHASE_HEXEMISSION);
+
+        return ferror(outputfile_handle) ? ERROR : NO_ERROR;
+}
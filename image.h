@@ -0,0 +1,100 @@
+// File: image.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the output image, which collects the bytes of the program while
+ * the second pass assembles it. The bytes are kept in the order they are emitted, in
+ * runs of consecutive addresses; the Intel HEX file is written from the runs once the
+ * second pass is over, so that emitting bytes never touches the file. The image keeps
+ * the first byte of every statement, so that bytes that overlap can be traced back to
+ * the statements that emitted them.
+ *
+ * Code in a bank is emitted through the window of the bank: its addresses are those the
+ * processor sees, while its physical address is where the bank lies in the memory behind
+ * the window.
+ *
+ * When a module is assembled, the bytes of its floating sections are emitted from
+ * address 0 of each section and kept in runs of their own, to be placed by the linker.
+ */
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "defines.h"
+#include "lexer.h"
+
+#define NO_SECTION UINT32_MAX
+
+typedef struct imagerun_t {
+        uint16_t address;
+        /* The physical address of the first byte; the same as address outside banks,
+           where the addresses wrap around at FFFFH. */
+        uint32_t physical;
+        uint8_t banked;
+        /* The floating section of the module the run is in, or NO_SECTION. */
+        uint32_t section;
+        uint32_t offset;
+        uint32_t length;
+        const token_t *statement;
+} imagerun_t;
+
+/* The first byte of a statement in the image, or of the copies REPT made of the length
+   bytes in front of it, which have no statement. */
+typedef struct imagestatement_t {
+        uint32_t offset;
+        const token_t *statement;
+        uint32_t length;
+} imagestatement_t;
+
+typedef struct outputimage_t {
+        uint8_t *bytes;
+        uint32_t size, capacity;
+        imagerun_t *runs;
+        uint32_t n_runs, runs_capacity;
+        imagestatement_t *statements;
+        uint32_t n_statements, statements_capacity;
+        /* The window the bytes are emitted through once a bank has been selected. */
+        uint8_t banked, bank;
+        uint16_t window_first;
+        uint32_t window_end, window_physical;
+        uint32_t section;
+} outputimage_t;
+
+void init_outputimage(outputimage_t *outputimage);
+
+void free_outputimage(outputimage_t *outputimage);
+
+uint8_t *reserve_inimage(outputimage_t *outputimage, uint16_t address, uint32_t length,
+                         const token_t *statement);
+
+void map_imagewindow(outputimage_t *outputimage, uint8_t bank, uint16_t first,
+                     uint32_t end, uint32_t physical);
+
+status_t repeat_inimage(outputimage_t *outputimage, uint16_t address, uint32_t length,
+                        uint32_t count);
+
+status_t check_imageoverlaps(const outputimage_t *outputimage);
+
+status_t write_hexfile(outputimage_t *outputimage, FILE *outputfile_handle);
+
+#endif
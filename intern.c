@@ -0,0 +1,136 @@
+// File: intern.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the intern table. The spelling of every atom is copied into the
+ * arena given at initialization and indexed by its hash, and the atom itself is the
+ * position of the spelling in a list of names. Atom 0 is never handed out, so that it
+ * can stand for no atom at all.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "defines.h"
+#include "arena.h"
+#include "hash.h"
+#include "intern.h"
+
+static const char *predefined_atoms[N_PREDEFINEDATOMS] = {NULL, "(BC)", "(DE)", "(HL)",
+                                                          "(SP)", "(C)", "IX", "IY",
+                                                          "ORG", "EQU",
+                                                          "DB", "DEFB", "DW", "DEFW",
+                                                          "DS", "DEFS", "INCBIN",
+                                                          "ALIGN", "INCLUDE", "MACRO", "ENDM",
+                                                          "LOCAL", "IF", "IFDEF",
+                                                          "IFNDEF", "ELSE", "ENDIF",
+                                                          "REPT", "IRP", "ENDR",
+                                                          "PAGETABLE", "SECTION",
+                                                          "ENDS", "PLACE", "BANK",
+                                                          "EXTERN", "PUBLIC"};
+
+static arena_t *intern_arena;
+static hashtable_t intern_index;
+static const char **atom_names;
+static uint32_t atom_currentsize, atom_actualsize;
+
+status_t init_interntable(arena_t *arena) {
+        atom_t atom;
+
+        intern_arena = arena;
+        atom_currentsize = 1;
+        atom_actualsize = 1024;
+        atom_names = malloc(atom_actualsize * sizeof(*atom_names));
+        if(atom_names == NULL)
+                return ERROR;
+        atom_names[ATOM_NONE] = NULL;
+
+        if(init_hashtable(&intern_index, atom_actualsize) == ERROR) {
+                free(atom_names);
+                atom_names = NULL;
+                return ERROR;
+        }
+
+        for(atom = 1; atom < N_PREDEFINEDATOMS; ++atom) {
+                if(intern_string(predefined_atoms[atom],
+                                 strlen(predefined_atoms[atom])) != atom) {
+                        free_interntable();
+                        return ERROR;
+                }
+        }
+
+        return NO_ERROR;
+}
+
+atom_t intern_string(const char *string, size_t length) {
+        uint32_t atom;
+        const char **atom_newnames;
+        char *name;
+
+        if(lookup_hashtable(&intern_index, string, length, &atom) == VALID)
+                return atom;
+
+        if(atom_currentsize == atom_actualsize) {
+                atom_newnames = realloc(atom_names, 2 * atom_actualsize *
+                                        sizeof(*atom_newnames));
+                if(atom_newnames == NULL)
+                        return ATOM_NONE;
+                atom_names = atom_newnames;
+                atom_actualsize *= 2;
+        }
+
+        name = reserve_inarena(intern_arena, length + 1);
+        if(name == NULL)
+                return ATOM_NONE;
+        memcpy(name, string, length);
+        name[length] = '\0';
+
+        atom = atom_currentsize;
+        if(insert_hashtable(&intern_index, name, length, atom) == ERROR)
+                return ATOM_NONE;
+        atom_names[atom_currentsize++] = name;
+
+        return atom;
+}
+
+atom_t find_atom(const char *string, size_t length) {
+        uint32_t atom;
+
+        if(lookup_hashtable(&intern_index, string, length, &atom) == VALID)
+                return atom;
+
+        return ATOM_NONE;
+}
+
+const char *get_atomname(atom_t atom) {
+        return (atom < atom_currentsize) ? atom_names[atom] : NULL;
+}
+
+uint32_t get_natoms(void) {
+        return atom_currentsize;
+}
+
+void free_interntable(void) {
+        free(atom_names);
+        atom_names = NULL;
+        atom_currentsize = atom_actualsize = 0;
+        free_hashtable(&intern_index);
+}
@@ -0,0 +1,60 @@
+// File: intern.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the intern table, which gives every distinct name met in the
+ * source a 32-bit atom. Names are interned once as they are read; from then on they
+ * are compared and looked up by atom. The atoms below are interned first, in this
+ * order, so that they can be compared against without a lookup.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include "defines.h"
+#include "arena.h"
+
+/* The directives come last, so that any atom from ATOM_ORG up to N_PREDEFINEDATOMS is a
+   directive. */
+enum predefined_atom_t {ATOM_NONE = 0, ATOM_BCMEMREF, ATOM_DEMEMREF, ATOM_HLMEMREF,
+                        ATOM_SPMEMREF, ATOM_CMEMREF, ATOM_IX, ATOM_IY, ATOM_ORG,
+                        ATOM_EQU, ATOM_DB, ATOM_DEFB, ATOM_DW, ATOM_DEFW, ATOM_DS, ATOM_DEFS,
+                        ATOM_INCBIN, ATOM_ALIGN, ATOM_INCLUDE, ATOM_MACRO, ATOM_ENDM,
+                        ATOM_LOCAL, ATOM_IF, ATOM_IFDEF, ATOM_IFNDEF, ATOM_ELSE,
+                        ATOM_ENDIF, ATOM_REPT, ATOM_IRP, ATOM_ENDR,
+                        ATOM_PAGETABLE, ATOM_SECTION, ATOM_ENDS, ATOM_PLACE,
+                        ATOM_BANK, ATOM_EXTERN, ATOM_PUBLIC, N_PREDEFINEDATOMS};
+
+status_t init_interntable(arena_t *arena);
+
+atom_t intern_string(const char *string, size_t length);
+
+atom_t find_atom(const char *string, size_t length);
+
+const char *get_atomname(atom_t atom);
+
+uint32_t get_natoms(void);
+
+void free_interntable(void);
+
+#endif
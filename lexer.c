@@ -0,0 +1,447 @@
+// File: lexer.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the lexer. Tokens are recognized by a DFA driven by two tables:
+ * one maps every character to a class and the other gives, for every state and class,
+ * the next state. A token ends when there is no next state, and its type is the one
+ * accepted by the state it ended in. Whitespace runs are skipped eight characters at a
+ * time and comment bodies with memchr, since they make up most of a typical source.
+ *
+ * The registers, conditions and bit names are interned when the lexer is initialized,
+ * so that an identifier can be told to be one of them by the range its atom falls in.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "defines.h"
+#include "intern.h"
+#include "lexer.h"
+
+enum char_class_t {CLASS_OTHER = 0, CLASS_SPACE, CLASS_NEWLINE, CLASS_RETURN,
+                   CLASS_SEMICOLON, CLASS_LETTER, CLASS_DIGIT, CLASS_DOLLAR, CLASS_QUOTE,
+                   CLASS_PERCENT, CLASS_LESS, CLASS_GREATER, CLASS_DQUOTE, N_CLASSES};
+
+enum lexer_state_t {STATE_STOP = 0, STATE_START, STATE_SPACE, STATE_COMMENT,
+                    STATE_NEWLINE, STATE_RETURN, STATE_IDENTIFIER, STATE_PRIME,
+                    STATE_NUMBER, STATE_DOLLAR, STATE_PERCENT, STATE_STRING,
+                    STATE_STRINGEND, STATE_DSTRING, STATE_DSTRINGEND, STATE_LESS,
+                    STATE_GREATER, STATE_SHIFT, STATE_PUNCTUATION, N_STATES};
+
+static const uint8_t transitions[N_STATES][N_CLASSES] = {
+        /* OTHER, SPACE, NEWLINE, RETURN, SEMICOLON, LETTER, DIGIT, DOLLAR, QUOTE,
+           PERCENT, LESS, GREATER, DQUOTE */
+        [STATE_START] = {STATE_PUNCTUATION, STATE_SPACE, STATE_NEWLINE, STATE_RETURN,
+                         STATE_COMMENT, STATE_IDENTIFIER, STATE_NUMBER, STATE_DOLLAR,
+                         STATE_STRING, STATE_PERCENT, STATE_LESS, STATE_GREATER,
+                         STATE_DSTRING},
+        [STATE_SPACE] = {[CLASS_SPACE] = STATE_SPACE},
+        [STATE_COMMENT] = {STATE_COMMENT, STATE_COMMENT, STATE_STOP, STATE_STOP,
+                           STATE_COMMENT, STATE_COMMENT, STATE_COMMENT, STATE_COMMENT,
+                           STATE_COMMENT, STATE_COMMENT, STATE_COMMENT, STATE_COMMENT,
+                           STATE_COMMENT},
+        [STATE_RETURN] = {[CLASS_NEWLINE] = STATE_NEWLINE},
+        [STATE_IDENTIFIER] = {[CLASS_LETTER] = STATE_IDENTIFIER,
+                              [CLASS_DIGIT] = STATE_IDENTIFIER,
+                              [CLASS_QUOTE] = STATE_PRIME},
+        [STATE_NUMBER] = {[CLASS_LETTER] = STATE_NUMBER, [CLASS_DIGIT] = STATE_NUMBER},
+        [STATE_DOLLAR] = {[CLASS_LETTER] = STATE_IDENTIFIER,
+                          [CLASS_DIGIT] = STATE_IDENTIFIER},
+        [STATE_PERCENT] = {[CLASS_DIGIT] = STATE_NUMBER},
+        /* A quoted string ends at the closing quote or, unterminated, at the end of
+           the line. A doubled quote stands for one quote inside the string. Strings
+           are quoted with single or double quotes alike. */
+        [STATE_STRING] = {STATE_STRING, STATE_STRING, STATE_STOP, STATE_STOP,
+                          STATE_STRING, STATE_STRING, STATE_STRING, STATE_STRING,
+                          STATE_STRINGEND, STATE_STRING, STATE_STRING, STATE_STRING,
+                          STATE_STRING},
+        [STATE_STRINGEND] = {[CLASS_QUOTE] = STATE_STRING},
+        [STATE_DSTRING] = {STATE_DSTRING, STATE_DSTRING, STATE_STOP, STATE_STOP,
+                           STATE_DSTRING, STATE_DSTRING, STATE_DSTRING, STATE_DSTRING,
+                           STATE_DSTRING, STATE_DSTRING, STATE_DSTRING, STATE_DSTRING,
+                           STATE_DSTRINGEND},
+        [STATE_DSTRINGEND] = {[CLASS_DQUOTE] = STATE_DSTRING},
+        [STATE_LESS] = {[CLASS_LESS] = STATE_SHIFT},
+        [STATE_GREATER] = {[CLASS_GREATER] = STATE_SHIFT}
+};
+
+/* The token accepted by every state; TOKEN_END marks whitespace, which is dropped. */
+static const uint8_t accepted_tokens[N_STATES] = {
+        [STATE_COMMENT] = TOKEN_COMMENT,
+        [STATE_NEWLINE] = TOKEN_NEWLINE,
+        [STATE_RETURN] = TOKEN_NEWLINE,
+        [STATE_IDENTIFIER] = TOKEN_IDENTIFIER,
+        [STATE_PRIME] = TOKEN_IDENTIFIER,
+        [STATE_NUMBER] = TOKEN_NUMBER,
+        [STATE_DOLLAR] = TOKEN_PUNCTUATION,
+        [STATE_PERCENT] = TOKEN_PUNCTUATION,
+        [STATE_STRING] = TOKEN_STRING,
+        [STATE_STRINGEND] = TOKEN_STRING,
+        [STATE_DSTRING] = TOKEN_STRING,
+        [STATE_DSTRINGEND] = TOKEN_STRING,
+        [STATE_LESS] = TOKEN_PUNCTUATION,
+        [STATE_GREATER] = TOKEN_PUNCTUATION,
+        [STATE_SHIFT] = TOKEN_PUNCTUATION,
+        [STATE_PUNCTUATION] = TOKEN_PUNCTUATION
+};
+
+static const char *register_names[] = {"A", "B", "C", "D", "E", "H", "L", "I", "R",
+                                       "AF", "AF'", "BC", "DE", "HL", "SP", "IX", "IY",
+                                       "NZ", "Z", "NC", "CC", "$NZ", "$Z", "$NC", "$C",
+                                       "$PO", "$PE", "$P", "$M", "B0", "B1", "B2", "B3",
+                                       "B4", "B5", "B6", "B7", NULL};
+
+/* The registers that can be used as a memory reference, as in "(HL)", and the atom of
+   the whole reference. */
+static const struct {
+        const char *name;
+        atom_t memref_atom;
+} memref_registers[] = {{"BC", ATOM_BCMEMREF}, {"DE", ATOM_DEMEMREF},
+                        {"HL", ATOM_HLMEMREF}, {"SP", ATOM_SPMEMREF},
+                        {"C", ATOM_CMEMREF}};
+
+#define N_MEMREFREGISTERS (sizeof(memref_registers) / sizeof(memref_registers[0]))
+
+#define NOT_DIGIT 0xFF
+
+static uint8_t char_classes[256];
+static uint8_t digit_values[256];
+static atom_t memref_registeratoms[N_MEMREFREGISTERS];
+static atom_t first_registeratom, last_registeratom;
+
+static void set_charclass(int first, int last, uint8_t char_class) {
+        for(; first <= last; ++first)
+                char_classes[first] = char_class;
+}
+
+status_t init_lexer(void) {
+        uint32_t index;
+
+        set_charclass(0, 255, CLASS_OTHER);
+        set_charclass(' ', ' ', CLASS_SPACE);
+        set_charclass('\t', '\t', CLASS_SPACE);
+        set_charclass('\n', '\n', CLASS_NEWLINE);
+        set_charclass('\r', '\r', CLASS_RETURN);
+        set_charclass(';', ';', CLASS_SEMICOLON);
+        set_charclass('A', 'Z', CLASS_LETTER);
+        set_charclass('a', 'z', CLASS_LETTER);
+        set_charclass('_', '_', CLASS_LETTER);
+        set_charclass('.', '.', CLASS_LETTER);
+        set_charclass('0', '9', CLASS_DIGIT);
+        set_charclass('$', '$', CLASS_DOLLAR);
+        set_charclass('\'', '\'', CLASS_QUOTE);
+        set_charclass('"', '"', CLASS_DQUOTE);
+        set_charclass('%', '%', CLASS_PERCENT);
+        set_charclass('<', '<', CLASS_LESS);
+        set_charclass('>', '>', CLASS_GREATER);
+
+        memset(digit_values, NOT_DIGIT, sizeof(digit_values));
+        for(index = 0; index < 10; ++index)
+                digit_values['0' + index] = index;
+        for(index = 0; index < 6; ++index) {
+                digit_values['A' + index] = 10 + index;
+                digit_values['a' + index] = 10 + index;
+        }
+
+        first_registeratom = get_natoms();
+        for(index = 0; register_names[index] != NULL; ++index) {
+                if(intern_string(register_names[index],
+                                 strlen(register_names[index])) == ATOM_NONE)
+                        return ERROR;
+        }
+        last_registeratom = get_natoms() - 1;
+
+        for(index = 0; index < N_MEMREFREGISTERS; ++index)
+                memref_registeratoms[index] =
+                        find_atom(memref_registers[index].name,
+                                  strlen(memref_registers[index].name));
+
+        return NO_ERROR;
+}
+
+/* IX and IY are predefined atoms, since the parser looks for them, so they come before
+   the other registers. */
+static int testif_registeratom(atom_t atom) {
+        return (atom >= first_registeratom && atom <= last_registeratom) ||
+                atom == ATOM_IX || atom == ATOM_IY;
+}
+
+/* Returns a mask with the high bit set in every byte of word that is zero. */
+static uint64_t get_zerobytes(uint64_t word) {
+        const uint64_t low_bits = 0x7F7F7F7F7F7F7F7FULL;
+
+        return ~(((word & low_bits) + low_bits) | word | low_bits);
+}
+
+static const char *skip_spaces(const char *position, const char *end) {
+        const uint64_t high_bits = 0x8080808080808080ULL;
+        uint64_t word, spaces;
+
+        while(end - position >= 8) {
+                memcpy(&word, position, 8);
+                spaces = get_zerobytes(word ^ 0x2020202020202020ULL) |
+                        get_zerobytes(word ^ 0x0909090909090909ULL);
+                if(spaces != high_bits)
+                        break;
+                position += 8;
+        }
+        while(position < end && (*position == ' ' || *position == '\t'))
+                ++position;
+
+        return position;
+}
+
+static const char *skip_comment(const char *position, const char *end) {
+        const char *newline;
+
+        newline = memchr(position, '\n', end - position);
+        if(newline == NULL)
+                newline = end;
+        if(newline > position && newline[-1] == '\r')
+                --newline;
+
+        return newline;
+}
+
+/* Cuts the buffer into tokens, ending with an end token. The list of tokens is made
+   with malloc and belongs to the caller; the text of the tokens stays in the buffer. */
+status_t tokenize_buffer(const char *buffer, uint32_t length, tokenstream_t *tokenstream) {
+        const char *position, *end, *start;
+        uint8_t state, next_state, flags;
+        uint32_t line, n_tokens, actual_size;
+        token_t *tokens, *new_tokens;
+
+        position = buffer;
+        end = buffer + length;
+        line = 1;
+        flags = 0;
+        n_tokens = 0;
+        actual_size = length / 4 + 16;
+        tokens = malloc(actual_size * sizeof(*tokens));
+        if(tokens == NULL)
+                return ERROR;
+
+        while(position < end) {
+                start = position;
+                state = transitions[STATE_START][char_classes[(uint8_t) *position++]];
+
+                if(state == STATE_SPACE) {
+                        position = skip_spaces(position, end);
+                        flags = TOKEN_SPACED;
+                        continue;
+                }
+                if(state == STATE_COMMENT)
+                        position = skip_comment(position, end);
+
+                while(position < end) {
+                        next_state = transitions[state][char_classes[(uint8_t) *position]];
+                        if(next_state == STATE_STOP)
+                                break;
+                        state = next_state;
+                        ++position;
+                }
+
+                /* One slot is always kept free for the end token. */
+                if(n_tokens + 2 > actual_size) {
+                        actual_size *= 2;
+                        new_tokens = realloc(tokens, actual_size * sizeof(*tokens));
+                        if(new_tokens == NULL) {
+                                free(tokens);
+                                return ERROR;
+                        }
+                        tokens = new_tokens;
+                }
+
+                tokens[n_tokens].text = start;
+                tokens[n_tokens].length = position - start;
+                tokens[n_tokens].line = line;
+                tokens[n_tokens].type = accepted_tokens[state];
+                tokens[n_tokens].flags = flags;
+                tokens[n_tokens].file = 0;
+                tokens[n_tokens].atom = ATOM_NONE;
+
+                if(tokens[n_tokens].type == TOKEN_IDENTIFIER) {
+                        tokens[n_tokens].atom = intern_string(start, position - start);
+                        if(tokens[n_tokens].atom == ATOM_NONE) {
+                                free(tokens);
+                                return ERROR;
+                        }
+                        if(testif_registeratom(tokens[n_tokens].atom))
+                                tokens[n_tokens].type = TOKEN_REGISTER;
+                }
+                else if(tokens[n_tokens].type == TOKEN_NEWLINE)
+                        ++line;
+
+                flags = 0;
+                ++n_tokens;
+        }
+
+        /* The end token does not point past the buffer, which need not be followed
+           by a NUL when it is mapped from a file. */
+        tokens[n_tokens].text = "";
+        tokens[n_tokens].length = 0;
+        tokens[n_tokens].line = line;
+        tokens[n_tokens].type = TOKEN_END;
+        tokens[n_tokens].flags = flags;
+        tokens[n_tokens].file = 0;
+        tokens[n_tokens].atom = ATOM_NONE;
+        ++n_tokens;
+
+        new_tokens = realloc(tokens, n_tokens * sizeof(*tokens));
+        if(new_tokens != NULL)
+                tokens = new_tokens;
+        tokenstream->tokens = tokens;
+        tokenstream->n_tokens = n_tokens;
+        tokenstream->position = 0;
+
+        return NO_ERROR;
+}
+
+/* Gives the atom of the memory reference made through a register, such as ATOM_HLMEMREF
+   for HL, or ATOM_NONE if the register cannot be used that way. */
+atom_t get_memrefatom(atom_t register_atom) {
+        uint32_t index;
+
+        for(index = 0; index < N_MEMREFREGISTERS; ++index) {
+                if(memref_registeratoms[index] == register_atom)
+                        return memref_registers[index].memref_atom;
+        }
+
+        return ATOM_NONE;
+}
+
+/* Reads the value of an integer literal in a single pass. The radix is given by a
+   prefix ($FF, 0xFF, %1010) or a suffix (0FFH, 1010B, 17O or 17Q); a literal without
+   either is decimal. A character in quotes, as in 'c', gives its code. The
+   width is one byte if the value fits in it and two bytes otherwise; a value that does
+   not fit in 16 bits is invalid. Registers such as $C are never literals. */
+data_status_t parse_literal(const token_t *token, uint16_t *value, uint8_t *byte_length) {
+        const char *text = token->text;
+        uint32_t first, last, radix, number, digit, index;
+
+        if(token->type == TOKEN_STRING) {
+                if(token->length == 3 && text[2] == text[0])
+                        number = (uint8_t) text[1];
+                else if(token->length == 4 && text[1] == text[0] &&
+                        text[2] == text[0] && text[3] == text[0])
+                        number = (uint8_t) text[0];
+                else
+                        return INVALID;
+                *value = number;
+                *byte_length = 1;
+                return VALID;
+        }
+
+        if(token->type != TOKEN_NUMBER && token->type != TOKEN_IDENTIFIER)
+                return INVALID;
+
+        first = 0;
+        last = token->length;
+        radix = 10;
+
+        if(text[0] == '$') {
+                radix = 16;
+                first = 1;
+        }
+        else if(text[0] == '%') {
+                radix = 2;
+                first = 1;
+        }
+        else if(last > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+                radix = 16;
+                first = 2;
+        }
+        else {
+                switch(text[last - 1]) {
+                case 'H': case 'h':
+                        radix = 16;
+                        --last;
+                        break;
+                case 'B': case 'b':
+                        radix = 2;
+                        --last;
+                        break;
+                case 'O': case 'o': case 'Q': case 'q':
+                        radix = 8;
+                        --last;
+                        break;
+                }
+        }
+
+        if(first >= last)
+                return INVALID;
+
+        number = 0;
+        for(index = first; index < last; ++index) {
+                digit = digit_values[(uint8_t) text[index]];
+                if(digit >= radix)
+                        return INVALID;
+                number = number * radix + digit;
+                if(number > 0xFFFF)
+                        return INVALID;
+        }
+
+        *value = number;
+        *byte_length = (number < 256) ? 1 : 2;
+
+        return VALID;
+}
+
+/* Gives the characters of a string literal, with every doubled quote taken as one
+   quote, and their number. The characters are only counted if text is NULL. A string
+   that is not closed on its line is invalid. */
+data_status_t get_stringtext(const token_t *token, uint8_t *text, uint32_t *length) {
+        uint32_t index;
+
+        if(token->type != TOKEN_STRING)
+                return INVALID;
+
+        *length = 0;
+        for(index = 1; index < token->length; ++index) {
+                if(token->text[index] == token->text[0]) {
+                        if(index + 1 == token->length)
+                                return VALID;
+                        ++index;
+                }
+                if(text != NULL)
+                        text[*length] = (uint8_t) token->text[index];
+                ++*length;
+        }
+
+        return INVALID;
+}
+
+/* Tells what follows the current token on its line. */
+line_status_t get_linestatus(const tokenstream_t *tokenstream) {
+        switch(tokenstream->tokens[tokenstream->position].type) {
+        case TOKEN_END:
+                return ENDOFFILE_DETECTED;
+        case TOKEN_NEWLINE:
+                return NEWLINE_DETECTED;
+        case TOKEN_COMMENT:
+                return COMMNTDELIM_DETECTED;
+        default:
+                return NONE_DETECTED;
+        }
+}
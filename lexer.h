@@ -0,0 +1,82 @@
+// File: lexer.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the lexer. A source file, held in memory as a whole, is cut into
+ * a list of typed tokens, which both passes then walk instead of reading the file
+ * character by character. Every token is a slice of the source text; identifiers and
+ * registers also carry their atom. Words, operands and directive arguments are runs of
+ * tokens, so their text is never copied out of the source and has no length limit.
+ */
+
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "defines.h"
+
+typedef enum token_type_t {TOKEN_END = 0, TOKEN_IDENTIFIER, TOKEN_NUMBER,
+                           TOKEN_STRING, TOKEN_REGISTER, TOKEN_PUNCTUATION,
+                           TOKEN_COMMENT, TOKEN_NEWLINE} token_type_t;
+
+/* Set on a token that is preceded by a space or a tab. */
+#define TOKEN_SPACED 0x01
+/* Set on a local label of a macro, which is named anew for every expansion. */
+#define TOKEN_LOCAL 0x02
+
+typedef struct token_t {
+        const char *text;
+        uint32_t length;
+        uint32_t line;
+        atom_t atom;
+        uint8_t type;
+        uint8_t flags;
+        /* The source file the token was read from, as numbered by the file cache. */
+        uint16_t file;
+} token_t;
+
+/* A run of consecutive tokens, such as the tokens of one operand. */
+typedef struct tokenrange_t {
+        const token_t *tokens;
+        uint32_t n_tokens;
+} tokenrange_t;
+
+typedef struct tokenstream_t {
+        token_t *tokens;
+        uint32_t n_tokens;
+        uint32_t position;
+} tokenstream_t;
+
+status_t init_lexer(void);
+
+status_t tokenize_buffer(const char *buffer, uint32_t length, tokenstream_t *tokenstream);
+
+atom_t get_memrefatom(atom_t register_atom);
+
+data_status_t parse_literal(const token_t *token, uint16_t *value, uint8_t *byte_length);
+
+data_status_t get_stringtext(const token_t *token, uint8_t *text, uint32_t *length);
+
+line_status_t get_linestatus(const tokenstream_t *tokenstream);
+
+#endif
@@ -0,0 +1,550 @@
+// File: link.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the linker. Every object file is mapped into memory and read into
+ * the sections, runs, PUBLIC symbols and relocations of its module, as written by
+ * object.c; nothing is taken on trust, and a file that ends early or gives a value out
+ * of range is reported as damaged.
+ *
+ * The modules are then linked in four steps. The bytes at fixed addresses are taken
+ * first, and the floating sections of every module are placed in the gaps between them
+ * the way place_sections() places those of one source; a floating section is named
+ * after its module as well, so that modules can use the same names. The PUBLIC symbols
+ * are defined next, and every run is copied to its address with its relocations filled
+ * in. A relocation names a floating section of its own module or a PUBLIC symbol of
+ * any module.
+ *
+ * The relocations are filled in one run after the other. An image is 64K at most and
+ * holds a few thousand relocations at the very most, which take far less time than the
+ * files take to be read, so spreading them over threads would cost more than it saves;
+ * the modules themselves are what is assembled in parallel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "defines.h"
+#include "intern.h"
+#include "lexer.h"
+#include "task.h"
+#include "image.h"
+#include "source.h"
+#include "section.h"
+#include "object.h"
+#include "trace.h"
+#include "link.h"
+
+typedef struct linksection_t {
+        /* The name in the module, and the name it is placed under. */
+        atom_t name;
+        atom_t placed_name;
+        uint32_t line;
+        uint32_t size;
+        uint32_t alignment;
+} linksection_t;
+
+typedef struct linkrun_t {
+        uint16_t address;
+        uint32_t section;
+        uint32_t length;
+        const uint8_t *bytes;
+        /* Stands for the line the run starts at in the messages about it. */
+        token_t statement;
+} linkrun_t;
+
+typedef struct linkpublic_t {
+        atom_t name;
+        uint32_t section;
+        uint16_t value;
+} linkpublic_t;
+
+typedef struct linkrelocation_t {
+        uint32_t run;
+        uint32_t offset;
+        atom_t symbol;
+        uint16_t addend;
+        uint8_t kind;
+} linkrelocation_t;
+
+typedef struct objectfile_t {
+        const char *name;
+        uint8_t *data;
+        size_t size;
+        uint8_t place_given;
+        uint32_t place_first, place_end;
+        linksection_t *sections;
+        uint32_t n_sections;
+        linkrun_t *runs;
+        uint32_t n_runs;
+        linkpublic_t *publics;
+        uint32_t n_publics;
+        linkrelocation_t *relocations;
+        uint32_t n_relocations;
+} objectfile_t;
+
+/* The part of an object file that is still to be read. */
+typedef struct objectreader_t {
+        const uint8_t *data;
+        size_t size, position;
+        int damaged;
+} objectreader_t;
+
+static objectfile_t *objectfiles;
+static uint32_t objectfiles_currentsize, objectfiles_actualsize;
+
+status_t add_objectfile(const char *objectfile_name) {
+        objectfile_t *objectfiles_newlist;
+
+        if(objectfiles_currentsize == objectfiles_actualsize) {
+                objectfiles_newlist = realloc(objectfiles, (objectfiles_actualsize + 8) *
+                                              sizeof(*objectfiles_newlist));
+                if(objectfiles_newlist == NULL)
+                        return ERROR;
+                objectfiles = objectfiles_newlist;
+                objectfiles_actualsize += 8;
+        }
+
+        memset(&objectfiles[objectfiles_currentsize], 0, sizeof(*objectfiles));
+        objectfiles[objectfiles_currentsize++].name = objectfile_name;
+
+        return NO_ERROR;
+}
+
+uint32_t count_objectfiles(void) {
+        return objectfiles_currentsize;
+}
+
+const char *get_objectfilename(uint32_t index) {
+        return objectfiles[index].name;
+}
+
+static const uint8_t *get_objectdata(objectreader_t *reader, size_t length) {
+        const uint8_t *data;
+
+        if(reader->damaged || length > reader->size - reader->position) {
+                reader->damaged = 1;
+                return NULL;
+        }
+
+        data = &reader->data[reader->position];
+        reader->position += length;
+
+        return data;
+}
+
+static uint32_t get_objectbytes(objectreader_t *reader, int n_bytes) {
+        const uint8_t *data;
+        uint32_t value;
+        int i;
+
+        data = get_objectdata(reader, n_bytes);
+        if(data == NULL)
+                return 0;
+
+        value = 0;
+        for(i = 0; i < n_bytes; ++i)
+                value |= (uint32_t) data[i] << (8 * i);
+
+        return value;
+}
+
+static atom_t get_objectname(objectreader_t *reader) {
+        const uint8_t *data;
+        uint32_t length;
+
+        length = get_objectbytes(reader, 2);
+        data = get_objectdata(reader, length);
+        if(data == NULL || length == 0)  {
+                reader->damaged = 1;
+                return ATOM_NONE;
+        }
+
+        return intern_string((const char *) data, length);
+}
+
+/* Gives room for a count of entries read from the file; every entry takes a byte at
+   least, so a count larger than what is left of the file is damage. */
+static void *allocate_entries(objectreader_t *reader, uint32_t count, size_t size) {
+        void *entries;
+
+        if(reader->damaged || count > reader->size - reader->position) {
+                reader->damaged = 1;
+                return NULL;
+        }
+
+        entries = calloc(count + 1, size);
+        if(entries == NULL) {
+                STDERR("the object files could not be read\n");
+                EFAILURE;
+        }
+
+        return entries;
+}
+
+/* Names a floating section after its module as well, as in "CODE@main.obj". */
+static atom_t name_placedsection(atom_t name, const char *objectfile_name) {
+        const char *section_name;
+        char *placed_name;
+        atom_t atom;
+
+        section_name = get_atomname(name);
+        placed_name = malloc(strlen(section_name) + strlen(objectfile_name) + 2);
+        if(placed_name == NULL) {
+                STDERR("the object files could not be read\n");
+                EFAILURE;
+        }
+        sprintf(placed_name, "%s@%s", section_name, objectfile_name);
+        atom = intern_string(placed_name, strlen(placed_name));
+        free(placed_name);
+
+        return atom;
+}
+
+static void read_objectfile(objectfile_t *objectfile) {
+        objectreader_t reader;
+        linksection_t *section;
+        linkrun_t *run;
+        linkpublic_t *public;
+        linkrelocation_t *relocation;
+        const uint8_t *signature;
+        uint32_t index;
+        uint16_t file;
+
+        reader.data = objectfile->data;
+        reader.size = objectfile->size;
+        reader.position = 0;
+        reader.damaged = 0;
+
+        signature = get_objectdata(&reader, 6);
+        if(signature == NULL || memcmp(signature, "Z80OBJ", 6) != 0) {
+                STDERR("%s is not an object file\n", objectfile->name);
+                EFAILURE;
+        }
+        if(get_objectbytes(&reader, 2) != OBJECT_VERSION) {
+                STDERR("%s was written by another version of z80asm\n", objectfile->name);
+                EFAILURE;
+        }
+
+        objectfile->place_given = get_objectbytes(&reader, 1);
+        objectfile->place_first = get_objectbytes(&reader, 4);
+        objectfile->place_end = get_objectbytes(&reader, 4);
+        if(objectfile->place_first > objectfile->place_end ||
+           objectfile->place_end > 0x10000)
+                reader.damaged = 1;
+
+        objectfile->n_sections = get_objectbytes(&reader, 4);
+        objectfile->sections = allocate_entries(&reader, objectfile->n_sections,
+                                                sizeof(*objectfile->sections));
+        for(index = 0; !reader.damaged && index < objectfile->n_sections; ++index) {
+                section = &objectfile->sections[index];
+                section->name = get_objectname(&reader);
+                section->line = get_objectbytes(&reader, 4);
+                section->size = get_objectbytes(&reader, 4);
+                section->alignment = get_objectbytes(&reader, 4);
+                if(section->size > 0xFFFF || section->alignment == 0 ||
+                   section->alignment > 0x10000)
+                        reader.damaged = 1;
+                if(!reader.damaged)
+                        section->placed_name = name_placedsection(section->name,
+                                                                  objectfile->name);
+        }
+
+        objectfile->n_runs = get_objectbytes(&reader, 4);
+        objectfile->runs = allocate_entries(&reader, objectfile->n_runs,
+                                            sizeof(*objectfile->runs));
+        for(index = 0; !reader.damaged && index < objectfile->n_runs; ++index) {
+                run = &objectfile->runs[index];
+                run->address = get_objectbytes(&reader, 2);
+                run->section = get_objectbytes(&reader, 4);
+                run->length = get_objectbytes(&reader, 4);
+                run->statement.line = get_objectbytes(&reader, 4);
+                run->statement.atom = get_objectname(&reader);
+                run->bytes = get_objectdata(&reader, run->length);
+                if(run->section != NO_SECTION && run->section >= objectfile->n_sections)
+                        reader.damaged = 1;
+                if(reader.damaged)
+                        break;
+                if(name_sourcefile(get_atomname(run->statement.atom), &file) == ERROR) {
+                        STDERR("the object files could not be read\n");
+                        EFAILURE;
+                }
+                run->statement.file = file;
+        }
+
+        objectfile->n_publics = get_objectbytes(&reader, 4);
+        objectfile->publics = allocate_entries(&reader, objectfile->n_publics,
+                                               sizeof(*objectfile->publics));
+        for(index = 0; !reader.damaged && index < objectfile->n_publics; ++index) {
+                public = &objectfile->publics[index];
+                public->name = get_objectname(&reader);
+                public->section = get_objectbytes(&reader, 4);
+                public->value = get_objectbytes(&reader, 2);
+                if(public->section != NO_SECTION &&
+                   public->section >= objectfile->n_sections)
+                        reader.damaged = 1;
+        }
+
+        objectfile->n_relocations = get_objectbytes(&reader, 4);
+        objectfile->relocations = allocate_entries(&reader, objectfile->n_relocations,
+                                                   sizeof(*objectfile->relocations));
+        for(index = 0; !reader.damaged && index < objectfile->n_relocations; ++index) {
+                relocation = &objectfile->relocations[index];
+                relocation->run = get_objectbytes(&reader, 4);
+                relocation->offset = get_objectbytes(&reader, 4);
+                relocation->symbol = get_objectname(&reader);
+                relocation->addend = get_objectbytes(&reader, 2);
+                relocation->kind = get_objectbytes(&reader, 1);
+                /* The relocations are in the order of their runs. */
+                if(relocation->run >= objectfile->n_runs ||
+                   (index > 0 && relocation->run < relocation[-1].run) ||
+                   relocation->kind > RELOCATE_HIGH ||
+                   relocation->offset >= objectfile->runs[relocation->run].length ||
+                   objectfile->runs[relocation->run].length - relocation->offset <
+                   (relocation->kind == RELOCATE_WORD ? 2u : 1u))
+                        reader.damaged = 1;
+        }
+
+        if(reader.damaged || reader.position != reader.size) {
+                STDERR("the object file (%s) is damaged\n", objectfile->name);
+                EFAILURE;
+        }
+}
+
+static void map_objectfile(objectfile_t *objectfile) {
+        struct stat file_status;
+        int descriptor;
+
+        descriptor = open(objectfile->name, O_RDONLY);
+        if(descriptor < 0 || fstat(descriptor, &file_status) != 0 ||
+           file_status.st_size == 0) {
+                if(descriptor >= 0)
+                        close(descriptor);
+                STDERR("the object file (%s) could not be read\n", objectfile->name);
+                EFAILURE;
+        }
+
+        if(note_inputfile(objectfile->name) == ERROR) {
+                close(descriptor);
+                STDERR("the object file (%s) could not be read\n", objectfile->name);
+                EFAILURE;
+        }
+        objectfile->size = file_status.st_size;
+        objectfile->data = mmap(NULL, objectfile->size, PROT_READ, MAP_PRIVATE,
+                                descriptor, 0);
+        close(descriptor);
+        if(objectfile->data == MAP_FAILED) {
+                objectfile->data = NULL;
+                STDERR("the object file (%s) could not be read\n", objectfile->name);
+                EFAILURE;
+        }
+}
+
+/* Gives the address of the floating section a module names, once it is placed. */
+static uint16_t get_sectionorigin(const linksection_t *section,
+                                  const symboltable_t *symboltable_list) {
+        uint32_t index;
+
+        lookup_symbol(section->placed_name, &index);
+
+        return symboltable_list[index].value[0] |
+                (uint16_t) (symboltable_list[index].value[1] << 8);
+}
+
+static void define_publics(const objectfile_t *objectfile,
+                           symboltable_t **symboltable_list,
+                           uint32_t *symboltable_currentsize,
+                           uint32_t *symboltable_actualsize) {
+        const linkpublic_t *public;
+        uint32_t index;
+        uint16_t value;
+        uint8_t bytes[2];
+
+        for(index = 0; index < objectfile->n_publics; ++index) {
+                public = &objectfile->publics[index];
+                value = public->value;
+                if(public->section != NO_SECTION)
+                        value += get_sectionorigin(&objectfile->sections[public->section],
+                                                   *symboltable_list);
+
+                bytes[0] = (uint8_t) value;
+                bytes[1] = (uint8_t) (value >> 8);
+                storein_symboltable(public->name, MEMORY_16_BIT, 2, bytes,
+                                    symboltable_list, symboltable_currentsize,
+                                    symboltable_actualsize);
+        }
+}
+
+/* Gives the value of the symbol a relocation of the module names. */
+static data_status_t find_relocationtarget(const objectfile_t *objectfile, atom_t symbol,
+                                           const symboltable_t *symboltable_list,
+                                           uint16_t *value) {
+        uint32_t index;
+
+        for(index = 0; index < objectfile->n_sections; ++index)
+                if(objectfile->sections[index].name == symbol) {
+                        *value = get_sectionorigin(&objectfile->sections[index],
+                                                   symboltable_list);
+                        return VALID;
+                }
+
+        if(lookup_symbol(symbol, &index) == INVALID ||
+           symboltable_list[index].value_status != DEFINED)
+                return INVALID;
+
+        *value = symboltable_list[index].value[0] |
+                (uint16_t) (symboltable_list[index].value[1] << 8);
+
+        return VALID;
+}
+
+/* Copies the runs of the module to their addresses and fills in their relocations. */
+static status_t emit_objectfile(const objectfile_t *objectfile,
+                                const symboltable_t *symboltable_list,
+                                outputimage_t *outputimage) {
+        const linkrun_t *run;
+        const linkrelocation_t *relocation, *relocations_end;
+        uint32_t index;
+        uint16_t address, value;
+        uint8_t *output;
+        status_t status;
+
+        status = NO_ERROR;
+        relocation = objectfile->relocations;
+        relocations_end = relocation + objectfile->n_relocations;
+        for(index = 0; index < objectfile->n_runs; ++index) {
+                run = &objectfile->runs[index];
+                address = run->address;
+                if(run->section != NO_SECTION)
+                        address += get_sectionorigin(&objectfile->sections[run->section],
+                                                     symboltable_list);
+
+                output = reserve_inimage(outputimage, address, run->length,
+                                         &run->statement);
+                if(output == NULL) {
+                        STDERR("the output image could not be extended\n");
+                        EFAILURE;
+                }
+                memcpy(output, run->bytes, run->length);
+
+                for(; relocation < relocations_end && relocation->run == index;
+                    ++relocation) {
+                        if(find_relocationtarget(objectfile, relocation->symbol,
+                                                 symboltable_list, &value) == INVALID) {
+                                STDERR("line %u of %s: the symbol \"%s\" used by %s is "
+                                       "not PUBLIC in any module\n", run->statement.line,
+                                       get_atomname(run->statement.atom),
+                                       get_atomname(relocation->symbol),
+                                       objectfile->name);
+                                status = ERROR;
+                                continue;
+                        }
+                        value += relocation->addend;
+                        if(relocation->kind == RELOCATE_WORD) {
+                                output[relocation->offset] = (uint8_t) value;
+                                output[relocation->offset + 1] = (uint8_t) (value >> 8);
+                        }
+                        else if(relocation->kind == RELOCATE_LOW)
+                                output[relocation->offset] = (uint8_t) value;
+                        else
+                                output[relocation->offset] = (uint8_t) (value >> 8);
+                }
+        }
+
+        return status;
+}
+
+/* Links the object files given so far into the output image. */
+status_t link_objectfiles(symboltable_t **symboltable_list,
+                          uint32_t *symboltable_currentsize,
+                          uint32_t *symboltable_actualsize, outputimage_t *outputimage) {
+        objectfile_t *objectfile;
+        linksection_t *section;
+        linkrun_t *run;
+        uint32_t index, i;
+        status_t status;
+
+        begin_tracespan("reading object files", "link");
+        for(index = 0; index < objectfiles_currentsize; ++index) {
+                map_objectfile(&objectfiles[index]);
+                read_objectfile(&objectfiles[index]);
+        }
+        end_tracespan("reading object files", "link");
+
+        begin_tracespan("placement", "link");
+        for(index = 0; index < objectfiles_currentsize; ++index) {
+                objectfile = &objectfiles[index];
+                if(objectfile->place_given)
+                        bound_placement(objectfile->place_first, objectfile->place_end,
+                                        index + 1);
+                for(i = 0; i < objectfile->n_sections; ++i) {
+                        section = &objectfile->sections[i];
+                        add_floatingsection(section->placed_name, section->line,
+                                            section->size, section->alignment);
+                }
+                for(i = 0; i < objectfile->n_runs; ++i) {
+                        run = &objectfile->runs[i];
+                        if(run->section == NO_SECTION)
+                                reserve_memoryblock(run->address, run->length);
+                }
+        }
+        place_sections(0, symboltable_list, symboltable_currentsize,
+                       symboltable_actualsize);
+        end_tracespan("placement", "link");
+
+        begin_tracespan("relocation", "link");
+        for(index = 0; index < objectfiles_currentsize; ++index)
+                define_publics(&objectfiles[index], symboltable_list,
+                               symboltable_currentsize, symboltable_actualsize);
+
+        status = NO_ERROR;
+        for(index = 0; index < objectfiles_currentsize; ++index)
+                if(emit_objectfile(&objectfiles[index], *symboltable_list,
+                                   outputimage) == ERROR)
+                        status = ERROR;
+        end_tracespan("relocation", "link");
+
+        return status;
+}
+
+void free_links(void) {
+        objectfile_t *objectfile;
+        uint32_t index;
+
+        for(index = 0; index < objectfiles_currentsize; ++index) {
+                objectfile = &objectfiles[index];
+                if(objectfile->data != NULL)
+                        munmap(objectfile->data, objectfile->size);
+                free(objectfile->sections);
+                free(objectfile->runs);
+                free(objectfile->publics);
+                free(objectfile->relocations);
+        }
+
+        free(objectfiles);
+        objectfiles = NULL;
+        objectfiles_currentsize = objectfiles_actualsize = 0;
+}
@@ -0,0 +1,49 @@
+// File: link.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the linker. The object files of the modules given with --link are
+ * read, their floating sections placed together around the bytes they put at fixed
+ * addresses, and their relocations filled in with the values of the PUBLIC symbols, to
+ * give one output image.
+ */
+
+#ifndef LINK_H
+#define LINK_H
+
+#include <stdint.h>
+#include "defines.h"
+#include "image.h"
+
+status_t add_objectfile(const char *objectfile_name);
+
+uint32_t count_objectfiles(void);
+
+const char *get_objectfilename(uint32_t index);
+
+status_t link_objectfiles(symboltable_t **symboltable_list,
+                          uint32_t *symboltable_currentsize,
+                          uint32_t *symboltable_actualsize, outputimage_t *outputimage);
+
+void free_links(void);
+
+#endif
@@ -0,0 +1,932 @@
+// File: macro.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the macros. A macro is defined with its name and parameters on the
+ * MACRO line and ends at the first ENDM that does not close a macro defined inside it:
+ *
+ *      MACRO COPY FROM, TO, COUNT
+ *      LOCAL AGAIN
+ *      LD HL,FROM
+ *      ...
+ *      ENDM
+ *
+ * A line that starts with the name of a macro, after an optional label, is replaced by
+ * the body of the macro, with every parameter replaced by the tokens of its argument
+ * and every name given on a LOCAL line renamed for that expansion alone. The body may
+ * use other macros and define macros of its own, which each use of it defines again.
+ *
+ * IRP repeats the lines up to its ENDR once for every item that follows its parameter,
+ * with the parameter replaced by the item:
+ *
+ *      IRP PAIR, BC, DE, HL
+ *      PUSH PAIR
+ *      ENDR
+ *
+ * Macros are defined and expanded when the first pass meets them, so that the lines a
+ * conditional leaves out neither define nor use any. The pass then walks the tokens of
+ * the expansion and goes back to the line after the one that used the macro once they
+ * are over. Every line that defines or uses a macro is recorded in the order it is met,
+ * and the second pass takes the recorded steps one after the other.
+ *
+ * An expansion is kept once it is made, and the next use of the macro with the same
+ * arguments copies it and renames its local labels instead of expanding it again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defines.h"
+#include "arena.h"
+#include "hash.h"
+#include "intern.h"
+#include "lexer.h"
+#include "task.h"
+#include "parse.h"
+#include "macro.h"
+
+/* A macro that uses a macro that uses a macro and so on deeper than this is taken to
+   use itself. */
+#define MACRO_MAXDEPTH 64
+
+#define NO_MACRO UINT32_MAX
+
+typedef struct macro_t {
+        atom_t name;
+        atom_t *parameters;
+        uint32_t n_parameters;
+        atom_t *locals;
+        uint32_t n_locals;
+        token_t *body;
+        uint32_t n_tokens;
+        /* The text of the MACRO word, which is where it was written in the source for
+           every expansion of the macro that defines it. */
+        const char *origin;
+} macro_t;
+
+/* The tokens a macro expanded to for one list of arguments, with the positions of the
+   local labels to rename when they are used again. */
+typedef struct expansion_t {
+        token_t *tokens;
+        uint32_t n_tokens;
+        uint32_t *local_positions;
+        uint32_t n_localpositions;
+} expansion_t;
+
+/* A line that defines or uses a macro, or starts an IRP: the word it starts with, the
+   tokens it expands to, or none for a definition, and the position it ends at. */
+typedef struct macrostep_t {
+        const token_t *site;
+        token_t *tokens;
+        uint32_t n_tokens;
+        uint32_t end;
+} macrostep_t;
+
+/* The tokens an expansion was entered from, and the position to go back to. */
+typedef struct expansionframe_t {
+        token_t *tokens;
+        uint32_t n_tokens, position;
+} expansionframe_t;
+
+typedef struct tokenbuffer_t {
+        token_t *tokens;
+        uint32_t n_tokens, capacity;
+} tokenbuffer_t;
+
+static arena_t *macro_arena;
+
+static macro_t *macros;
+static uint32_t macros_currentsize, macros_actualsize;
+
+/* The index of the macro of every atom that names one, or NO_MACRO. */
+static uint32_t *macro_indices;
+static uint32_t macroindices_size;
+
+/* The expansions made so far, keyed by the macro and the tokens of its arguments. */
+static expansion_t *expansions;
+static uint32_t expansions_currentsize, expansions_actualsize;
+static hashtable_t expansion_index;
+
+static uint32_t n_locallabels;
+
+/* The macro lines met by the first pass, in order, for the second pass to take the
+   same steps. */
+static macrostep_t *macrosteps;
+static uint32_t macrosteps_currentsize, macrosteps_actualsize;
+static uint32_t next_macrostep;
+
+/* The expansion being made, before it is copied to the arena. */
+static tokenbuffer_t expansion_buffer;
+
+/* The expansions the tokens are being walked in, the innermost last. */
+static expansionframe_t *expansionframes;
+static uint32_t expansionframes_currentsize, expansionframes_actualsize;
+
+static void append_tokens(tokenbuffer_t *tokenbuffer, const token_t *tokens,
+                          uint32_t n_tokens) {
+        token_t *new_tokens;
+        uint32_t capacity;
+
+        if(n_tokens == 0)
+                return;
+        if(tokenbuffer->n_tokens + n_tokens > tokenbuffer->capacity) {
+                capacity = tokenbuffer->capacity ? tokenbuffer->capacity : 1024;
+                while(capacity < tokenbuffer->n_tokens + n_tokens)
+                        capacity *= 2;
+                new_tokens = realloc(tokenbuffer->tokens, capacity * sizeof(*new_tokens));
+                if(new_tokens == NULL) {
+                        STDERR("the macros could not be expanded\n");
+                        EFAILURE;
+                }
+                tokenbuffer->tokens = new_tokens;
+                tokenbuffer->capacity = capacity;
+        }
+
+        memcpy(&tokenbuffer->tokens[tokenbuffer->n_tokens], tokens,
+               n_tokens * sizeof(*tokens));
+        tokenbuffer->n_tokens += n_tokens;
+}
+
+static void *copyto_arena(const void *memory, size_t size) {
+        void *copy;
+
+        copy = reserve_inarena(macro_arena, size ? size : 1);
+        if(copy == NULL) {
+                STDERR("the macros could not be expanded\n");
+                EFAILURE;
+        }
+        if(size > 0)
+                memcpy(copy, memory, size);
+
+        return copy;
+}
+
+static int testif_lineend(const token_t *token) {
+        return token->type == TOKEN_NEWLINE || token->type == TOKEN_COMMENT ||
+               token->type == TOKEN_END;
+}
+
+static int testif_comma(const token_t *token) {
+        return token->type == TOKEN_PUNCTUATION && token->text[0] == ',';
+}
+
+/* Gives the position of the newline that ends the line, or the end of the tokens. */
+static uint32_t find_lineend(const token_t *tokens, uint32_t n_tokens, uint32_t index) {
+        while(index < n_tokens && tokens[index].type != TOKEN_NEWLINE &&
+              tokens[index].type != TOKEN_END)
+                ++index;
+
+        return index;
+}
+
+static const macro_t *find_macro(atom_t atom) {
+        if(atom >= macroindices_size || macro_indices[atom] == NO_MACRO)
+                return NULL;
+
+        return &macros[macro_indices[atom]];
+}
+
+static void add_macro(const macro_t *macro) {
+        macro_t *macros_newlist;
+        uint32_t *macro_newindices;
+        uint32_t size;
+
+        if(macros_currentsize == macros_actualsize) {
+                macros_newlist = realloc(macros, (macros_actualsize + 16) *
+                                         sizeof(*macros_newlist));
+                if(macros_newlist == NULL) {
+                        STDERR("the macros could not be expanded\n");
+                        EFAILURE;
+                }
+                macros = macros_newlist;
+                macros_actualsize += 16;
+        }
+
+        if(macro->name >= macroindices_size) {
+                size = get_natoms();
+                macro_newindices = realloc(macro_indices,
+                                           size * sizeof(*macro_newindices));
+                if(macro_newindices == NULL) {
+                        STDERR("the macros could not be expanded\n");
+                        EFAILURE;
+                }
+                macro_indices = macro_newindices;
+                while(macroindices_size < size)
+                        macro_indices[macroindices_size++] = NO_MACRO;
+        }
+
+        macro_indices[macro->name] = macros_currentsize;
+        macros[macros_currentsize++] = *macro;
+}
+
+/* Records the macro defined from the MACRO line at the index on, and gives the position
+   of the end of its ENDM line. LOCAL lines are taken out of the body. */
+static uint32_t define_macro(const token_t *tokens, uint32_t n_tokens, uint32_t index) {
+        macro_t macro;
+        tokenbuffer_t body;
+        atom_t *locals;
+        uint32_t position, end, depth, line, n_locals, i;
+        int valid, closed;
+
+        line = tokens[index].line;
+        position = index + 1;
+        if(position >= n_tokens || tokens[position].type != TOKEN_IDENTIFIER ||
+           tokens[position].atom < N_PREDEFINEDATOMS) {
+                STDERR("line %u: MACRO needs the name of the macro\n", line);
+                EFAILURE;
+        }
+        macro.name = tokens[position++].atom;
+        macro.origin = tokens[index].text;
+        /* A macro defined in the body of another is defined again by every use of
+           that one, and the latest definition is the one used from then on. */
+        if(find_macro(macro.name) != NULL &&
+           find_macro(macro.name)->origin != macro.origin) {
+                STDERR("line %u: the macro (%s) is defined more than once\n", line,
+                       get_atomname(macro.name));
+                EFAILURE;
+        }
+
+        macro.n_parameters = 0;
+        valid = 1;
+        while(valid && position < n_tokens && !testif_lineend(&tokens[position])) {
+                if(macro.n_parameters > 0 && !testif_comma(&tokens[position++]))
+                        valid = 0;
+                else if(position >= n_tokens ||
+                        tokens[position++].type != TOKEN_IDENTIFIER)
+                        valid = 0;
+                else
+                        ++macro.n_parameters;
+        }
+        if(!valid) {
+                STDERR("line %u: the parameters of the macro (%s) must be names "
+                       "separated by commas\n", line, get_atomname(macro.name));
+                EFAILURE;
+        }
+        macro.parameters = reserve_inarena(macro_arena, (macro.n_parameters + 1) *
+                                           sizeof(*macro.parameters));
+        if(macro.parameters == NULL) {
+                STDERR("the macros could not be expanded\n");
+                EFAILURE;
+        }
+        for(i = 0; i < macro.n_parameters; ++i)
+                macro.parameters[i] = tokens[index + 2 + 2 * i].atom;
+
+        body.tokens = NULL;
+        body.n_tokens = body.capacity = 0;
+        locals = NULL;
+        n_locals = 0;
+
+        depth = 0;
+        closed = 0;
+        position = find_lineend(tokens, n_tokens, position);
+        while(!closed && position + 1 < n_tokens &&
+              tokens[position].type == TOKEN_NEWLINE) {
+                ++position;
+                end = find_lineend(tokens, n_tokens, position);
+
+                if(tokens[position].type == TOKEN_IDENTIFIER) {
+                        if(tokens[position].atom == ATOM_MACRO)
+                                ++depth;
+                        else if(tokens[position].atom == ATOM_ENDM && depth == 0) {
+                                closed = 1;
+                                continue;
+                        }
+                        else if(tokens[position].atom == ATOM_ENDM)
+                                --depth;
+                        else if(tokens[position].atom == ATOM_LOCAL && depth == 0) {
+                                locals = realloc(locals, (n_locals + end - position) *
+                                                 sizeof(*locals));
+                                if(locals == NULL) {
+                                        STDERR("the macros could not be expanded\n");
+                                        EFAILURE;
+                                }
+                                for(i = position + 1; i < end; ++i) {
+                                        if(tokens[i].type == TOKEN_IDENTIFIER)
+                                                locals[n_locals++] = tokens[i].atom;
+                                        else if(tokens[i].type == TOKEN_COMMENT)
+                                                break;
+                                        else if(!testif_comma(&tokens[i])) {
+                                                STDERR("line %u: LOCAL needs names "
+                                                       "separated by commas\n",
+                                                       tokens[i].line);
+                                                EFAILURE;
+                                        }
+                                }
+                                position = end;
+                                continue;
+                        }
+                }
+
+                append_tokens(&body, &tokens[position],
+                              ((end < n_tokens) ? end + 1 : end) - position);
+                position = end;
+        }
+        if(!closed) {
+                STDERR("line %u: the macro (%s) has no ENDM\n", line,
+                       get_atomname(macro.name));
+                EFAILURE;
+        }
+
+        macro.body = copyto_arena(body.tokens, body.n_tokens * sizeof(*body.tokens));
+        macro.n_tokens = body.n_tokens;
+        macro.locals = copyto_arena(locals, n_locals * sizeof(*locals));
+        macro.n_locals = n_locals;
+        free(body.tokens);
+        free(locals);
+
+        add_macro(&macro);
+
+        return find_lineend(tokens, n_tokens, position);
+}
+
+/* Gives the local label a name of its own, made from the name it has in the body of
+   the macro. The name cannot be written in a source file, so it is never taken. */
+static void rename_locallabel(token_t *token, atom_t local) {
+        const char *name;
+        char *new_name;
+        size_t length;
+
+        name = get_atomname(local);
+        length = strcspn(name, "?");
+        new_name = malloc(length + 12);
+        if(new_name == NULL) {
+                STDERR("the macros could not be expanded\n");
+                EFAILURE;
+        }
+        sprintf(new_name, "%.*s?%u", (int) length, name, ++n_locallabels);
+
+        token->atom = intern_string(new_name, strlen(new_name));
+        if(token->atom == ATOM_NONE) {
+                STDERR("the macros could not be expanded\n");
+                EFAILURE;
+        }
+        free(new_name);
+        token->text = get_atomname(token->atom);
+        token->length = strlen(token->text);
+        token->flags |= TOKEN_LOCAL;
+}
+
+/* Copies a kept expansion, giving its local labels new names. Labels that had the same
+   name in the kept expansion are given the same new name. */
+static void reuse_expansion(const expansion_t *expansion, const token_t *site,
+                            tokenbuffer_t *output) {
+        token_t *tokens;
+        uint32_t base, i, j;
+
+        base = output->n_tokens;
+        append_tokens(output, expansion->tokens, expansion->n_tokens);
+        tokens = &output->tokens[base];
+
+        for(i = 0; i < expansion->n_tokens; ++i) {
+                tokens[i].line = site->line;
+                tokens[i].file = site->file;
+        }
+
+        for(i = 0; i < expansion->n_localpositions; ++i) {
+                for(j = 0; j < i; ++j) {
+                        if(expansion->tokens[expansion->local_positions[j]].atom ==
+                           expansion->tokens[expansion->local_positions[i]].atom)
+                                break;
+                }
+                if(j < i)
+                        tokens[expansion->local_positions[i]] =
+                                tokens[expansion->local_positions[j]];
+                else
+                        rename_locallabel(&tokens[expansion->local_positions[i]],
+                                          expansion->tokens[
+                                                  expansion->local_positions[i]].atom);
+        }
+}
+
+/* Keeps the expansion just made at the end of the output. */
+static void keep_expansion(const char *key, size_t key_length,
+                           const tokenbuffer_t *output, uint32_t base) {
+        expansion_t *expansions_newlist, *expansion;
+        uint32_t i, n_localpositions;
+
+        if(expansions_currentsize == expansions_actualsize) {
+                expansions_newlist = realloc(expansions, (expansions_actualsize + 64) *
+                                             sizeof(*expansions_newlist));
+                if(expansions_newlist == NULL) {
+                        STDERR("the macros could not be expanded\n");
+                        EFAILURE;
+                }
+                expansions = expansions_newlist;
+                expansions_actualsize += 64;
+        }
+
+        expansion = &expansions[expansions_currentsize];
+        expansion->n_tokens = output->n_tokens - base;
+        expansion->tokens = copyto_arena(&output->tokens[base], expansion->n_tokens *
+                                         sizeof(*expansion->tokens));
+
+        n_localpositions = 0;
+        for(i = 0; i < expansion->n_tokens; ++i) {
+                if(expansion->tokens[i].flags & TOKEN_LOCAL)
+                        ++n_localpositions;
+        }
+        expansion->local_positions = reserve_inarena(macro_arena, (n_localpositions + 1) *
+                                                     sizeof(*expansion->local_positions));
+        if(expansion->local_positions == NULL) {
+                STDERR("the macros could not be expanded\n");
+                EFAILURE;
+        }
+        expansion->n_localpositions = 0;
+        for(i = 0; i < expansion->n_tokens; ++i) {
+                if(expansion->tokens[i].flags & TOKEN_LOCAL)
+                        expansion->local_positions[expansion->n_localpositions++] = i;
+        }
+
+        if(insert_hashtable(&expansion_index, copyto_arena(key, key_length), key_length,
+                            expansions_currentsize) == ERROR) {
+                STDERR("the macros could not be expanded\n");
+                EFAILURE;
+        }
+        ++expansions_currentsize;
+}
+
+/* Gives the key of an expansion: the macro and the type, spacing and text of every
+   token of its arguments. */
+static char *make_expansionkey(uint32_t macro_index, const tokenrange_t *arguments,
+                               size_t *key_length) {
+        char *key, *position;
+        uint32_t i;
+
+        *key_length = sizeof(macro_index);
+        for(i = 0; i < arguments->n_tokens; ++i)
+                *key_length += 2 + sizeof(arguments->tokens[i].length) +
+                               arguments->tokens[i].length;
+
+        key = malloc(*key_length);
+        if(key == NULL) {
+                STDERR("the macros could not be expanded\n");
+                EFAILURE;
+        }
+
+        position = key;
+        memcpy(position, &macro_index, sizeof(macro_index));
+        position += sizeof(macro_index);
+        for(i = 0; i < arguments->n_tokens; ++i) {
+                *position++ = arguments->tokens[i].type;
+                *position++ = arguments->tokens[i].flags & TOKEN_SPACED;
+                memcpy(position, &arguments->tokens[i].length,
+                       sizeof(arguments->tokens[i].length));
+                position += sizeof(arguments->tokens[i].length);
+                memcpy(position, arguments->tokens[i].text, arguments->tokens[i].length);
+                position += arguments->tokens[i].length;
+        }
+
+        return key;
+}
+
+/* Appends the body with every parameter replaced by the tokens of its item and every
+   local label by its new name. */
+static void substitute_tokens(const token_t *body, uint32_t n_tokens,
+                              const atom_t *parameters, const tokenrange_t *items,
+                              uint32_t n_parameters, const atom_t *locals,
+                              const atom_t *local_atoms, uint32_t n_locals,
+                              tokenbuffer_t *output) {
+        token_t *token;
+        uint32_t base, i, j, k;
+
+        for(i = 0; i < n_tokens; ++i) {
+                if(body[i].type != TOKEN_IDENTIFIER) {
+                        append_tokens(output, &body[i], 1);
+                        continue;
+                }
+
+                for(j = 0; j < n_parameters; ++j) {
+                        if(body[i].atom == parameters[j])
+                                break;
+                }
+                if(j < n_parameters) {
+                        base = output->n_tokens;
+                        append_tokens(output, items[j].tokens, items[j].n_tokens);
+                        output->tokens[base].flags =
+                                (output->tokens[base].flags & ~TOKEN_SPACED) |
+                                (body[i].flags & TOKEN_SPACED);
+                        continue;
+                }
+
+                append_tokens(output, &body[i], 1);
+                for(k = 0; k < n_locals; ++k) {
+                        if(body[i].atom == locals[k])
+                                break;
+                }
+                if(k < n_locals) {
+                        token = &output->tokens[output->n_tokens - 1];
+                        token->atom = local_atoms[k];
+                        token->text = get_atomname(local_atoms[k]);
+                        token->length = strlen(token->text);
+                        token->flags |= TOKEN_LOCAL;
+                }
+        }
+}
+
+/* Makes the tokens of the expansion of the macro named by the site token, given the
+   tokens of its arguments. */
+static void invoke_macro(const macro_t *macro, const token_t *site,
+                         const tokenrange_t *arguments, tokenbuffer_t *output) {
+        tokenrange_t *items;
+        token_t local_token;
+        atom_t *local_atoms;
+        uint32_t position, n_items, value, i;
+        char *key;
+        size_t key_length;
+
+        key = make_expansionkey(macro - macros, arguments, &key_length);
+        if(lookup_hashtable(&expansion_index, key, key_length, &value) == VALID) {
+                reuse_expansion(&expansions[value], site, output);
+                free(key);
+                return;
+        }
+
+        items = malloc((macro->n_parameters + 1) * sizeof(*items));
+        local_atoms = malloc((macro->n_locals + 1) * sizeof(*local_atoms));
+        if(items == NULL || local_atoms == NULL) {
+                STDERR("the macros could not be expanded\n");
+                EFAILURE;
+        }
+
+        n_items = 0;
+        position = 0;
+        while(arguments->n_tokens > 0 && position <= arguments->n_tokens) {
+                if(n_items == macro->n_parameters ||
+                   extract_dataitem(arguments, &position, &items[n_items]) != VALID)
+                        break;
+                ++n_items;
+        }
+        if(n_items != macro->n_parameters ||
+           (arguments->n_tokens > 0 && position <= arguments->n_tokens)) {
+                STDERR("line %u: the macro (%s) takes %u arguments\n", site->line,
+                       get_atomname(macro->name), macro->n_parameters);
+                EFAILURE;
+        }
+
+        /* Every local label is given its new name once for the whole expansion. */
+        for(i = 0; i < macro->n_locals; ++i) {
+                local_token = *site;
+                rename_locallabel(&local_token, macro->locals[i]);
+                local_atoms[i] = local_token.atom;
+        }
+
+        substitute_tokens(macro->body, macro->n_tokens, macro->parameters, items,
+                          macro->n_parameters, macro->locals, local_atoms,
+                          macro->n_locals, output);
+        free(items);
+        free(local_atoms);
+
+        /* The expansion is taken to be on the line of the macro it came from. */
+        for(i = 0; i < output->n_tokens; ++i) {
+                output->tokens[i].line = site->line;
+                output->tokens[i].file = site->file;
+        }
+
+        keep_expansion(key, key_length, output, 0);
+        free(key);
+}
+
+/* Makes the lines between the IRP line at the index and its ENDR once for every item
+   of the IRP line, with the parameter replaced by the item, and gives the position of
+   the end of the ENDR line. */
+static uint32_t expand_irp(const token_t *tokens, uint32_t n_tokens, uint32_t index,
+                           tokenbuffer_t *output) {
+        tokenrange_t arguments, item;
+        atom_t parameter;
+        uint32_t line, position, start, end, nesting;
+
+        line = tokens[index].line;
+        if(index + 1 >= n_tokens || tokens[index + 1].type != TOKEN_IDENTIFIER ||
+           (index + 2 < n_tokens && !testif_lineend(&tokens[index + 2]) &&
+            !testif_comma(&tokens[index + 2]))) {
+                STDERR("line %u: IRP needs the name of a parameter\n", line);
+                EFAILURE;
+        }
+        parameter = tokens[index + 1].atom;
+
+        arguments.tokens = &tokens[index + 3];
+        arguments.n_tokens = 0;
+        if(index + 2 < n_tokens && testif_comma(&tokens[index + 2])) {
+                while(index + 3 + arguments.n_tokens < n_tokens &&
+                      !testif_lineend(&tokens[index + 3 + arguments.n_tokens]))
+                        ++arguments.n_tokens;
+        }
+
+        /* REPT and IRP both end at ENDR. */
+        nesting = 0;
+        start = end = find_lineend(tokens, n_tokens, index) + 1;
+        for(;;) {
+                if(end >= n_tokens) {
+                        STDERR("line %u: IRP without ENDR\n", line);
+                        EFAILURE;
+                }
+                if(tokens[end].type == TOKEN_IDENTIFIER) {
+                        if(tokens[end].atom == ATOM_REPT || tokens[end].atom == ATOM_IRP)
+                                ++nesting;
+                        else if(tokens[end].atom == ATOM_ENDR && nesting == 0)
+                                break;
+                        else if(tokens[end].atom == ATOM_ENDR)
+                                --nesting;
+                }
+                end = find_lineend(tokens, n_tokens, end) + 1;
+        }
+
+        position = 0;
+        while(arguments.n_tokens > 0 && position <= arguments.n_tokens) {
+                if(extract_dataitem(&arguments, &position, &item) != VALID) {
+                        STDERR("line %u: IRP has an empty item\n", line);
+                        EFAILURE;
+                }
+                substitute_tokens(&tokens[start], end - start, &parameter, &item, 1, NULL,
+                                  NULL, 0, output);
+        }
+
+        return find_lineend(tokens, n_tokens, end);
+}
+
+/* Ends the expansion with an end token on the line of the site, and keeps a copy of it
+   in the arena for the second pass. */
+static token_t *finish_expansion(tokenbuffer_t *expansion, const token_t *site) {
+        token_t end_token;
+
+        end_token = *site;
+        end_token.type = TOKEN_END;
+        end_token.text = "";
+        end_token.length = 0;
+        end_token.flags = 0;
+        end_token.atom = ATOM_NONE;
+        append_tokens(expansion, &end_token, 1);
+
+        return copyto_arena(expansion->tokens, expansion->n_tokens * sizeof(*site));
+}
+
+static void record_macrostep(const token_t *site, token_t *tokens, uint32_t n_tokens,
+                             uint32_t end) {
+        macrostep_t *macrosteps_newlist;
+
+        if(macrosteps_currentsize == macrosteps_actualsize) {
+                macrosteps_newlist = realloc(macrosteps, (macrosteps_actualsize + 64) *
+                                             sizeof(*macrosteps_newlist));
+                if(macrosteps_newlist == NULL) {
+                        STDERR("the macros could not be expanded\n");
+                        EFAILURE;
+                }
+                macrosteps = macrosteps_newlist;
+                macrosteps_actualsize += 64;
+        }
+
+        macrosteps[macrosteps_currentsize].site = site;
+        macrosteps[macrosteps_currentsize].tokens = tokens;
+        macrosteps[macrosteps_currentsize].n_tokens = n_tokens;
+        macrosteps[macrosteps_currentsize++].end = end;
+}
+
+/* Goes into the tokens of an expansion, to come back to the position given once they
+   are over. */
+static void enter_expansion(tokenstream_t *tokenstream, token_t *tokens,
+                            uint32_t n_tokens, uint32_t end, line_status_t *line_status) {
+        expansionframe_t *expansionframes_newlist;
+
+        if(expansionframes_currentsize == expansionframes_actualsize) {
+                expansionframes_newlist = realloc(expansionframes,
+                                                  (expansionframes_actualsize + 16) *
+                                                  sizeof(*expansionframes_newlist));
+                if(expansionframes_newlist == NULL) {
+                        STDERR("the macros could not be expanded\n");
+                        EFAILURE;
+                }
+                expansionframes = expansionframes_newlist;
+                expansionframes_actualsize += 16;
+        }
+
+        expansionframes[expansionframes_currentsize].tokens = tokenstream->tokens;
+        expansionframes[expansionframes_currentsize].n_tokens = tokenstream->n_tokens;
+        expansionframes[expansionframes_currentsize++].position = end;
+
+        tokenstream->tokens = tokens;
+        tokenstream->n_tokens = n_tokens;
+        tokenstream->position = 0;
+        *line_status = get_linestatus(tokenstream);
+}
+
+const token_t *find_macrobody(atom_t name, uint32_t *n_tokens) {
+        const macro_t *macro;
+
+        macro = find_macro(name);
+        if(macro == NULL)
+                return NULL;
+        *n_tokens = macro->n_tokens;
+
+        return macro->body;
+}
+
+void init_macros(arena_t *arena) {
+        macro_arena = arena;
+}
+
+void handle_macro(tokenstream_t *tokenstream, atom_t directive,
+                  line_status_t *line_status) {
+        token_t *tokens;
+        uint32_t word, line, end;
+
+        word = tokenstream->position - 1;
+        line = tokenstream->tokens[word].line;
+        if(directive == ATOM_ENDM || directive == ATOM_LOCAL) {
+                STDERR("line %u: %s is only allowed in a macro\n", line,
+                       get_atomname(directive));
+                EFAILURE;
+        }
+        if(word > 0 && tokenstream->tokens[word - 1].type != TOKEN_NEWLINE) {
+                STDERR("line %u: %s must be the first word of its line\n", line,
+                       get_atomname(directive));
+                EFAILURE;
+        }
+
+        if(directive == ATOM_MACRO) {
+                end = define_macro(tokenstream->tokens, tokenstream->n_tokens, word);
+                record_macrostep(&tokenstream->tokens[word], NULL, 0, end);
+                tokenstream->position = end;
+                *line_status = get_linestatus(tokenstream);
+                return;
+        }
+
+        if(expansionframes_currentsize == MACRO_MAXDEPTH) {
+                STDERR("line %u: IRP is nested too deeply\n", line);
+                EFAILURE;
+        }
+        expansion_buffer.n_tokens = 0;
+        end = expand_irp(tokenstream->tokens, tokenstream->n_tokens, word,
+                         &expansion_buffer);
+        tokens = finish_expansion(&expansion_buffer, &tokenstream->tokens[word]);
+        record_macrostep(&tokenstream->tokens[word], tokens, expansion_buffer.n_tokens,
+                         end);
+        enter_expansion(tokenstream, tokens, expansion_buffer.n_tokens, end, line_status);
+}
+
+void expand_repeat(tokenstream_t *tokenstream, uint32_t word, uint32_t body_end,
+                   uint32_t end, uint32_t count, line_status_t *line_status) {
+        const token_t *body;
+        token_t label_token, *tokens;
+        atom_t *labels, *label_atoms;
+        uint32_t start, n_tokens, n_labels, i, j;
+
+        if(expansionframes_currentsize == MACRO_MAXDEPTH) {
+                STDERR("line %u: REPT is nested too deeply\n",
+                       tokenstream->tokens[word].line);
+                EFAILURE;
+        }
+
+        start = tokenstream->position;
+        while(tokenstream->tokens[start].type != TOKEN_NEWLINE)
+                ++start;
+        body = &tokenstream->tokens[start + 1];
+        n_tokens = body_end + 1 - (start + 1);
+
+        /* The labels defined in the block are renamed in every copy, as the local
+           labels of a macro are. */
+        labels = malloc((n_tokens + 1) * sizeof(*labels));
+        label_atoms = malloc((n_tokens + 1) * sizeof(*label_atoms));
+        if(labels == NULL || label_atoms == NULL) {
+                STDERR("the macros could not be expanded\n");
+                EFAILURE;
+        }
+        n_labels = 0;
+        for(i = 0; i + 1 < n_tokens; ++i) {
+                if((i == 0 || body[i - 1].type == TOKEN_NEWLINE) &&
+                   body[i].type == TOKEN_IDENTIFIER &&
+                   body[i + 1].type == TOKEN_PUNCTUATION && body[i + 1].text[0] == ':' &&
+                   !(body[i + 1].flags & TOKEN_SPACED))
+                        labels[n_labels++] = body[i].atom;
+        }
+
+        expansion_buffer.n_tokens = 0;
+        for(i = 0; i < count; ++i) {
+                for(j = 0; j < n_labels; ++j) {
+                        label_token = tokenstream->tokens[word];
+                        rename_locallabel(&label_token, labels[j]);
+                        label_atoms[j] = label_token.atom;
+                }
+                substitute_tokens(body, n_tokens, NULL, NULL, 0, labels, label_atoms,
+                                  n_labels, &expansion_buffer);
+        }
+        free(labels);
+        free(label_atoms);
+
+        tokens = finish_expansion(&expansion_buffer, &tokenstream->tokens[word]);
+        record_macrostep(&tokenstream->tokens[word], tokens, expansion_buffer.n_tokens,
+                         end);
+        enter_expansion(tokenstream, tokens, expansion_buffer.n_tokens, end, line_status);
+}
+
+data_status_t expand_macro(tokenstream_t *tokenstream, atom_t name,
+                           line_status_t *line_status) {
+        const macro_t *macro;
+        const token_t *site;
+        tokenrange_t arguments;
+        token_t *tokens;
+        uint32_t end;
+
+        macro = find_macro(name);
+        if(macro == NULL)
+                return INVALID;
+
+        site = &tokenstream->tokens[tokenstream->position - 1];
+        if(expansionframes_currentsize == MACRO_MAXDEPTH) {
+                STDERR("line %u: the macro (%s) is nested too deeply\n", site->line,
+                       get_atomname(name));
+                EFAILURE;
+        }
+
+        /* The arguments run up to the end of the line or a comment. */
+        arguments.tokens = &site[1];
+        arguments.n_tokens = 0;
+        while(!testif_lineend(&arguments.tokens[arguments.n_tokens]))
+                ++arguments.n_tokens;
+        end = tokenstream->position + arguments.n_tokens;
+
+        expansion_buffer.n_tokens = 0;
+        invoke_macro(macro, site, &arguments, &expansion_buffer);
+        tokens = finish_expansion(&expansion_buffer, site);
+        record_macrostep(site, tokens, expansion_buffer.n_tokens, end);
+        enter_expansion(tokenstream, tokens, expansion_buffer.n_tokens, end, line_status);
+
+        return VALID;
+}
+
+program_status_t leave_expansion(tokenstream_t *tokenstream, tokenrange_t *word,
+                                 line_status_t *line_status) {
+        expansionframe_t *frame;
+
+        while(expansionframes_currentsize > 0) {
+                frame = &expansionframes[--expansionframes_currentsize];
+                tokenstream->tokens = frame->tokens;
+                tokenstream->n_tokens = frame->n_tokens;
+                tokenstream->position = frame->position;
+                if(extract_nearestword(tokenstream, word, line_status) == CONTINUE_PARSE)
+                        return CONTINUE_PARSE;
+        }
+
+        return STOP_PARSE;
+}
+
+data_status_t replay_macro(tokenstream_t *tokenstream, line_status_t *line_status) {
+        const macrostep_t *step;
+
+        if(next_macrostep == macrosteps_currentsize ||
+           macrosteps[next_macrostep].site != &tokenstream->tokens[tokenstream->position - 1])
+                return INVALID;
+
+        step = &macrosteps[next_macrostep++];
+        if(step->tokens == NULL) {
+                tokenstream->position = step->end;
+                *line_status = get_linestatus(tokenstream);
+        }
+        else
+                enter_expansion(tokenstream, step->tokens, step->n_tokens, step->end,
+                                line_status);
+
+        return VALID;
+}
+
+void free_macros(void) {
+        free(macros);
+        macros = NULL;
+        macros_currentsize = macros_actualsize = 0;
+        free(macro_indices);
+        macro_indices = NULL;
+        macroindices_size = 0;
+
+        free(expansions);
+        expansions = NULL;
+        expansions_currentsize = expansions_actualsize = 0;
+        free_hashtable(&expansion_index);
+        n_locallabels = 0;
+
+        free(macrosteps);
+        macrosteps = NULL;
+        macrosteps_currentsize = macrosteps_actualsize = next_macrostep = 0;
+        free(expansion_buffer.tokens);
+        expansion_buffer.tokens = NULL;
+        expansion_buffer.n_tokens = expansion_buffer.capacity = 0;
+        free(expansionframes);
+        expansionframes = NULL;
+        expansionframes_currentsize = expansionframes_actualsize = 0;
+}
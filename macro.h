@@ -0,0 +1,57 @@
+// File: macro.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the macros. A macro is defined by the lines between MACRO and
+ * ENDM, which are kept as tokens, and is expanded by replacing its parameters with the
+ * tokens of the arguments it is given. Macros are defined and expanded when the first
+ * pass meets them, and both passes walk the tokens of an expansion in place of the line
+ * that used the macro.
+ */
+
+#ifndef MACRO_H
+#define MACRO_H
+
+#include "defines.h"
+#include "arena.h"
+#include "lexer.h"
+
+void init_macros(arena_t *arena);
+
+void handle_macro(tokenstream_t *tokenstream, atom_t directive,
+                  line_status_t *line_status);
+
+data_status_t expand_macro(tokenstream_t *tokenstream, atom_t name,
+                           line_status_t *line_status);
+
+void expand_repeat(tokenstream_t *tokenstream, uint32_t word, uint32_t body_end,
+                   uint32_t end, uint32_t count, line_status_t *line_status);
+
+program_status_t leave_expansion(tokenstream_t *tokenstream, tokenrange_t *word,
+                                 line_status_t *line_status);
+
+data_status_t replay_macro(tokenstream_t *tokenstream, line_status_t *line_status);
+
+const token_t *find_macrobody(atom_t name, uint32_t *n_tokens);
+
+void free_macros(void);
+
+#endif
@@ -0,0 +1,485 @@
+// File: object.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the modules. In a module, EXTERN names the symbols that other
+ * modules define and PUBLIC the symbols it defines for them:
+ *
+ *      EXTERN PRINT, BUFFER
+ *      PUBLIC MAIN
+ *
+ * The names of EXTERN and the names of the floating sections are given their values by
+ * the linker. An operand or a data item that depends on them must come down to one of
+ * them moved by a known value, or to the LOW or HIGH byte of that; its bytes are left
+ * to the linker as a relocation, recorded at the offset of the bytes in the output
+ * image. The relocations of an operand are held until the instruction has been encoded,
+ * and then placed at the bytes its value went to.
+ *
+ * The object file is little-endian, with every name given by its length and its
+ * characters:
+ *
+ *      "Z80OBJ", version           2 bytes of version
+ *      PLACE                       given (1 byte), first, end (4 bytes each)
+ *      floating sections           count, then name, line, size, alignment of each
+ *      runs                        count, then address (2 bytes), section, length,
+ *                                  line, file name and the bytes of each
+ *      PUBLIC symbols              count, then name, section, value (2 bytes) of each
+ *      relocations                 count, then run, offset into the run, symbol,
+ *                                  addend (2 bytes) and kind (1 byte) of each
+ *
+ * A section or a run that is not in a floating section is given as NO_SECTION.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defines.h"
+#include "intern.h"
+#include "lexer.h"
+#include "task.h"
+#include "parse.h"
+#include "expr.h"
+#include "image.h"
+#include "source.h"
+#include "section.h"
+#include "object.h"
+
+typedef struct relocation_t {
+        /* The offset of the bytes in the output image. */
+        uint32_t offset;
+        atom_t symbol;
+        uint16_t addend;
+        uint8_t kind;
+        /* The operand the relocation was held for, OP1 or OP2, while it is held. */
+        uint8_t operand;
+} relocation_t;
+
+typedef struct publicsymbol_t {
+        atom_t name;
+        uint32_t line;
+} publicsymbol_t;
+
+static int object_output;
+
+static relocation_t *relocations;
+static uint32_t relocations_currentsize, relocations_actualsize;
+
+/* An instruction has two operands at most. */
+static relocation_t held_relocations[2];
+static uint32_t n_heldrelocations;
+
+static publicsymbol_t *publicsymbols;
+static uint32_t publicsymbols_currentsize, publicsymbols_actualsize;
+
+void enable_objectoutput(void) {
+        object_output = 1;
+}
+
+/* Tells whether the source is assembled as a module. */
+int testif_objectoutput(void) {
+        return object_output;
+}
+
+/* Defines a symbol whose value is given by the linker. */
+void declare_relocatable(atom_t symbol, symboltable_t **symboltable_list,
+                         uint32_t *symboltable_currentsize,
+                         uint32_t *symboltable_actualsize) {
+        uint8_t bytes[2];
+        uint32_t index;
+
+        bytes[0] = bytes[1] = 0;
+        storein_symboltable(symbol, MEMORY_16_BIT, 2, bytes, symboltable_list,
+                            symboltable_currentsize, symboltable_actualsize);
+        if(lookup_symbol(symbol, &index) == VALID)
+                (*symboltable_list)[index].value_status = RELOCATABLE;
+}
+
+static void record_public(atom_t name, uint32_t line) {
+        publicsymbol_t *publicsymbols_newlist;
+
+        if(publicsymbols_currentsize == publicsymbols_actualsize) {
+                publicsymbols_newlist = realloc(publicsymbols,
+                                                (publicsymbols_actualsize * 2 + 16) *
+                                                sizeof(*publicsymbols_newlist));
+                if(publicsymbols_newlist == NULL) {
+                        STDERR("the PUBLIC symbols could not be recorded\n");
+                        EFAILURE;
+                }
+                publicsymbols = publicsymbols_newlist;
+                publicsymbols_actualsize = publicsymbols_actualsize * 2 + 16;
+        }
+
+        publicsymbols[publicsymbols_currentsize].name = name;
+        publicsymbols[publicsymbols_currentsize++].line = line;
+}
+
+/* Handles EXTERN and PUBLIC. Outside a module PUBLIC has nothing to export to and is
+   let through, while EXTERN could never be given its values. */
+void handle_linkage(tokenstream_t *tokenstream, atom_t directive,
+                    symboltable_t **symboltable_list, uint32_t *symboltable_currentsize,
+                    uint32_t *symboltable_actualsize, line_status_t *line_status) {
+        tokenrange_t dir_arg, name;
+        uint32_t line, position, n_names;
+
+        line = tokenstream->tokens[tokenstream->position - 1].line;
+        extract_direxpression(tokenstream, line_status, &dir_arg);
+
+        if(directive == ATOM_EXTERN && !object_output) {
+                STDERR("line %u: EXTERN can only be used in a module, assembled with -c\n",
+                       line);
+                EFAILURE;
+        }
+
+        position = n_names = 0;
+        while(position <= dir_arg.n_tokens) {
+                if(extract_dataitem(&dir_arg, &position, &name) != VALID ||
+                   checkif_symbolworthy(&name) != VALID) {
+                        STDERR("line %u: %s needs the names of symbols\n", line,
+                               get_atomname(directive));
+                        EFAILURE;
+                }
+                if(directive == ATOM_EXTERN)
+                        declare_relocatable(name.tokens[0].atom, symboltable_list,
+                                            symboltable_currentsize,
+                                            symboltable_actualsize);
+                else if(object_output)
+                        record_public(name.tokens[0].atom, line);
+                ++n_names;
+        }
+
+        if(n_names == 0) {
+                STDERR("line %u: %s needs the names of symbols\n", line,
+                       get_atomname(directive));
+                EFAILURE;
+        }
+}
+
+static void record_relocation(uint32_t offset, atom_t symbol, uint16_t addend,
+                              uint8_t kind) {
+        relocation_t *relocations_newlist;
+
+        if(relocations_currentsize == relocations_actualsize) {
+                relocations_newlist = realloc(relocations,
+                                              (relocations_actualsize * 2 + 16) *
+                                              sizeof(*relocations_newlist));
+                if(relocations_newlist == NULL) {
+                        STDERR("the relocations could not be recorded\n");
+                        EFAILURE;
+                }
+                relocations = relocations_newlist;
+                relocations_actualsize = relocations_actualsize * 2 + 16;
+        }
+
+        relocations[relocations_currentsize].offset = offset;
+        relocations[relocations_currentsize].symbol = symbol;
+        relocations[relocations_currentsize].addend = addend;
+        relocations[relocations_currentsize++].kind = kind;
+}
+
+/* Splits the expression into the symbol given its value by the linker, the value added
+   to it and the kind of relocation, and gives the value the bytes hold until they are
+   linked. */
+static data_status_t split_relocatable(exprnode_t *node, symboltable_t *symboltable_list,
+                                       relocation_t *relocation, uint16_t *value) {
+        relocation->kind = RELOCATE_WORD;
+        if(node->operation == EXPR_LOW || node->operation == EXPR_HIGH) {
+                relocation->kind = (node->operation == EXPR_LOW) ? RELOCATE_LOW :
+                        RELOCATE_HIGH;
+                node = node->left;
+        }
+
+        if(!object_output ||
+           split_relocation(node, symboltable_list, &relocation->symbol,
+                            &relocation->addend) != VALID ||
+           relocation->symbol == ATOM_NONE)
+                return INVALID;
+
+        *value = relocation->addend;
+        if(relocation->kind == RELOCATE_LOW)
+                *value &= 0xFF;
+        else if(relocation->kind == RELOCATE_HIGH)
+                *value >>= 8;
+
+        return VALID;
+}
+
+/* Holds the relocation of an operand whose value is given by the linker, until the
+   instruction it is an operand of is encoded. */
+data_status_t hold_relocation(exprnode_t *node, symboltable_t *symboltable_list,
+                              uint16_t *value) {
+        relocation_t *relocation;
+
+        if(n_heldrelocations == 2)
+                return INVALID;
+
+        relocation = &held_relocations[n_heldrelocations];
+        if(split_relocatable(node, symboltable_list, relocation, value) != VALID)
+                return INVALID;
+        relocation->operand = NONE_AFFECTED;
+        ++n_heldrelocations;
+
+        return VALID;
+}
+
+/* Tells the relocations held since the last call that they belong to the operand. */
+void tag_relocations(uint8_t operand) {
+        uint32_t index;
+
+        for(index = 0; index < n_heldrelocations; ++index)
+                if(held_relocations[index].operand == NONE_AFFECTED)
+                        held_relocations[index].operand = operand;
+}
+
+/* Records the held relocations at the bytes of the instruction just emitted that the
+   value of their operand went to: a byte for LOW or HIGH, a word otherwise. */
+void place_relocations(const outputimage_t *outputimage, const uint8_t binary_code[],
+                       uint8_t instruction_length, uint32_t line) {
+        relocation_t *relocation;
+        uint32_t index, offset;
+        uint8_t i, width;
+
+        offset = outputimage->size - instruction_length;
+        for(index = 0; index < n_heldrelocations; ++index) {
+                relocation = &held_relocations[index];
+                for(i = 0; i < instruction_length; ++i) {
+                        if((binary_code[i] & 0xC0) != relocation->operand ||
+                           (binary_code[i] & 0x30) != ALLBITS)
+                                continue;
+                        width = ((binary_code[i] & 0x08) == _16BITVAL) ? 2 : 1;
+                        if(width == 2 && (binary_code[i] & 0x04) != LBYTE)
+                                continue;
+                        if((width == 2) == (relocation->kind == RELOCATE_WORD))
+                                break;
+                }
+
+                if(i == instruction_length) {
+                        STDERR("line %u: the operand cannot be given its value by the "
+                               "linker\n", line);
+                        EFAILURE;
+                }
+                record_relocation(offset + i, relocation->symbol, relocation->addend,
+                                  relocation->kind);
+        }
+
+        n_heldrelocations = 0;
+}
+
+/* Records the relocation of a data item of n_bytes at the offset in the output image,
+   and gives the value its bytes hold until they are linked. */
+data_status_t relocate_dataitem(exprnode_t *node, symboltable_t *symboltable_list,
+                                uint32_t offset, uint8_t n_bytes, uint16_t *value) {
+        relocation_t relocation;
+
+        if(split_relocatable(node, symboltable_list, &relocation, value) != VALID ||
+           (n_bytes == 2) != (relocation.kind == RELOCATE_WORD))
+                return INVALID;
+
+        record_relocation(offset, relocation.symbol, relocation.addend, relocation.kind);
+
+        return VALID;
+}
+
+/* Repeats the relocations of the length bytes at the offset for every copy of them that
+   REPT made right after them. */
+void repeat_relocations(uint32_t offset, uint32_t length, uint32_t count) {
+        uint32_t first, end, index, copy;
+
+        end = relocations_currentsize;
+        for(first = end; first > 0 && relocations[first - 1].offset >= offset; --first)
+                ;
+
+        for(copy = 1; copy <= count; ++copy)
+                for(index = first; index < end; ++index)
+                        record_relocation(relocations[index].offset + copy * length,
+                                          relocations[index].symbol,
+                                          relocations[index].addend,
+                                          relocations[index].kind);
+}
+
+static void put_objectbytes(FILE *objectfile_handle, uint32_t value, int n_bytes) {
+        int i;
+
+        for(i = 0; i < n_bytes; ++i)
+                fputc((uint8_t) (value >> (8 * i)), objectfile_handle);
+}
+
+static void put_objectname(FILE *objectfile_handle, const char *name) {
+        uint32_t length;
+
+        length = strlen(name);
+        put_objectbytes(objectfile_handle, length, 2);
+        fwrite(name, 1, length, objectfile_handle);
+}
+
+/* Gives the index among the floating sections written to the object file of the
+   floating section named by the symbol, or NO_SECTION. */
+static uint32_t find_objectsection(atom_t symbol, const uint32_t *section_indexes) {
+        uint32_t index, size, alignment, line;
+
+        for(index = 0; index < count_sections(); ++index)
+                if(section_indexes[index] != NO_SECTION &&
+                   describe_section(index, &size, &alignment, &line) == symbol)
+                        return section_indexes[index];
+
+        return NO_SECTION;
+}
+
+static status_t write_publicsymbols(symboltable_t *symboltable_list,
+                                    const uint32_t *section_indexes,
+                                    FILE *objectfile_handle) {
+        publicsymbol_t *publicsymbol;
+        symboltable_t *entry;
+        exprnode_t node;
+        uint32_t index, symbol_index, section;
+        uint16_t value;
+        atom_t symbol;
+        status_t status;
+
+        status = NO_ERROR;
+        put_objectbytes(objectfile_handle, publicsymbols_currentsize, 4);
+        for(index = 0; index < publicsymbols_currentsize; ++index) {
+                publicsymbol = &publicsymbols[index];
+                value = 0;
+                section = NO_SECTION;
+
+                /* The symbol is worked out as an expression of its own name, which comes
+                   down to a known value or to a floating section moved by one. */
+                memset(&node, 0, sizeof(node));
+                node.operation = EXPR_SYMBOL;
+                node.symbol = publicsymbol->name;
+                if(lookup_symbol(publicsymbol->name, &symbol_index) == INVALID ||
+                   symboltable_list[symbol_index].value_status == UNDEFINED) {
+                        STDERR("line %u: the PUBLIC symbol \"%s\" is not defined\n",
+                               publicsymbol->line, get_atomname(publicsymbol->name));
+                        status = ERROR;
+                        continue;
+                }
+                entry = &symboltable_list[symbol_index];
+                if(split_relocation(&node, symboltable_list, &symbol, &value) != VALID ||
+                   (symbol != ATOM_NONE &&
+                    (section = find_objectsection(symbol, section_indexes)) ==
+                    NO_SECTION)) {
+                        STDERR("line %u: the PUBLIC symbol \"%s\" depends on a symbol of "
+                               "another module\n", publicsymbol->line, entry->name);
+                        status = ERROR;
+                        continue;
+                }
+
+                put_objectname(objectfile_handle, entry->name);
+                put_objectbytes(objectfile_handle, section, 4);
+                put_objectbytes(objectfile_handle, value, 2);
+        }
+
+        return status;
+}
+
+/* Writes the module to the object file. */
+status_t write_objectfile(const outputimage_t *outputimage,
+                          symboltable_t *symboltable_list, FILE *objectfile_handle) {
+        const imagerun_t *run;
+        relocation_t *relocation;
+        uint32_t *section_indexes;
+        uint32_t index, n_sections, size, alignment, line, first, end;
+        atom_t name;
+        status_t status;
+
+        section_indexes = malloc((count_sections() + 1) * sizeof(*section_indexes));
+        if(section_indexes == NULL) {
+                STDERR("the object file could not be written\n");
+                return ERROR;
+        }
+
+        fputs("Z80OBJ", objectfile_handle);
+        put_objectbytes(objectfile_handle, OBJECT_VERSION, 2);
+
+        put_objectbytes(objectfile_handle, get_placebounds(&first, &end), 1);
+        put_objectbytes(objectfile_handle, first, 4);
+        put_objectbytes(objectfile_handle, end, 4);
+
+        n_sections = 0;
+        for(index = 0; index < count_sections(); ++index) {
+                section_indexes[index] = NO_SECTION;
+                if(describe_section(index, &size, &alignment, &line) != ATOM_NONE)
+                        section_indexes[index] = n_sections++;
+        }
+        put_objectbytes(objectfile_handle, n_sections, 4);
+        for(index = 0; index < count_sections(); ++index) {
+                name = describe_section(index, &size, &alignment, &line);
+                if(name == ATOM_NONE)
+                        continue;
+                put_objectname(objectfile_handle, get_atomname(name));
+                put_objectbytes(objectfile_handle, line, 4);
+                put_objectbytes(objectfile_handle, size, 4);
+                put_objectbytes(objectfile_handle, alignment, 4);
+        }
+
+        put_objectbytes(objectfile_handle, outputimage->n_runs, 4);
+        for(index = 0; index < outputimage->n_runs; ++index) {
+                run = &outputimage->runs[index];
+                put_objectbytes(objectfile_handle, run->address, 2);
+                put_objectbytes(objectfile_handle, (run->section == NO_SECTION) ?
+                                NO_SECTION : section_indexes[run->section], 4);
+                put_objectbytes(objectfile_handle, run->length, 4);
+                put_objectbytes(objectfile_handle, run->statement->line, 4);
+                put_objectname(objectfile_handle,
+                               get_sourcefilename(run->statement->file));
+                fwrite(&outputimage->bytes[run->offset], 1, run->length,
+                       objectfile_handle);
+        }
+
+        status = write_publicsymbols(symboltable_list, section_indexes,
+                                     objectfile_handle);
+
+        /* The relocations are recorded in the order of their bytes, and so are the
+           runs. */
+        put_objectbytes(objectfile_handle, relocations_currentsize, 4);
+        run = outputimage->runs;
+        for(index = 0; index < relocations_currentsize; ++index) {
+                relocation = &relocations[index];
+                while(relocation->offset >= run->offset + run->length)
+                        ++run;
+                put_objectbytes(objectfile_handle, run - outputimage->runs, 4);
+                put_objectbytes(objectfile_handle, relocation->offset - run->offset, 4);
+                put_objectname(objectfile_handle, get_atomname(relocation->symbol));
+                put_objectbytes(objectfile_handle, relocation->addend, 2);
+                put_objectbytes(objectfile_handle, relocation->kind, 1);
+        }
+
+        free(section_indexes);
+
+        if(ferror(objectfile_handle))
+                status = ERROR;
+
+        return status;
+}
+
+void free_objects(void) {
+        free(relocations);
+        relocations = NULL;
+        relocations_currentsize = relocations_actualsize = 0;
+        n_heldrelocations = 0;
+
+        free(publicsymbols);
+        publicsymbols = NULL;
+        publicsymbols_currentsize = publicsymbols_actualsize = 0;
+
+        object_output = 0;
+}
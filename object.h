@@ -0,0 +1,79 @@
+// File: object.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the modules. A source assembled with -c is a module: instead of a
+ * HEX file it gives an object file with its bytes, its floating sections, the symbols
+ * it makes PUBLIC and the relocations that the linker fills in with the values of the
+ * symbols it uses from other modules.
+ */
+
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "defines.h"
+#include "lexer.h"
+#include "expr.h"
+#include "image.h"
+
+/* The version of the object file, raised whenever its layout changes. */
+#define OBJECT_VERSION 1
+
+/* The offset of a data item that cannot be left to the linker. */
+#define NO_RELOCATION UINT32_MAX
+
+/* How the value of a relocation is put in the bytes. */
+typedef enum relocation_kind_t {RELOCATE_WORD = 0, RELOCATE_LOW,
+                                RELOCATE_HIGH} relocation_kind_t;
+
+void enable_objectoutput(void);
+
+int testif_objectoutput(void);
+
+void declare_relocatable(atom_t symbol, symboltable_t **symboltable_list,
+                         uint32_t *symboltable_currentsize,
+                         uint32_t *symboltable_actualsize);
+
+void handle_linkage(tokenstream_t *tokenstream, atom_t directive,
+                    symboltable_t **symboltable_list, uint32_t *symboltable_currentsize,
+                    uint32_t *symboltable_actualsize, line_status_t *line_status);
+
+data_status_t hold_relocation(exprnode_t *node, symboltable_t *symboltable_list,
+                              uint16_t *value);
+
+void tag_relocations(uint8_t operand);
+
+void place_relocations(const outputimage_t *outputimage, const uint8_t binary_code[],
+                       uint8_t instruction_length, uint32_t line);
+
+data_status_t relocate_dataitem(exprnode_t *node, symboltable_t *symboltable_list,
+                                uint32_t offset, uint8_t n_bytes, uint16_t *value);
+
+void repeat_relocations(uint32_t offset, uint32_t length, uint32_t count);
+
+status_t write_objectfile(const outputimage_t *outputimage,
+                          symboltable_t *symboltable_list, FILE *objectfile_handle);
+
+void free_objects(void);
+
+#endif
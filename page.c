@@ -0,0 +1,123 @@
+// File: page.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the page tables. PAGETABLE is given the first address of a table
+ * and the address right after it, usually two labels:
+ *
+ *      PAGETABLE SINES, SINES_END
+ *
+ * The addresses are compiled as expressions in the first pass and worked out once the
+ * first pass is over, so the table may be tagged before it is defined.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "defines.h"
+#include "lexer.h"
+#include "parse.h"
+#include "expr.h"
+#include "object.h"
+#include "page.h"
+
+typedef struct pagetable_t {
+        exprnode_t *first, *end;
+        uint32_t line;
+} pagetable_t;
+
+static pagetable_t *pagetables;
+static uint32_t pagetables_currentsize, pagetables_actualsize;
+
+void record_pagetable(const tokenrange_t *dir_arg, uint16_t location_counter,
+                      symboltable_t *symboltable_list) {
+        pagetable_t *pagetables_newlist, *pagetable;
+        tokenrange_t first, end;
+        uint32_t position, line;
+
+        line = dir_arg->tokens[0].line;
+        position = 0;
+        if(extract_dataitem(dir_arg, &position, &first) != VALID ||
+           extract_dataitem(dir_arg, &position, &end) != VALID ||
+           position <= dir_arg->n_tokens) {
+                STDERR("line %u: PAGETABLE needs the first address of the table and the "
+                       "address after it\n", line);
+                EFAILURE;
+        }
+
+        if(pagetables_currentsize == pagetables_actualsize) {
+                pagetables_newlist = realloc(pagetables, (pagetables_actualsize + 16) *
+                                             sizeof(*pagetables_newlist));
+                if(pagetables_newlist == NULL) {
+                        STDERR("the page tables could not be recorded\n");
+                        EFAILURE;
+                }
+                pagetables = pagetables_newlist;
+                pagetables_actualsize += 16;
+        }
+
+        pagetable = &pagetables[pagetables_currentsize++];
+        pagetable->line = line;
+        pagetable->first = compile_expression(first.tokens, first.n_tokens,
+                                              location_counter, symboltable_list);
+        pagetable->end = compile_expression(end.tokens, end.n_tokens, location_counter,
+                                            symboltable_list);
+        if(pagetable->first == NULL || pagetable->end == NULL) {
+                STDERR("line %u: the addresses of PAGETABLE could not be read\n", line);
+                EFAILURE;
+        }
+}
+
+/* Warns about every table whose first and last byte are in different pages. The tables
+   of a module whose addresses are given by the linker are left out. */
+void check_pagetables(symboltable_t *symboltable_list) {
+        pagetable_t *pagetable;
+        uint32_t index;
+        uint16_t first, end;
+
+        for(index = 0; index < pagetables_currentsize; ++index) {
+                pagetable = &pagetables[index];
+                if(testif_objectoutput() &&
+                   (testif_relocatable(pagetable->first, symboltable_list) == VALID ||
+                    testif_relocatable(pagetable->end, symboltable_list) == VALID))
+                        continue;
+                if(evaluate_expression(pagetable->first, symboltable_list,
+                                       &first) != VALID ||
+                   evaluate_expression(pagetable->end, symboltable_list, &end) != VALID) {
+                        STDERR("line %u: the addresses of PAGETABLE could not be worked "
+                               "out\n", pagetable->line);
+                        EFAILURE;
+                }
+
+                if(end < first)
+                        WARNING("line %u: the page table ends at %04XH, before it starts "
+                                "at %04XH\n", pagetable->line, end, first);
+                else if(end > first && (first >> 8) != ((end - 1) >> 8))
+                        WARNING("line %u: the page table from %04XH to %04XH crosses "
+                                "the page boundary at %04XH\n", pagetable->line, first,
+                                end - 1, (first & 0xFF00) + 0x100);
+        }
+}
+
+void free_pagetables(void) {
+        free(pagetables);
+        pagetables = NULL;
+        pagetables_currentsize = pagetables_actualsize = 0;
+}
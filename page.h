@@ -0,0 +1,42 @@
+// File: page.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the page tables. A table tagged with PAGETABLE is meant to sit in
+ * one 256-byte page, so that it can be walked by stepping the low byte of its address
+ * alone; once every address is known, a table that crosses a page boundary is warned
+ * about.
+ */
+
+#ifndef PAGE_H
+#define PAGE_H
+
+#include "defines.h"
+#include "lexer.h"
+
+void record_pagetable(const tokenrange_t *dir_arg, uint16_t location_counter,
+                      symboltable_t *symboltable_list);
+
+void check_pagetables(symboltable_t *symboltable_list);
+
+void free_pagetables(void);
+
+#endif
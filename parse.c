@@ -20,25 +20,40 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
 #include <string.h>
 #include "defines.h"
+#include "stats.h"
+#include "intern.h"
+#include "lexer.h"
+#include "task.h"
 #include "parse.h"
-
-void parse_instruction(FILE *file_handle, char *buffer,
+#include "expr.h"
+#include "source.h"
+#include "cond.h"
+#include "repeat.h"
+#include "macro.h"
+#include "page.h"
+#include "section.h"
+#include "bank.h"
+#include "object.h"
+
+/* Marks the atoms that are already in the list of tracked symbols. */
+static uint8_t *tracked_flags;
+static uint32_t trackedflags_size;
+
+void parse_instruction(tokenstream_t *tokenstream, atom_t instruction,
                        line_status_t *line_status,
                        instruction_parameters_t **instruction_set,
                        uint16_t *location_counter, symboltable_t **symboltable_list,
-                       uint8_t symboltable_currentsize,
-                       char ***symbolstracked_list, uint8_t *symbolstracked_currentsize,
-                       uint8_t *symbolstracked_actualsize) {
-        char *instruction, operand1[20], operand2[20];
+                       uint32_t symboltable_currentsize,
+                       atom_t **symbolstracked_list, uint32_t *symbolstracked_currentsize,
+                       uint32_t *symbolstracked_actualsize) {
+        tokenrange_t operand1, operand2;
         uint8_t operand1_type = NONE, operand2_type = NONE, n_operands;
         int c, mainindex, subindex;
         status_t status;
         data_status_t data_status;
 
-        instruction = buffer;
         n_operands = 0;
 
         if(*line_status == ENDOFFILE_DETECTED || *line_status == COMMNTDELIM_DETECTED ||
@@ -47,14 +62,15 @@ void parse_instruction(FILE *file_handle, char *buffer,
                 operand2_type = NONE;
         }
         else {
-                extract_operands(file_handle, operand1, operand2, line_status,
+                extract_operands(tokenstream, &operand1, &operand2, line_status,
                                  &n_operands);
                 if(n_operands == 0) {
                         operand1_type = NONE;
                         operand2_type = NONE;
                 }
                 else if(n_operands == 1) {
-                        operand1_type = parse_operandtype(operand1, symboltable_list,
+                        operand1_type = parse_operandtype(&operand1, *location_counter,
+                                                          symboltable_list,
                                                           symboltable_currentsize,
                                                           symbolstracked_list,
                                                           symbolstracked_currentsize,
@@ -62,12 +78,14 @@ void parse_instruction(FILE *file_handle, char *buffer,
                         operand2_type = NONE; 
                 }
                 else { //n_operands == 2
-                        operand1_type = parse_operandtype(operand1, symboltable_list,
+                        operand1_type = parse_operandtype(&operand1, *location_counter,
+                                                          symboltable_list,
                                                           symboltable_currentsize,
                                                           symbolstracked_list,
                                                           symbolstracked_currentsize,
                                                           symbolstracked_actualsize);
-                        operand2_type = parse_operandtype(operand2, symboltable_list,
+                        operand2_type = parse_operandtype(&operand2, *location_counter,
+                                                          symboltable_list,
                                                           symboltable_currentsize,
                                                           symbolstracked_list,
                                                           symbolstracked_currentsize,
@@ -75,9 +93,9 @@ void parse_instruction(FILE *file_handle, char *buffer,
                 }
         }
 
-        data_status = testif_instructionexistent(instruction, instruction_set,
-                                                 operand1_type, operand2_type,
-                                                 &mainindex, &subindex);
+        data_status = find_instructionform(instruction, instruction_set,
+                                           &operand1_type, &operand2_type,
+                                           &mainindex, &subindex);
 
         if(data_status != VALID) {
                 STDERR("invalid operands detected");
@@ -91,34 +109,151 @@ void parse_instruction(FILE *file_handle, char *buffer,
 
 
 
-uint8_t parse_operandtype(char *operand, symboltable_t **symboltable_list,
-                          uint8_t symboltable_currentsize,
-                          char ***symbolstracked_list,
-                          uint8_t *symbolstracked_currentsize,
-                          uint8_t *symbolstracked_actualsize) {
+/* Gives the part of an operand that is an expression and how the operand uses it: as
+   an address in parentheses, as the offset of an index register or as it is. */
+data_status_t split_operandexpression(const tokenrange_t *operand, uint8_t *operand_type,
+                                      tokenrange_t *expression) {
+        const token_t *tokens = operand->tokens;
+        uint32_t index, depth;
+
+        *operand_type = NONE;
+        expression->tokens = tokens;
+        expression->n_tokens = operand->n_tokens;
+
+        if(operand->n_tokens == 0)
+                return INVALID;
+
+        if(operand->n_tokens < 3 || tokens[0].type != TOKEN_PUNCTUATION ||
+           tokens[0].text[0] != '(')
+                return VALID;
+
+        /* The operand is only wrapped in parentheses if the first one is closed by
+           the last token, which is not the case in "(BASE+1)*2". */
+        depth = 0;
+        for(index = 0; index < operand->n_tokens; ++index) {
+                if(tokens[index].type != TOKEN_PUNCTUATION)
+                        continue;
+                if(tokens[index].text[0] == '(')
+                        ++depth;
+                else if(tokens[index].text[0] == ')' && --depth == 0)
+                        break;
+        }
+        if(index != operand->n_tokens - 1)
+                return VALID;
+
+        if(tokens[1].atom == ATOM_IX &&
+           tokens[2].type == TOKEN_PUNCTUATION &&
+           (tokens[2].text[0] == '+' || tokens[2].text[0] == '-'))
+                *operand_type = IX_REGISTER_WOFFSET;
+        else if(tokens[1].atom == ATOM_IY &&
+                tokens[2].type == TOKEN_PUNCTUATION &&
+                (tokens[2].text[0] == '+' || tokens[2].text[0] == '-'))
+                *operand_type = IY_REGISTER_WOFFSET;
+        else
+                *operand_type = MEMORY_16_BIT;
+
+        /* The sign in front of the offset is kept, so that "(IX-2)" gives -2. */
+        if(*operand_type == MEMORY_16_BIT) {
+                expression->tokens = &tokens[1];
+                expression->n_tokens = operand->n_tokens - 2;
+        }
+        else {
+                expression->tokens = &tokens[2];
+                expression->n_tokens = operand->n_tokens - 3;
+        }
+
+        return VALID;
+}
+
+/* Every symbol of the expression that is not defined yet is tracked, so that it is
+   known to be defined by the end of the first pass. */
+static data_status_t track_expressionsymbols(const exprnode_t *node,
+                                             atom_t **symbolstracked_list,
+                                             uint32_t *symbolstracked_currentsize,
+                                             uint32_t *symbolstracked_actualsize) {
+        uint32_t index;
+
+        if(node == NULL || node->state == EXPR_RESOLVED)
+                return VALID;
+
+        if(node->operation == EXPR_SYMBOL) {
+                if(lookup_symbol(node->symbol, &index) == VALID)
+                        return VALID;
+                return track_symbol(node->symbol, symbolstracked_list,
+                                    symbolstracked_currentsize,
+                                    symbolstracked_actualsize);
+        }
+
+        if(track_expressionsymbols(node->left, symbolstracked_list,
+                                   symbolstracked_currentsize,
+                                   symbolstracked_actualsize) == INVALID)
+                return INVALID;
+
+        return track_expressionsymbols(node->right, symbolstracked_list,
+                                       symbolstracked_currentsize,
+                                       symbolstracked_actualsize);
+}
+
+static uint8_t parse_operandexpression(const tokenrange_t *operand,
+                                       uint16_t location_counter,
+                                       symboltable_t **symboltable_list,
+                                       atom_t **symbolstracked_list,
+                                       uint32_t *symbolstracked_currentsize,
+                                       uint32_t *symbolstracked_actualsize) {
+        tokenrange_t expression;
+        exprnode_t *node;
+        uint8_t operand_type;
+
+        if(split_operandexpression(operand, &operand_type, &expression) == INVALID)
+                return INVALID_TYPE;
+
+        node = compile_expression(expression.tokens, expression.n_tokens,
+                                  location_counter, *symboltable_list);
+        if(node == NULL)
+                return INVALID_TYPE;
+
+        if(record_expression(expression.tokens, node) == ERROR ||
+           track_expressionsymbols(node, symbolstracked_list, symbolstracked_currentsize,
+                                   symbolstracked_actualsize) == INVALID) {
+                free(*symboltable_list);
+                free(*symbolstracked_list);
+                STDERR("symbols could not be tracked\n");
+                EFAILURE;
+        }
+
+        if(operand_type == NONE)
+                operand_type = node->type;
+
+        return operand_type;
+}
+
+uint8_t parse_operandtype(const tokenrange_t *operand, uint16_t location_counter,
+                          symboltable_t **symboltable_list,
+                          uint32_t symboltable_currentsize,
+                          atom_t **symbolstracked_list,
+                          uint32_t *symbolstracked_currentsize,
+                          uint32_t *symbolstracked_actualsize) {
         uint8_t operand_type;
         data_status_t data_status;
-        uint8_t byte_length;
-        int8_t index;
+        uint8_t byte_length, offset;
+        uint16_t value;
+        atom_t symbol;
 
         operand_type = NONE;
-        
-        index = strlen(operand) - 1;
-        if(operand[0] == '(' && operand[index] == ')') {
-                data_status = testif_memlocvalid(operand);
 
-                if(data_status == VALID)
-                        operand_type = MEMORY_16_BIT;
-                else {
-                        data_status = testif_indexregwoffset(operand, &operand_type);
+        data_status = testif_memlocvalid(operand, &value);
 
-                        if(data_status == INVALID) 
-                                operand_type = NONE;
-                }
+        if(data_status == VALID)
+                operand_type = MEMORY_16_BIT;
+        else {
+                data_status = testif_indexregwoffset(operand, &operand_type, &offset);
+
+                if(data_status == INVALID) 
+                        operand_type = NONE;
         }
 
-        if(operand_type == NONE) {
-                data_status = testif_numvalid(operand, &byte_length);
+        if(operand_type == NONE && operand->n_tokens == 1) {
+                data_status = parse_literal(&operand->tokens[0], &value, &byte_length);
 
                 if(data_status == VALID)
                         if(byte_length == 1)
@@ -128,8 +263,17 @@ uint8_t parse_operandtype(char *operand, symboltable_t **symboltable_list,
 
         }
 
+        /* Anything that is not a single name or a register is an expression. */
+        if(operand_type == NONE && get_operandatom(operand) == ATOM_NONE)
+                operand_type = parse_operandexpression(operand, location_counter,
+                                                       symboltable_list,
+                                                       symbolstracked_list,
+                                                       symbolstracked_currentsize,
+                                                       symbolstracked_actualsize);
+
         if(operand_type == NONE) {
-                data_status = testif_symbolexistent(operand, *symboltable_list,
+                symbol = get_operandatom(operand);
+                data_status = testif_symbolexistent(symbol, *symboltable_list,
                                                     symboltable_currentsize,
                                                     &operand_type);
 
@@ -141,7 +285,7 @@ uint8_t parse_operandtype(char *operand, symboltable_t **symboltable_list,
 
                         if(data_status == VALID) { //operand is symbol worthy
                                 operand_type = MEMORY_16_BIT;
-                                data_status = track_symbol(operand, symbolstracked_list,
+                                data_status = track_symbol(symbol, symbolstracked_list,
                                                            symbolstracked_currentsize,
                                                            symbolstracked_actualsize);
                                 if(data_status == INVALID) {
@@ -161,78 +305,59 @@ uint8_t parse_operandtype(char *operand, symboltable_t **symboltable_list,
         return operand_type;
 }
 
-data_status_t testif_memlocvalid(char* operand) {
-        data_status_t data_status;
-        int index, boundary;
+/* Tests if the operand is a number in parentheses, which is how a memory location is
+   given, and gives the address. */
+data_status_t testif_memlocvalid(const tokenrange_t *operand, uint16_t *address) {
+        const token_t *tokens = operand->tokens;
+        uint8_t byte_length;
 
-        data_status = VALIDITY_UNKNOWN;
-        
-        index = strlen(operand) - 2;
-        if(operand[index] == 'H' || operand[index] == 'h') {
-                boundary = strlen(operand) - 2;
-                
-                for(index = 1; index < boundary; ++index)
-                        if((operand[index] < '0' || operand[index] > '9') &&
-                           (operand[index] < 'A' || operand[index] > 'F') &&
-                           (operand[index] < 'a' || operand[index] > 'f'))
-                                data_status = INVALID;
-        }
-        else {
-                boundary = strlen(operand) - 1;
+        if(operand->n_tokens != 3 || tokens[0].type != TOKEN_PUNCTUATION ||
+           tokens[0].text[0] != '(' || tokens[2].type != TOKEN_PUNCTUATION ||
+           tokens[2].text[0] != ')')
+                return INVALID;
 
-                for(index = 1; index < boundary; ++index)
-                        if((operand[index] < '0' || operand[index] > '9'))
-                                data_status = INVALID;
-        }
-        
-        if(data_status == VALIDITY_UNKNOWN)
-                data_status = VALID;
-        
-        return data_status;
+        return parse_literal(&tokens[1], address, &byte_length);
 }
 
 
 
-data_status_t testif_symbolexistent(char *symbol, symboltable_t *symboltable_list,
-                                    uint8_t symboltable_currentsize,
+data_status_t testif_symbolexistent(atom_t symbol, symboltable_t *symboltable_list,
+                                    uint32_t symboltable_currentsize,
                                     uint8_t *type) {
-        int index;
+        uint32_t index;
         data_status_t data_status;
 
-        data_status = VALIDITY_UNKNOWN;
-
-        for(index = 0; index < symboltable_currentsize; ++index) {
-                if(!strcmp(symboltable_list[index].name, symbol)) {
-                        *type = symboltable_list[index].value_type;
-                        data_status = VALID;                        
-                }
-        }
+        data_status = lookup_symbol(symbol, &index);
+        if(data_status == VALID)
+                *type = symboltable_list[index].value_type;
 
-        
-        if(data_status == VALIDITY_UNKNOWN)
-                data_status = INVALID;
-        
         return data_status;
 }
 
-data_status_t checkif_symbolworthy(char *operand) {
+/* Tests if the operand is a single name that can be given to a symbol. */
+data_status_t checkif_symbolworthy(const tokenrange_t *operand) {
         data_status_t data_status;
+        const char *text;
         int index, boundary;
 
-        boundary = strlen(operand);
+        if(operand->n_tokens != 1)
+                return INVALID;
+
+        text = operand->tokens[0].text;
+        boundary = operand->tokens[0].length;
 
         data_status = VALIDITY_UNKNOWN;
 
-        if((operand[0] < 'A' || operand[0] > 'Z') &&
-           (operand[0] < 'a' || operand[0] > 'z') &&
-           operand[0] != '_')
+        if((text[0] < 'A' || text[0] > 'Z') &&
+           (text[0] < 'a' || text[0] > 'z') &&
+           text[0] != '_')
                 data_status = INVALID;
         
         for(index = 1; index < boundary; ++index) {
-                if((operand[index] < '0' || operand[index] > '9') &&
-                   operand[index] != '_' &&
-                   (operand[index] < 'A' || operand[index] > 'Z') &&
-                   (operand[index] < 'a' || operand[index] > 'z'))
+                if((text[index] < '0' || text[index] > '9') &&
+                   text[index] != '_' &&
+                   (text[index] < 'A' || text[index] > 'Z') &&
+                   (text[index] < 'a' || text[index] > 'z'))
                         data_status = INVALID;
         }
 
@@ -242,7 +367,7 @@ data_status_t checkif_symbolworthy(char *operand) {
         return data_status;
 }
 
-data_status_t testif_instructionexistent(char *instruction,
+data_status_t testif_instructionexistent(atom_t instruction,
                                          instruction_parameters_t **instruction_set,
                                          uint8_t operand1_type, uint8_t operand2_type,
                                          int *index1, int *index2) {
@@ -251,15 +376,15 @@ data_status_t testif_instructionexistent(char *instruction,
         data_status_t data_status;
 
         loop_status = CONTINUE;
-        mainindex = instruction[0] - 65;
+        mainindex = get_atomname(instruction)[0] - 65;
         subindex = 0;
 
         data_status = VALIDITY_UNKNOWN;
 
         while(instruction_set[mainindex][subindex].instruction_name != NULL &&
               loop_status == CONTINUE) {
-                if((!strcmp(instruction_set[mainindex][subindex].instruction_name,
-                           instruction)) &&
+                COUNT(instruction_probes);
+                if(get_instructionatom(mainindex, subindex) == instruction &&
                    instruction_set[mainindex][subindex].operand_type[0] == operand1_type &&
                    instruction_set[mainindex][subindex].operand_type[1] == operand2_type) {
                         data_status = VALID;
@@ -278,39 +403,88 @@ data_status_t testif_instructionexistent(char *instruction,
         return data_status;
 }
 
-void handle_label(char *label, symboltable_t **symboltable_list,
-                  uint16_t location_counter, uint8_t *symboltable_currentsize,
-                  uint8_t *symboltable_actualsize) {
-        int index, mainindex;
-        uint8_t value[2];
+/* Finds the form of the instruction the operands are used in. A two-byte value that no
+   form takes where a form takes a byte is taken as a byte, which must lie between -128
+   and 255 once it is known, as a byte of DB must. */
+data_status_t find_instructionform(atom_t instruction,
+                                   instruction_parameters_t **instruction_set,
+                                   uint8_t *operand1_type, uint8_t *operand2_type,
+                                   int *index1, int *index2) {
+        if(testif_instructionexistent(instruction, instruction_set, *operand1_type,
+                                      *operand2_type, index1, index2) == VALID)
+                return VALID;
+        if(*operand1_type != VALUE_16_BIT && *operand2_type != VALUE_16_BIT)
+                return INVALID;
+
+        if(*operand1_type == VALUE_16_BIT)
+                *operand1_type = VALUE_8_BIT;
+        if(*operand2_type == VALUE_16_BIT)
+                *operand2_type = VALUE_8_BIT;
+
+        return testif_instructionexistent(instruction, instruction_set, *operand1_type,
+                                          *operand2_type, index1, index2);
+}
 
-        label[(strlen(label) - 1)] = '\0';
+void handle_label(atom_t label, symboltable_t **symboltable_list,
+                  uint16_t location_counter, uint32_t *symboltable_currentsize,
+                  uint32_t *symboltable_actualsize) {
+        uint8_t value[2];
+        uint32_t index;
+        atom_t base;
 
         value[0] = (uint8_t) location_counter;
         value[1] = (uint8_t) (location_counter >> 8);
 
         storein_symboltable(label, MEMORY_16_BIT, 2, value, symboltable_list,
                             symboltable_currentsize, symboltable_actualsize);
+        if(testif_banked() && lookup_symbol(label, &index) == VALID)
+                (*symboltable_list)[index].bank = get_currentbank();
+
+        /* In a floating section the location counter is the offset into the section,
+           so the label is worked out once the section has been placed. */
+        base = get_sectionbase();
+        if(base != ATOM_NONE && lookup_symbol(label, &index) == VALID) {
+                (*symboltable_list)[index].value_status = DEFERRED;
+                (*symboltable_list)[index].value_expression =
+                        compile_address(base, location_counter);
+                if((*symboltable_list)[index].value_expression == NULL) {
+                        free(*symboltable_list);
+                        STDERR("the label \"%s\" could not be stored\n",
+                               get_atomname(label));
+                        EFAILURE;
+                }
+        }
 }
 
-void handle_directive(FILE *file_handle, char *directive, symboltable_t **symboltable_list,
-                      uint16_t *location_counter, uint8_t *symboltable_currentsize,
-                      uint8_t *symboltable_actualsize, line_status_t *line_status) {
+static void handle_equexpression(atom_t symbol, const tokenrange_t *dir_arg,
+                                 uint16_t location_counter,
+                                 symboltable_t **symboltable_list,
+                                 uint32_t *symboltable_currentsize,
+                                 uint32_t *symboltable_actualsize);
+
+void handle_directive(tokenstream_t *tokenstream, atom_t directive,
+                      symboltable_t **symboltable_list,
+                      uint16_t *location_counter, uint32_t *symboltable_currentsize,
+                      uint32_t *symboltable_actualsize, line_status_t *line_status) {
         status_t status;
-        char dir_arg1[20], dir_arg2[20];
+        uint32_t index, size;
+        tokenrange_t dir_arg1, dir_arg2;
         data_status_t data_status, symbol_status, value_status;
         uint8_t byte_length, value_type;
-        char value_toconvert[20];
+        uint16_t number;
         uint8_t value[2];
-        int index, boundary;
         uint8_t type;
+        atom_t symbol, value_symbol;
         
-        if(!strcmp("ORG", directive)) {
-                status = extract_dirarg(file_handle, 1, line_status,
-                                             dir_arg1, NULL);
-                data_status = testif_numvalid(dir_arg1, &byte_length);
-                if(data_status == VALID)
-                        *location_counter = asciistr_to16bitnum(dir_arg1);
+        if(directive == ATOM_ORG) {
+                status = extract_direxpression(tokenstream, line_status, &dir_arg1);
+                data_status = evaluate_dirarg(&dir_arg1, *location_counter,
+                                              *symboltable_list, &number);
+                if(data_status == VALID) {
+                        move_origin(dir_arg1.tokens[0].line, ATOM_ORG, *location_counter,
+                                    number);
+                        *location_counter = number;
+                }
                 else {
                         free(*symboltable_list);
                         STDERR("assigning invalid value to location counter\n");
@@ -318,9 +492,28 @@ void handle_directive(FILE *file_handle, char *directive, symboltable_t **symbol
                 }
         }
 
-        else if(!strcmp("EQU", directive)) {
-                status = extract_dirarg(file_handle, 2, line_status, dir_arg1, dir_arg2);
-                symbol_status = checkif_symbolworthy(dir_arg1);
+        else if(directive >= ATOM_DB && directive <= ATOM_ALIGN) {
+                status = extract_direxpression(tokenstream, line_status, &dir_arg1);
+                if(measure_data(directive, &dir_arg1, *location_counter,
+                                *symboltable_list, &size) != VALID) {
+                        free(*symboltable_list);
+                        STDERR("line %u: invalid data directive\n",
+                               dir_arg1.tokens[0].line);
+                        EFAILURE;
+                }
+                if(directive == ATOM_ALIGN)
+                        align_section(&dir_arg1, *location_counter, *symboltable_list);
+                *location_counter += size;
+        }
+
+        else if(directive == ATOM_EQU) {
+                status = extract_dirarg(tokenstream, 1, line_status, &dir_arg1, NULL);
+                if(status == NO_ERROR)
+                        status = extract_direxpression(tokenstream, line_status,
+                                                       &dir_arg2);
+                else
+                        dir_arg2.n_tokens = 0;
+                symbol_status = checkif_symbolworthy(&dir_arg1);
 
                 if(symbol_status != VALID) {
                         free(*symboltable_list);
@@ -328,151 +521,364 @@ void handle_directive(FILE *file_handle, char *directive, symboltable_t **symbol
                         EFAILURE;
                 }
 
-                value_status = parse_equvalue(dir_arg2, &type);
+                symbol = dir_arg1.tokens[0].atom;
+                value_status = parse_equvalue(&dir_arg2, &type, &number);
                 if(value_status == VALID) {
-                        if(type == MEMORY_16_BIT) {
-                                index = 1;
-                                boundary = strlen(dir_arg2) - 1;
-                                for(; index < boundary; ++index)
-                                        value_toconvert[index - 1] = dir_arg2[index];
-                                value_toconvert[index - 1] = '\0';
-                                value[0] = (uint8_t) asciistr_to16bitnum(value_toconvert);
-                                value[1] = (uint8_t)
-                                        (asciistr_to16bitnum(value_toconvert) >> 8);
-                                byte_length = 2;
-                        }
-                        else if(type == VALUE_16_BIT) {
-                                value[0] = (uint8_t) asciistr_to16bitnum(dir_arg2);
-                                value[1] = (uint8_t)
-                                        (asciistr_to16bitnum(dir_arg2) >> 8);
-                                byte_length = 2;
-                        }
-                        else {
-                                value[0] = (uint8_t) asciistr_to16bitnum(dir_arg2);
+                        value[0] = (uint8_t) number;
+                        value[1] = (uint8_t) (number >> 8);
+                        if(type == VALUE_8_BIT)
                                 byte_length = 1;
-                        }
-                        storein_symboltable(dir_arg1, type, byte_length, value,
+                        else
+                                byte_length = 2;
+                        storein_symboltable(symbol, type, byte_length, value,
                                             symboltable_list, symboltable_currentsize,
                                             symboltable_actualsize);
                 }
                 else {
-                        data_status = testif_symbolexistent(dir_arg2,
+                        value_symbol = get_operandatom(&dir_arg2);
+                        data_status = testif_symbolexistent(value_symbol,
                                                             *symboltable_list,
                                                             *symboltable_currentsize,
                                                             &type);
                         
-                        if(data_status == VALID) {
-                                get_symbolparams(dir_arg2, *symboltable_list,
+                        /* A symbol of a symbol file may yet be hidden by the source,
+                           so its value is not copied. */
+                        if(data_status == VALID && lookup_symbol(value_symbol, &index) ==
+                           VALID && (*symboltable_list)[index].value_status == DEFINED &&
+                           !(*symboltable_list)[index].imported) {
+                                get_symbolparams(value_symbol, *symboltable_list,
                                                  *symboltable_currentsize,
                                                  &byte_length, value);
-                                storein_symboltable(dir_arg1, type, byte_length,
+                                storein_symboltable(symbol, type, byte_length,
                                                     value, symboltable_list,
                                                     symboltable_currentsize,
                                                     symboltable_actualsize);
                         }
                         else {
-                                STDERR("could not store symbol\n");
+                                handle_equexpression(symbol, &dir_arg2,
+                                                     *location_counter,
+                                                     symboltable_list,
+                                                     symboltable_currentsize,
+                                                     symboltable_actualsize);
                         }
                 }
         }
+
+        else if(directive >= ATOM_IF && directive <= ATOM_ENDIF)
+                handle_conditional(tokenstream, directive, *symboltable_list,
+                                   *location_counter, line_status);
+
+        else if(directive == ATOM_PAGETABLE) {
+                status = extract_direxpression(tokenstream, line_status, &dir_arg1);
+                if(status == ERROR) {
+                        free(*symboltable_list);
+                        STDERR("PAGETABLE needs the addresses of the table\n");
+                        EFAILURE;
+                }
+                record_pagetable(&dir_arg1, *location_counter, *symboltable_list);
+        }
+
+        else if(directive == ATOM_REPT || directive == ATOM_ENDR)
+                handle_repeat(tokenstream, directive, *symboltable_list, location_counter,
+                              line_status);
+
+        else if(directive >= ATOM_SECTION && directive <= ATOM_PLACE)
+                handle_section(tokenstream, directive, symboltable_list, location_counter,
+                               symboltable_currentsize, symboltable_actualsize,
+                               line_status);
+
+        else if(directive == ATOM_BANK)
+                handle_bank(tokenstream, *symboltable_list, location_counter,
+                            line_status);
+
+        else if(directive == ATOM_EXTERN || directive == ATOM_PUBLIC)
+                handle_linkage(tokenstream, directive, symboltable_list,
+                               symboltable_currentsize, symboltable_actualsize,
+                               line_status);
+
+        else if((directive >= ATOM_MACRO && directive <= ATOM_LOCAL) ||
+                directive == ATOM_IRP)
+                handle_macro(tokenstream, directive, line_status);
+
+        /* INCLUDE lines are taken out before the first pass; one that is left was not
+           the first word of its line. */
+        else {
+                free(*symboltable_list);
+                STDERR("%s must be the first word of its line\n", get_atomname(directive));
+                EFAILURE;
+        }
 }
 
-status_t extract_dirarg(FILE *file_handle, uint8_t extract_ndirargs,
-                          line_status_t *line_status, char *dir_arg1, char *dir_arg2) {
-        int index, c;
-        char buffer[20];
-        status_t status;
-        uint8_t byte_length;
+/* Defines a symbol by an expression. If the expression depends on a symbol that is
+   not defined yet, or on one of a symbol file that the source may still hide, the
+   symbol is stored as deferred and given its value once the first pass is over; its
+   type is known already, so it can be used in the meantime. */
+static void handle_equexpression(atom_t symbol, const tokenrange_t *dir_arg,
+                                 uint16_t location_counter,
+                                 symboltable_t **symboltable_list,
+                                 uint32_t *symboltable_currentsize,
+                                 uint32_t *symboltable_actualsize) {
+        exprnode_t *node;
+        uint16_t number;
+        uint8_t value[2];
+        uint32_t index;
+        data_status_t data_status;
 
-        do {
-                c = fgetc(file_handle);
-        } while(c != EOF && (c == ' ' || c == '\t'));
+        node = compile_expression(dir_arg->tokens, dir_arg->n_tokens, location_counter,
+                                  *symboltable_list);
+        if(node == NULL) {
+                free(*symboltable_list);
+                STDERR("line %u: invalid EQU value\n", dir_arg->tokens[0].line);
+                EFAILURE;
+        }
 
-        if(c == EOF || c== '\n' || c== '\r' || c == ';') {
-                status = ERROR;
+        /* A value that depends on a symbol file is given but not remembered by the
+           node, so the node is left unresolved. */
+        data_status = evaluate_expression(node, *symboltable_list, &number);
+        if(data_status == VALID && node->state != EXPR_RESOLVED)
+                data_status = VALIDITY_UNKNOWN;
+        if(data_status != VALID)
+                number = 0;
+
+        value[0] = (uint8_t) number;
+        value[1] = (uint8_t) (number >> 8);
+        storein_symboltable(symbol, node->type, (node->type == VALUE_8_BIT) ? 1 : 2,
+                            value, symboltable_list, symboltable_currentsize,
+                            symboltable_actualsize);
+
+        if(data_status != VALID && lookup_symbol(symbol, &index) == VALID) {
+                (*symboltable_list)[index].value_status = DEFERRED;
+                (*symboltable_list)[index].value_expression = node;
         }
-        else {
-                index = 0;
-                do {
-                        buffer[index++] = c;
-                        c = fgetc(file_handle);
-                } while(c != EOF && c != ' ' && c != '\t' && c != '\n' && c != '\r' &&
-                        c != ';');
-                buffer[index] = '\0';
+}
 
-                status = NO_ERROR;
-                strcpy(dir_arg1, buffer);
-
-                if(c == EOF)
-                        *line_status = ENDOFFILE_DETECTED;
-                else if(c == '\n')
-                        *line_status = NEWLINE_DETECTED;
-                else if(c == '\r')
-                        *line_status = CARRIAGERETURN_DETECTED;
-                else if(c == ';')
-                        *line_status = COMMNTDELIM_DETECTED;
+/* Gives the next of the comma-separated items of a data directive. Commas inside
+   parentheses or strings do not separate items. */
+data_status_t extract_dataitem(const tokenrange_t *dir_arg, uint32_t *position,
+                               tokenrange_t *item) {
+        const token_t *tokens = dir_arg->tokens;
+        uint32_t index, depth;
+
+        if(*position > dir_arg->n_tokens)
+                return INVALID;
+
+        depth = 0;
+        for(index = *position; index < dir_arg->n_tokens; ++index) {
+                if(tokens[index].type != TOKEN_PUNCTUATION)
+                        continue;
+                if(tokens[index].text[0] == '(')
+                        ++depth;
+                else if(tokens[index].text[0] == ')' && depth > 0)
+                        --depth;
+                else if(tokens[index].text[0] == ',' && depth == 0)
+                        break;
+        }
+
+        item->tokens = &tokens[*position];
+        item->n_tokens = index - *position;
+        *position = index + 1;
+
+        return (item->n_tokens > 0) ? VALID : INVALID;
+}
+
+/* Gives the part of a binary file that INCBIN copies: the file named by the first item,
+   from the offset given by the second item, for the length given by the third or up to
+   the end of the file. Only the size of the file is looked at. */
+data_status_t measure_binaryfile(const tokenrange_t *dir_arg, uint16_t location_counter,
+                                 symboltable_t *symboltable_list, const token_t **name,
+                                 uint32_t *offset, uint32_t *length) {
+        tokenrange_t item;
+        uint32_t position, size;
+        uint16_t value;
+
+        position = 0;
+        if(extract_dataitem(dir_arg, &position, &item) != VALID ||
+           item.n_tokens != 1 || item.tokens[0].type != TOKEN_STRING ||
+           get_binaryfilesize(&item.tokens[0], &size) == ERROR)
+                return INVALID;
+        *name = &item.tokens[0];
+
+        *offset = 0;
+        if(position <= dir_arg->n_tokens) {
+                if(extract_dataitem(dir_arg, &position, &item) != VALID ||
+                   evaluate_dirarg(&item, location_counter, symboltable_list,
+                                   &value) != VALID || value > size)
+                        return INVALID;
+                *offset = value;
+        }
+
+        *length = size - *offset;
+        if(position <= dir_arg->n_tokens) {
+                if(extract_dataitem(dir_arg, &position, &item) != VALID ||
+                   evaluate_dirarg(&item, location_counter, symboltable_list,
+                                   &value) != VALID || value > *length)
+                        return INVALID;
+                *length = value;
+        }
+
+        /* A file cannot take more than the whole address space. */
+        if(position <= dir_arg->n_tokens || *length > 0x10000)
+                return INVALID;
+
+        return VALID;
+}
+
+/* Gives the number of bytes a data directive takes. DB takes a byte per value and the
+   characters of its strings, DW two bytes per value. The size of DS must be known in
+   the first pass, since it moves every address that follows, and so must the boundary
+   of ALIGN and the offset and the length of INCBIN. ALIGN takes the bytes up to the next
+   multiple of its boundary. */
+data_status_t measure_data(atom_t directive, const tokenrange_t *dir_arg,
+                           uint16_t location_counter, symboltable_t *symboltable_list,
+                           uint32_t *size) {
+        tokenrange_t item;
+        const token_t *name;
+        uint32_t position, offset, length;
+        uint16_t value;
+
+        *size = 0;
+        position = 0;
+
+        if(directive == ATOM_INCBIN)
+                return measure_binaryfile(dir_arg, location_counter, symboltable_list,
+                                          &name, &offset, size);
+
+        if(directive == ATOM_DS || directive == ATOM_DEFS || directive == ATOM_ALIGN) {
+                if(extract_dataitem(dir_arg, &position, &item) != VALID ||
+                   evaluate_dirarg(&item, location_counter, symboltable_list,
+                                   &value) != VALID)
+                        return INVALID;
+                if(directive != ATOM_ALIGN)
+                        *size = value;
+                else if(value == 0)
+                        return INVALID;
                 else
-                        *line_status = NONE_DETECTED;
+                        *size = (value - location_counter % value) % value;
+                if(position <= dir_arg->n_tokens &&
+                   extract_dataitem(dir_arg, &position, &item) != VALID)
+                        return INVALID;
+                return (position > dir_arg->n_tokens) ? VALID : INVALID;
         }
 
-        if(status == NO_ERROR) {
-                if(extract_ndirargs == 2) {
-                        do {
-                                c = fgetc(file_handle);
-                        } while(c != EOF && (c == ' ' || c == '\t'));
+        while(position <= dir_arg->n_tokens) {
+                if(extract_dataitem(dir_arg, &position, &item) != VALID)
+                        return INVALID;
 
-                        if(c == EOF || c == '\n' || c == '\r' || c == ';') {
-                                status = ERROR;
-                        }
-                        else {
-                                index = 0;
-                                do {
-                                        buffer[index++] = c;
-                                        c = fgetc(file_handle);
-                                } while(c != EOF && c != ' ' && c != '\t' && c != '\n' &&
-                                        c != '\r' && c != ';');
-                                buffer[index] = '\0';
-
-                                status = NO_ERROR;
-                                strcpy(dir_arg2, buffer);
-
-                                if(c == EOF)
-                                        *line_status = ENDOFFILE_DETECTED;
-                                else if(c == '\n')
-                                        *line_status = NEWLINE_DETECTED;
-                                else if(c == '\r')
-                                        *line_status = CARRIAGERETURN_DETECTED;
-                                else if(c == ';')
-                                        *line_status = COMMNTDELIM_DETECTED;
-                                else
-                                        *line_status = NONE_DETECTED;
-                        }
-                }
-                else {
-                        status = NO_ERROR;
+                if(directive == ATOM_DW || directive == ATOM_DEFW)
+                        *size += 2;
+                else if(item.n_tokens == 1 && item.tokens[0].type == TOKEN_STRING) {
+                        if(get_stringtext(&item.tokens[0], NULL, &length) != VALID)
+                                return INVALID;
+                        *size += length;
                 }
+                else
+                        ++*size;
         }
-        return status;
+
+        return VALID;
 }
 
-data_status_t parse_equvalue(char *value, uint8_t *type) {
-        int index;
-        data_status_t value_status;
+/* Gives the value of a directive argument. An argument that is not a single number is
+   compiled as an expression once, in the first pass, and found again in the second. */
+data_status_t evaluate_dirarg(const tokenrange_t *dir_arg, uint16_t location_counter,
+                              symboltable_t *symboltable_list, uint16_t *value) {
+        exprnode_t *node;
         uint8_t byte_length;
 
-        index = strlen(value) - 1;
+        if(dir_arg->n_tokens == 0)
+                return INVALID;
+        if(dir_arg->n_tokens == 1 &&
+           parse_literal(&dir_arg->tokens[0], value, &byte_length) == VALID)
+                return VALID;
+
+        node = find_expression(dir_arg->tokens);
+        if(node == NULL) {
+                node = compile_expression(dir_arg->tokens, dir_arg->n_tokens,
+                                          location_counter, symboltable_list);
+                if(node == NULL || record_expression(dir_arg->tokens, node) == ERROR)
+                        return INVALID;
+        }
 
-        value_status = VALIDITY_UNKNOWN;
+        return evaluate_expression(node, symboltable_list, value);
+}
 
-        if(value[0] == '(' && value[index] == ')') {
-                value_status = testif_memlocvalid(value);
+/* Directive arguments are separated by whitespace; an argument is the run of tokens
+   up to the next token that is preceded by whitespace. A missing argument is given as
+   an empty run. */
+static status_t extract_onedirarg(tokenstream_t *tokenstream, tokenrange_t *dir_arg) {
+        token_t *token;
 
-                if(value_status == VALID) 
-                        *type = MEMORY_16_BIT;
+        dir_arg->tokens = &tokenstream->tokens[tokenstream->position];
+        dir_arg->n_tokens = 0;
+
+        if(get_linestatus(tokenstream) != NONE_DETECTED)
+                return ERROR;
+
+        token = &tokenstream->tokens[tokenstream->position];
+        do {
+                ++token;
+        } while(token->type != TOKEN_NEWLINE && token->type != TOKEN_COMMENT &&
+                token->type != TOKEN_END && !(token->flags & TOKEN_SPACED));
+
+        dir_arg->n_tokens = token - dir_arg->tokens;
+        tokenstream->position = token - tokenstream->tokens;
+
+        return NO_ERROR;
+}
+
+/* An argument that is an expression may contain whitespace and runs to the end of the
+   line. */
+status_t extract_direxpression(tokenstream_t *tokenstream, line_status_t *line_status,
+                               tokenrange_t *dir_arg) {
+        token_t *token;
+        status_t status;
+
+        dir_arg->tokens = &tokenstream->tokens[tokenstream->position];
+        dir_arg->n_tokens = 0;
+        status = ERROR;
+
+        if(get_linestatus(tokenstream) == NONE_DETECTED) {
+                token = &tokenstream->tokens[tokenstream->position];
+                while(token->type != TOKEN_NEWLINE && token->type != TOKEN_COMMENT &&
+                      token->type != TOKEN_END)
+                        ++token;
+
+                dir_arg->n_tokens = token - dir_arg->tokens;
+                tokenstream->position = token - tokenstream->tokens;
+                status = NO_ERROR;
+        }
+        *line_status = get_linestatus(tokenstream);
+
+        return status;
+}
+
+status_t extract_dirarg(tokenstream_t *tokenstream, uint8_t extract_ndirargs,
+                        line_status_t *line_status, tokenrange_t *dir_arg1,
+                        tokenrange_t *dir_arg2) {
+        status_t status;
+
+        status = extract_onedirarg(tokenstream, dir_arg1);
+        if(extract_ndirargs == 2) {
+                if(status == NO_ERROR)
+                        status = extract_onedirarg(tokenstream, dir_arg2);
+                else
+                        dir_arg2->n_tokens = 0;
         }
+        *line_status = get_linestatus(tokenstream);
+
+        return status;
+}
+
+data_status_t parse_equvalue(const tokenrange_t *value, uint8_t *type, uint16_t *number) {
+        data_status_t value_status;
+        uint8_t byte_length;
+
+        value_status = testif_memlocvalid(value, number);
 
-        if(value_status != VALID) {
-                value_status = testif_numvalid(value, &byte_length);
+        if(value_status == VALID) 
+                *type = MEMORY_16_BIT;
+        else if(value->n_tokens == 1) {
+                value_status = parse_literal(&value->tokens[0], number, &byte_length);
 
                 if(value_status == VALID) 
                         if(byte_length == 1)
@@ -484,139 +890,118 @@ data_status_t parse_equvalue(char *value, uint8_t *type) {
         return value_status;
 }
 
-data_status_t track_symbol(char *symbol, char ***symbolstracked_list,
-                           uint8_t *symbolstracked_currentsize,
-                           uint8_t *symbolstracked_actualsize) {
-        int index, size;
-        enum symbol_status_t {NOT_FOUND = 0, FOUND} symbol_status;
-        char **symbolstracked_newlist;
-        data_status_t data_status;
-
-        symbol_status = NOT_FOUND;
-        
-        for(index = 0; index < *symbolstracked_currentsize; ++index) {
-                if(!strcmp((*symbolstracked_list)[index], symbol))
-                        symbol_status = FOUND;
+data_status_t track_symbol(atom_t symbol, atom_t **symbolstracked_list,
+                           uint32_t *symbolstracked_currentsize,
+                           uint32_t *symbolstracked_actualsize) {
+        uint32_t size;
+        atom_t *symbolstracked_newlist;
+        uint8_t *tracked_newflags;
+
+        if(symbol == ATOM_NONE)
+                return INVALID;
+
+        if(symbol >= trackedflags_size) {
+                size = trackedflags_size ? trackedflags_size : 1024;
+                while(size <= symbol)
+                        size *= 2;
+                tracked_newflags = realloc(tracked_flags, size);
+                if(tracked_newflags == NULL)
+                        return INVALID;
+                memset(tracked_newflags + trackedflags_size, 0,
+                       size - trackedflags_size);
+                tracked_flags = tracked_newflags;
+                trackedflags_size = size;
         }
 
-        if(symbol_status == NOT_FOUND) {
+        if(!tracked_flags[symbol]) {
+                /* The list is doubled when full so that the cost of copying it stays
+                   linear in the number of tracked symbols. */
                 if(*symbolstracked_currentsize == *symbolstracked_actualsize) {
                         symbolstracked_newlist = realloc(*symbolstracked_list,
-                                (*symbolstracked_actualsize + 10) *
+                                (*symbolstracked_actualsize * 2 + 10) *
                                                        sizeof(*symbolstracked_newlist));
                         if(symbolstracked_newlist == NULL)
-                                data_status = INVALID;
+                                return INVALID;
                         else {
                                 *symbolstracked_list = symbolstracked_newlist;
-                                *symbolstracked_actualsize += 10;
+                                *symbolstracked_actualsize =
+                                        *symbolstracked_actualsize * 2 + 10;
                         }
                 }
 
-                index = (*symbolstracked_currentsize)++;
-
-                size = strlen(symbol) + 1;
-
-                (*symbolstracked_list)[index] = malloc(size *
-                                               sizeof(*((*symbolstracked_list)[index])));
-
-                if((*symbolstracked_list)[index] == NULL)
-                        data_status = INVALID;
-                else {
-                        strcpy((*symbolstracked_list)[index], symbol);
-                }
+                (*symbolstracked_list)[(*symbolstracked_currentsize)++] = symbol;
+                tracked_flags[symbol] = 1;
         }
-        return data_status;
+        return VALID;
+}
+
+void free_symbolstracked(atom_t **symbolstracked_list) {
+        free(*symbolstracked_list);
+        *symbolstracked_list = NULL;
+        free(tracked_flags);
+        tracked_flags = NULL;
+        trackedflags_size = 0;
 }
 
-status_t validate_symbolstracked(char **symbolstracked_list,
+status_t validate_symbolstracked(atom_t *symbolstracked_list,
                                  symboltable_t *symboltable_list,
-                                 uint8_t symbolstracked_currentsize,
-                                 uint8_t symboltable_currentsize) {
-        int index1, index2;
+                                 uint32_t symbolstracked_currentsize,
+                                 uint32_t symboltable_currentsize) {
+        uint32_t index1, index2;
         status_t status;
-        data_status_t data_status;
 
         status = NO_ERROR;
         
         for(index1 = 0; index1 < symbolstracked_currentsize; ++index1) {
-                data_status = INVALID;
-                for(index2 = 0; index2 < symboltable_currentsize; ++index2) {
-                        if(!strcmp(symboltable_list[index2].name,
-                                   symbolstracked_list[index1]))
-                                data_status = VALID;
-                }
-                if(data_status != VALID)
+                if(lookup_symbol(symbolstracked_list[index1], &index2) == INVALID)
                         status = ERROR;
         }
         return status;
 }
 
-void get_symbolparams(char *symbol, symboltable_t *symboltable_list,
-                      uint8_t symboltable_currentsize,
+void get_symbolparams(atom_t symbol, symboltable_t *symboltable_list,
+                      uint32_t symboltable_currentsize,
                       uint8_t *byte_length, uint8_t value[]) {
-        int index1, index2;
+        uint32_t index1;
+        int index2;
 
-        for(index1 = 0; index1 < symboltable_currentsize; ++index1) {
-                if(!strcmp(symbol, symboltable_list[index1].name)) {
-                        *byte_length = symboltable_list[index1].value_nbytes;
-                        for(index2 = 0; index2 < *byte_length; ++ index2)
-                                value[index2] = symboltable_list[index1].value[index2];
-                }
+        if(lookup_symbol(symbol, &index1) == VALID) {
+                *byte_length = symboltable_list[index1].value_nbytes;
+                for(index2 = 0; index2 < *byte_length; ++ index2)
+                        value[index2] = symboltable_list[index1].value[index2];
         }
 }
 
 
-data_status_t testif_indexregwoffset(char *operand, uint8_t *operand_type) {
-        int index, boundary, index2;
-        char buffer[10];
+/* Tests if the operand is an index register with an offset, as in "(IX+05H)", and
+   gives the offset, which must fit in a byte. */
+data_status_t testif_indexregwoffset(const tokenrange_t *operand, uint8_t *operand_type,
+                                     uint8_t *offset) {
+        const token_t *tokens = operand->tokens;
         enum indexreg_type_t {NO_INDEXREG = 0, IX, IY} indexreg_type;
         data_status_t data_status;
+        uint16_t value;
+        uint8_t byte_length;
 
-        index = 1;
-        boundary = strlen(operand) - 1;
-        index2 = 0;
-
-        while(operand[index] >= 'A' && operand[index] <= 'Z') {
-                buffer[index2] = operand[index];
-                ++index;
-                ++index2;
-        }
-        buffer[index2] = '\0';
+        if(operand->n_tokens != 5 || tokens[0].type != TOKEN_PUNCTUATION ||
+           tokens[0].text[0] != '(' || tokens[4].type != TOKEN_PUNCTUATION ||
+           tokens[4].text[0] != ')')
+                return INVALID;
 
-        if(!strcmp(buffer, "IX"))
+        if(tokens[1].atom == ATOM_IX)
                 indexreg_type = IX;
-        else if(!strcmp(buffer, "IY"))
+        else if(tokens[1].atom == ATOM_IY)
                 indexreg_type = IY;
         else indexreg_type = NO_INDEXREG;
 
         if(indexreg_type != NO_INDEXREG) {
-                while(operand[index] == ' ' || operand[index] == '\t')
-                        ++index;
-                if(operand[index] == '+') {
-                        ++index;
-                        while(operand[index] == ' ' || operand[index] == '\t')
-                                ++index;
-                        index2 = 0;
-
-                        while(operand[index] != ')') {
-                                buffer[index2] = operand[index];
-                                ++index2;
-                                ++index;
-                        }
-
-                        data_status = VALID;
-
-                        if(buffer[index2 - 1] == 'H' || buffer[index2 - 1] == 'h')
-                                index2 = index2 - 1;
-                        
-                        for(index = 0; index < index2; ++index) {
-                                if((buffer[index] < '0' || buffer[index] > '9') &&
-                                   (buffer[index] < 'A' || buffer[index] > 'F') &&
-                                   (buffer[index] < 'a' || buffer[index] > 'f'))
-                                        data_status = INVALID;
-                        }
+                if(tokens[2].type == TOKEN_PUNCTUATION && tokens[2].text[0] == '+') {
+                        data_status = parse_literal(&tokens[3], &value, &byte_length);
+                        if(data_status == VALID && byte_length != 1)
+                                data_status = INVALID;
 
                         if(data_status == VALID) {
+                                *offset = (uint8_t) value;
                                 if(indexreg_type == IX)
                                         *operand_type = IX_REGISTER_WOFFSET;
                                 else {
@@ -29,66 +29,98 @@
 
 #include <stdio.h>
 #include "defines.h"
+#include "lexer.h"
 
-void parse_instruction(FILE *file_handle, char *buffer,
+void parse_instruction(tokenstream_t *tokenstream, atom_t instruction,
                        line_status_t *line_status,
                        instruction_parameters_t **instruction_set,
                        uint16_t *location_counter,
                        symboltable_t **symboltable_list,
-                       uint8_t symboltable_currentsize,
-                       char ***symbolstracked_list,
-                       uint8_t *symbolstracked_currentsize,
-                       uint8_t *symbolstracked_actualsize);
+                       uint32_t symboltable_currentsize,
+                       atom_t **symbolstracked_list,
+                       uint32_t *symbolstracked_currentsize,
+                       uint32_t *symbolstracked_actualsize);
 
 
 
-uint8_t parse_operandtype(char *operand, symboltable_t **symboltable_list,
-                          uint8_t symboltable_currentsize,
-                          char ***symbolstracked_list,
-                          uint8_t *symbolstracked_currentzie,
-                          uint8_t *symbolstracked_actualsize); 
+data_status_t split_operandexpression(const tokenrange_t *operand, uint8_t *operand_type,
+                                      tokenrange_t *expression);
 
-data_status_t testif_memlocvalid(char *operand);
+uint8_t parse_operandtype(const tokenrange_t *operand, uint16_t location_counter,
+                          symboltable_t **symboltable_list,
+                          uint32_t symboltable_currentsize,
+                          atom_t **symbolstracked_list,
+                          uint32_t *symbolstracked_currentzie,
+                          uint32_t *symbolstracked_actualsize);
 
+data_status_t testif_memlocvalid(const tokenrange_t *operand, uint16_t *address);
 
 
-data_status_t testif_symbolexistent(char *operand, symboltable_t *symboltable_list,
-                                    uint8_t symboltable_currentsize,
+
+data_status_t testif_symbolexistent(atom_t operand, symboltable_t *symboltable_list,
+                                    uint32_t symboltable_currentsize,
                                     uint8_t *operand_type);
 
-data_status_t checkif_symbolworthy(char *operand);
+data_status_t checkif_symbolworthy(const tokenrange_t *operand);
 
-data_status_t testif_instructionexistent(char *instruction,
+data_status_t testif_instructionexistent(atom_t instruction,
                                          instruction_parameters_t **instruction_set,
                                          uint8_t operand1_type, uint8_t operand2_type,
                                          int *index1, int *index2);
 
-void handle_label(char *label, symboltable_t **symboltable_list,
-                  uint16_t location_counter, uint8_t *symboltable_currentsize,
-                  uint8_t *symboltable_acutalsize);
+data_status_t find_instructionform(atom_t instruction,
+                                   instruction_parameters_t **instruction_set,
+                                   uint8_t *operand1_type, uint8_t *operand2_type,
+                                   int *index1, int *index2);
+
+void handle_label(atom_t label, symboltable_t **symboltable_list,
+                  uint16_t location_counter, uint32_t *symboltable_currentsize,
+                  uint32_t *symboltable_acutalsize);
+
+void handle_directive(tokenstream_t *tokenstream, atom_t directive,
+                      symboltable_t **symboltable_list,
+                      uint16_t *location_counter, uint32_t *symboltable_currentsize,
+                      uint32_t *symboltable_actualsize, line_status_t *line_status);
+
+status_t extract_dirarg(tokenstream_t *tokenstream, uint8_t extract_ndirargs,
+                        line_status_t *line_status, tokenrange_t *dir_arg1,
+                        tokenrange_t *dir_arg2);
+
+status_t extract_direxpression(tokenstream_t *tokenstream, line_status_t *line_status,
+                               tokenrange_t *dir_arg);
+
+data_status_t evaluate_dirarg(const tokenrange_t *dir_arg, uint16_t location_counter,
+                              symboltable_t *symboltable_list, uint16_t *value);
+
+data_status_t extract_dataitem(const tokenrange_t *dir_arg, uint32_t *position,
+                               tokenrange_t *item);
+
+data_status_t measure_binaryfile(const tokenrange_t *dir_arg, uint16_t location_counter,
+                                 symboltable_t *symboltable_list, const token_t **name,
+                                 uint32_t *offset, uint32_t *length);
 
-void handle_directive(FILE *file_handle, char *directive, symboltable_t **symboltable_list,
-                      uint16_t *location_counter, uint8_t *symboltable_currentsize,
-                      uint8_t *symboltable_actualsize, line_status_t *line_status);
+data_status_t measure_data(atom_t directive, const tokenrange_t *dir_arg,
+                           uint16_t location_counter, symboltable_t *symboltable_list,
+                           uint32_t *size);
 
-status_t extract_dirarg(FILE *file_handle, uint8_t extract_ndirargs,
-                        line_status_t *line_status, char *dir_arg1, char *dir_arg2);
+data_status_t parse_equvalue(const tokenrange_t *value, uint8_t *type, uint16_t *number);
 
-data_status_t parse_equvalue(char *value, uint8_t *type);
+data_status_t track_symbol(atom_t symbol, atom_t **symbolstracked_list,
+                           uint32_t *symbolstracked_currentsize,
+                           uint32_t *symbolstracked_actualsize);
 
-data_status_t track_symbol(char *symbol, char ***symbolstracked_list,
-                           uint8_t *symbolstracked_currentsize,
-                           uint8_t *symbolstracked_actualsize);
+void free_symbolstracked(atom_t **symbolstracked_list);
 
-status_t validate_symbolstracked(char **symbolstracked_list,
+status_t validate_symbolstracked(atom_t *symbolstracked_list,
                                  symboltable_t *symboltable_list,
-                                 uint8_t symbolstracked_currentsize,
-                                 uint8_t symboltable_currentsize);
+                                 uint32_t symbolstracked_currentsize,
+                                 uint32_t symboltable_currentsize);
 
-void get_symbolparams(char *symbol, symboltable_t *symboltable_list,
-                      uint8_t symboltable_currentsize,
+void get_symbolparams(atom_t symbol, symboltable_t *symboltable_list,
+                      uint32_t symboltable_currentsize,
                       uint8_t *byte_length, uint8_t value[]);
 
-data_status_t testif_indexregwoffset(char *operand, uint8_t *operand_type);
+data_status_t testif_indexregwoffset(const tokenrange_t *operand, uint8_t *operand_type,
+                                     uint8_t *offset);
 
 #endif
@@ -0,0 +1,337 @@
+// File: repeat.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains REPT. REPT and ENDR must each be the first word of their line, and
+ * the count of REPT must be known when it is met:
+ *
+ *      REPT 256
+ *      LDI
+ *      ENDR
+ *
+ * A block whose copies are all the same is assembled once: both passes walk its lines
+ * once, and at ENDR the first pass moves the location counter over the copies and the
+ * second pass copies the bytes of the block in the output image. A block that defines
+ * labels, uses $, ORG, sections or banks, or a macro that does, makes copies that
+ * differ, and is expanded with the macros into one copy for every count instead, each
+ * with labels of its own.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "defines.h"
+#include "intern.h"
+#include "lexer.h"
+#include "parse.h"
+#include "image.h"
+#include "object.h"
+#include "stats.h"
+#include "macro.h"
+#include "repeat.h"
+
+/* The macros used between REPT and ENDR are looked through down to this depth; one
+   nested deeper uses itself, which its expansion finds. */
+#define REPEAT_MAXDEPTH 64
+
+typedef struct repeatblock_t {
+        uint32_t line;
+        uint16_t start;
+        uint32_t count;
+        /* The weight of the instruction mix outside of the block. */
+        uint32_t weight;
+} repeatblock_t;
+
+/* The count of every REPT met in the first pass, in order, and the end of its ENDR
+   line, where a count of zero goes straight to. */
+typedef struct repeatrecord_t {
+        uint32_t count;
+        uint32_t end;
+} repeatrecord_t;
+
+static repeatblock_t *repeatblocks;
+static uint32_t repeatblocks_currentsize, repeatblocks_actualsize;
+
+static repeatrecord_t *repeatrecords;
+static uint32_t repeatrecords_currentsize, repeatrecords_actualsize;
+static uint32_t next_repeatrecord;
+
+static uint32_t mix_weight = 1;
+
+static uint32_t find_lineend(const tokenstream_t *tokenstream, uint32_t position) {
+        while(tokenstream->tokens[position].type != TOKEN_NEWLINE &&
+              tokenstream->tokens[position].type != TOKEN_COMMENT &&
+              tokenstream->tokens[position].type != TOKEN_END)
+                ++position;
+
+        return position;
+}
+
+static int testif_dollar(const token_t *token) {
+        return token->type == TOKEN_PUNCTUATION && token->length == 1 &&
+               token->text[0] == '$';
+}
+
+static int testif_macrodependent(atom_t name, uint32_t depth);
+
+/* Tells whether the line that starts with the tokens given would make one copy differ
+   from another by its first word: a label, ORG, a section, a bank or a macro that has
+   one of these or uses $. */
+static int testif_linedependent(const token_t *tokens, uint32_t depth) {
+        if(tokens[0].type != TOKEN_IDENTIFIER)
+                return 0;
+
+        if(tokens[1].type == TOKEN_PUNCTUATION && tokens[1].text[0] == ':' &&
+           !(tokens[1].flags & TOKEN_SPACED))
+                return 1;
+        if(tokens[0].atom == ATOM_ORG || tokens[0].atom == ATOM_SECTION ||
+           tokens[0].atom == ATOM_ENDS || tokens[0].atom == ATOM_BANK)
+                return 1;
+
+        return testif_macrodependent(tokens[0].atom, depth);
+}
+
+static int testif_macrodependent(atom_t name, uint32_t depth) {
+        const token_t *body;
+        uint32_t n_tokens, position;
+        int line_start;
+
+        body = find_macrobody(name, &n_tokens);
+        if(body == NULL || depth == REPEAT_MAXDEPTH)
+                return 0;
+
+        line_start = 1;
+        for(position = 0; position < n_tokens; ++position) {
+                if(testif_dollar(&body[position]) ||
+                   (line_start && testif_linedependent(&body[position], depth + 1)))
+                        return 1;
+                line_start = body[position].type == TOKEN_NEWLINE;
+        }
+
+        return 0;
+}
+
+/* Looks through the lines of the block for anything that would make one copy differ
+   from another, gives the position of the newline in front of its ENDR and of the end
+   of its ENDR line. */
+static uint32_t check_repeatblock(const tokenstream_t *tokenstream, uint32_t position,
+                                  uint32_t line, uint32_t *body_end, int *dependent) {
+        const token_t *tokens = tokenstream->tokens;
+        uint32_t depth;
+
+        depth = 0;
+        *dependent = 0;
+        for(; tokens[position].type != TOKEN_END; ++position) {
+                if(testif_dollar(&tokens[position]))
+                        *dependent = 1;
+
+                if(tokens[position].type != TOKEN_NEWLINE ||
+                   tokens[position + 1].type != TOKEN_IDENTIFIER)
+                        continue;
+
+                if(tokens[position + 1].atom == ATOM_ENDR && depth == 0) {
+                        *body_end = position;
+                        return find_lineend(tokenstream, position + 2);
+                }
+                if(!*dependent && testif_linedependent(&tokens[position + 1], 0))
+                        *dependent = 1;
+
+                /* An IRP in the block is expanded when the pass meets it, and it ends
+                   at an ENDR too. */
+                if(tokens[position + 1].atom == ATOM_REPT ||
+                   tokens[position + 1].atom == ATOM_IRP)
+                        ++depth;
+                else if(tokens[position + 1].atom == ATOM_ENDR)
+                        --depth;
+        }
+
+        STDERR("line %u: REPT without ENDR\n", line);
+        EFAILURE;
+}
+
+static void record_repeat(uint32_t count, uint32_t end) {
+        repeatrecord_t *repeatrecords_newlist;
+
+        if(repeatrecords_currentsize == repeatrecords_actualsize) {
+                repeatrecords_newlist = realloc(repeatrecords,
+                                                (repeatrecords_actualsize + 64) *
+                                                sizeof(*repeatrecords_newlist));
+                if(repeatrecords_newlist == NULL) {
+                        STDERR("the repeated blocks could not be recorded\n");
+                        EFAILURE;
+                }
+                repeatrecords = repeatrecords_newlist;
+                repeatrecords_actualsize += 64;
+        }
+
+        repeatrecords[repeatrecords_currentsize].count = count;
+        repeatrecords[repeatrecords_currentsize++].end = end;
+}
+
+static void push_repeatblock(uint32_t line, uint16_t start, uint32_t count) {
+        repeatblock_t *repeatblocks_newlist;
+
+        if(repeatblocks_currentsize == repeatblocks_actualsize) {
+                repeatblocks_newlist = realloc(repeatblocks,
+                                               (repeatblocks_actualsize + 16) *
+                                               sizeof(*repeatblocks_newlist));
+                if(repeatblocks_newlist == NULL) {
+                        STDERR("the repeated blocks could not be recorded\n");
+                        EFAILURE;
+                }
+                repeatblocks = repeatblocks_newlist;
+                repeatblocks_actualsize += 16;
+        }
+
+        repeatblocks[repeatblocks_currentsize].line = line;
+        repeatblocks[repeatblocks_currentsize].start = start;
+        repeatblocks[repeatblocks_currentsize].count = count;
+        repeatblocks[repeatblocks_currentsize++].weight = mix_weight;
+}
+
+/* Takes the innermost block off at its ENDR, and gives the number of bytes one copy of
+   it takes. */
+static uint32_t pop_repeatblock(uint32_t line, uint16_t address, repeatblock_t *block) {
+        uint32_t size;
+
+        if(repeatblocks_currentsize == 0) {
+                STDERR("line %u: ENDR without REPT\n", line);
+                EFAILURE;
+        }
+        *block = repeatblocks[--repeatblocks_currentsize];
+
+        size = (uint16_t) (address - block->start);
+        if((uint64_t) size * block->count > 0x10000) {
+                STDERR("line %u: the copies of REPT take more than the whole address "
+                       "space\n", block->line);
+                EFAILURE;
+        }
+
+        return size;
+}
+
+void handle_repeat(tokenstream_t *tokenstream, atom_t directive,
+                   symboltable_t *symboltable_list, uint16_t *location_counter,
+                   line_status_t *line_status) {
+        repeatblock_t block;
+        tokenrange_t dir_arg;
+        uint32_t word, line, end, body_end, size;
+        uint16_t count;
+        int dependent;
+
+        word = tokenstream->position - 1;
+        line = tokenstream->tokens[word].line;
+        if(word > 0 && tokenstream->tokens[word - 1].type != TOKEN_NEWLINE) {
+                STDERR("line %u: %s must be the first word of its line\n", line,
+                       get_atomname(directive));
+                EFAILURE;
+        }
+
+        extract_direxpression(tokenstream, line_status, &dir_arg);
+
+        if(directive == ATOM_ENDR) {
+                size = pop_repeatblock(line, *location_counter, &block);
+                *location_counter += size * (block.count - 1);
+                return;
+        }
+
+        if(evaluate_dirarg(&dir_arg, *location_counter, symboltable_list,
+                           &count) != VALID) {
+                STDERR("line %u: the count of REPT must be known when it is met\n", line);
+                EFAILURE;
+        }
+
+        end = check_repeatblock(tokenstream, tokenstream->position, line, &body_end,
+                                &dependent);
+
+        /* Copies that differ are each assembled on their own, as an expansion that
+           both passes walk; the second pass steps into it at this REPT line. */
+        if(dependent && count > 0) {
+                expand_repeat(tokenstream, word, body_end, end, count, line_status);
+                return;
+        }
+
+        record_repeat(count, end);
+        if(count == 0) {
+                tokenstream->position = end;
+                *line_status = get_linestatus(tokenstream);
+        }
+        else
+                push_repeatblock(line, *location_counter, count);
+}
+
+/* Checks at the end of the first pass that every block was closed. */
+void end_repeats(void) {
+        if(repeatblocks_currentsize > 0) {
+                STDERR("line %u: REPT without ENDR\n",
+                       repeatblocks[repeatblocks_currentsize - 1].line);
+                EFAILURE;
+        }
+}
+
+void replay_repeat(tokenstream_t *tokenstream, atom_t directive,
+                   outputimage_t *outputimage, uint16_t *current_address,
+                   line_status_t *line_status) {
+        repeatblock_t block;
+        repeatrecord_t *record;
+        uint32_t line, size;
+
+        line = tokenstream->tokens[tokenstream->position - 1].line;
+        tokenstream->position = find_lineend(tokenstream, tokenstream->position);
+        *line_status = get_linestatus(tokenstream);
+
+        if(directive == ATOM_ENDR) {
+                size = pop_repeatblock(line, *current_address, &block);
+                if(repeat_inimage(outputimage, *current_address, size,
+                                  block.count - 1) == ERROR) {
+                        STDERR("the output image could not be extended\n");
+                        EFAILURE;
+                }
+                repeat_relocations(outputimage->size - size * block.count, size,
+                                   block.count - 1);
+                *current_address += size * (block.count - 1);
+                mix_weight = block.weight;
+                set_instructionmixweight(mix_weight);
+                return;
+        }
+
+        record = &repeatrecords[next_repeatrecord++];
+        if(record->count == 0) {
+                tokenstream->position = record->end;
+                *line_status = get_linestatus(tokenstream);
+                return;
+        }
+        push_repeatblock(line, *current_address, record->count);
+        mix_weight *= record->count;
+        set_instructionmixweight(mix_weight);
+}
+
+void free_repeats(void) {
+        free(repeatblocks);
+        repeatblocks = NULL;
+        repeatblocks_currentsize = repeatblocks_actualsize = 0;
+
+        free(repeatrecords);
+        repeatrecords = NULL;
+        repeatrecords_currentsize = repeatrecords_actualsize = next_repeatrecord = 0;
+
+        mix_weight = 1;
+        set_instructionmixweight(mix_weight);
+}
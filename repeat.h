@@ -0,0 +1,47 @@
+// File: repeat.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains REPT. The lines between REPT and ENDR are parsed and assembled once,
+ * and the bytes they assembled to are copied in the output image as many more times as
+ * they are repeated.
+ */
+
+#ifndef REPEAT_H
+#define REPEAT_H
+
+#include "defines.h"
+#include "lexer.h"
+#include "image.h"
+
+void handle_repeat(tokenstream_t *tokenstream, atom_t directive,
+                   symboltable_t *symboltable_list, uint16_t *location_counter,
+                   line_status_t *line_status);
+
+void end_repeats(void);
+
+void replay_repeat(tokenstream_t *tokenstream, atom_t directive,
+                   outputimage_t *outputimage, uint16_t *current_address,
+                   line_status_t *line_status);
+
+void free_repeats(void);
+
+#endif
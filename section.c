@@ -0,0 +1,752 @@
+// File: section.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the sections. SECTION opens a section, with an origin of its own if
+ * one is given and floating otherwise, and ENDS goes back to the code placed by ORG:
+ *
+ *      PLACE 0, 4000H
+ *      SECTION VECTORS, 0
+ *      ...
+ *      SECTION TABLES
+ *      ...
+ *      ENDS
+ *
+ * A section that is opened again is carried on where it was left. The name of a section
+ * is a symbol for its first address.
+ *
+ * In the first pass the location counter of a floating section is the offset into it,
+ * and its labels and $ are compiled as the symbol of the section moved by that offset.
+ * Once the first pass is over, the floating sections are placed from the largest down,
+ * each in the smallest gap left free by the code placed by ORG and by the other sections
+ * that it fits in, between the bounds given by PLACE. A floating section that uses ALIGN
+ * is placed on a multiple of every boundary it aligns to, so that its padding comes out
+ * the same wherever it is placed.
+ *
+ * Sections are placed in the address space of the code outside banks; once a bank has
+ * been selected no section can be opened, and the code of the banks is left out of the
+ * memory map.
+ *
+ * The floating sections of a module are not placed: their names are left to the linker,
+ * which places the floating sections of every module together.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "defines.h"
+#include "intern.h"
+#include "lexer.h"
+#include "task.h"
+#include "parse.h"
+#include "expr.h"
+#include "image.h"
+#include "bank.h"
+#include "object.h"
+#include "section.h"
+
+typedef struct section_t {
+        atom_t name;
+        uint32_t line;
+        uint8_t floating;
+        /* The origin given in the source, or the address the section was placed at. */
+        uint16_t origin;
+        /* The location counter of the section when it was last left. */
+        uint16_t counter;
+        uint32_t size;
+        uint32_t alignment;
+} section_t;
+
+/* A run of bytes in the address space: a section, or code placed by ORG if section is
+   NO_SECTION. */
+typedef struct memoryblock_t {
+        uint32_t first;
+        uint32_t size;
+        uint32_t section;
+} memoryblock_t;
+
+static section_t *sections;
+static uint32_t sections_currentsize, sections_actualsize;
+static uint32_t current_section = NO_SECTION;
+
+/* The section opened by every SECTION met in the first pass, in order, or NO_SECTION
+   for an ENDS. */
+static uint32_t *sectionrecords;
+static uint32_t sectionrecords_currentsize, sectionrecords_actualsize;
+static uint32_t next_sectionrecord;
+
+static memoryblock_t *memoryblocks;
+static uint32_t memoryblocks_currentsize, memoryblocks_actualsize;
+
+/* The location counter of the code placed by ORG while a section is open, and the
+   address the current run of that code started at. */
+static uint16_t origin_counter, run_start;
+
+static uint32_t place_first, place_end = 0x10000, place_line;
+
+static void record_memoryblock(uint32_t first, uint32_t size, uint32_t section) {
+        memoryblock_t *memoryblocks_newlist, *block;
+
+        if(size == 0)
+                return;
+
+        /* A run that goes past FFFFH carries on from 0000H. */
+        if(first + size > 0x10000) {
+                record_memoryblock(0, first + size - 0x10000, section);
+                size = 0x10000 - first;
+        }
+
+        /* Code placed by ORG that carries on after a section is the same run. */
+        if(memoryblocks_currentsize > 0 && section == NO_SECTION) {
+                block = &memoryblocks[memoryblocks_currentsize - 1];
+                if(block->section == NO_SECTION && block->first + block->size == first) {
+                        block->size += size;
+                        return;
+                }
+        }
+
+        if(memoryblocks_currentsize == memoryblocks_actualsize) {
+                memoryblocks_newlist = realloc(memoryblocks,
+                                               (memoryblocks_actualsize * 2 + 16) *
+                                               sizeof(*memoryblocks_newlist));
+                if(memoryblocks_newlist == NULL) {
+                        STDERR("the memory map could not be recorded\n");
+                        EFAILURE;
+                }
+                memoryblocks = memoryblocks_newlist;
+                memoryblocks_actualsize = memoryblocks_actualsize * 2 + 16;
+        }
+
+        memoryblocks[memoryblocks_currentsize].first = first;
+        memoryblocks[memoryblocks_currentsize].size = size;
+        memoryblocks[memoryblocks_currentsize++].section = section;
+}
+
+static void record_section(uint32_t section) {
+        uint32_t *sectionrecords_newlist;
+
+        if(sectionrecords_currentsize == sectionrecords_actualsize) {
+                sectionrecords_newlist = realloc(sectionrecords,
+                                                 (sectionrecords_actualsize + 16) *
+                                                 sizeof(*sectionrecords_newlist));
+                if(sectionrecords_newlist == NULL) {
+                        STDERR("the sections could not be recorded\n");
+                        EFAILURE;
+                }
+                sectionrecords = sectionrecords_newlist;
+                sectionrecords_actualsize += 16;
+        }
+
+        sectionrecords[sectionrecords_currentsize++] = section;
+}
+
+static uint32_t find_section(atom_t name) {
+        uint32_t index;
+
+        for(index = 0; index < sections_currentsize; ++index)
+                if(sections[index].name == name)
+                        return index;
+
+        return NO_SECTION;
+}
+
+static uint32_t new_section(atom_t name, uint32_t line) {
+        section_t *sections_newlist;
+        uint32_t index;
+
+        index = sections_currentsize;
+        if(sections_currentsize == sections_actualsize) {
+                sections_newlist = realloc(sections, (sections_actualsize + 16) *
+                                           sizeof(*sections_newlist));
+                if(sections_newlist == NULL) {
+                        STDERR("the sections could not be recorded\n");
+                        EFAILURE;
+                }
+                sections = sections_newlist;
+                sections_actualsize += 16;
+        }
+
+        sections[index].name = name;
+        sections[index].line = line;
+        sections[index].floating = 1;
+        sections[index].origin = sections[index].counter = 0;
+        sections[index].size = 0;
+        sections[index].alignment = 1;
+        ++sections_currentsize;
+
+        return index;
+}
+
+/* Keeps the location counter of the code that is being left. */
+static void leave_section(uint16_t location_counter) {
+        if(current_section == NO_SECTION && testif_banked())
+                return;
+        if(current_section == NO_SECTION) {
+                record_memoryblock(run_start, (uint16_t) (location_counter - run_start),
+                                   NO_SECTION);
+                origin_counter = location_counter;
+        }
+        else
+                sections[current_section].counter = location_counter;
+}
+
+static void handle_place(const tokenrange_t *dir_arg, uint16_t location_counter,
+                         symboltable_t *symboltable_list, uint32_t line) {
+        tokenrange_t first, end;
+        uint32_t position;
+        uint16_t value1, value2;
+
+        position = 0;
+        if(extract_dataitem(dir_arg, &position, &first) != VALID ||
+           extract_dataitem(dir_arg, &position, &end) != VALID ||
+           position <= dir_arg->n_tokens ||
+           evaluate_dirarg(&first, location_counter, symboltable_list, &value1) != VALID ||
+           evaluate_dirarg(&end, location_counter, symboltable_list, &value2) != VALID) {
+                STDERR("line %u: PLACE needs the first address and the address after the "
+                       "last, known when it is met\n", line);
+                EFAILURE;
+        }
+        if(place_line != 0) {
+                STDERR("line %u: PLACE was already given on line %u\n", line, place_line);
+                EFAILURE;
+        }
+
+        /* An end of 0000H is the top of the address space, where the addresses wrap
+           around. */
+        place_first = value1;
+        place_end = (value2 == 0) ? 0x10000 : value2;
+        place_line = line;
+        if(place_end <= place_first) {
+                STDERR("line %u: PLACE ends before it starts\n", line);
+                EFAILURE;
+        }
+}
+
+void handle_section(tokenstream_t *tokenstream, atom_t directive,
+                    symboltable_t **symboltable_list, uint16_t *location_counter,
+                    uint32_t *symboltable_currentsize, uint32_t *symboltable_actualsize,
+                    line_status_t *line_status) {
+        section_t *section;
+        tokenrange_t dir_arg, name, origin;
+        uint32_t line, position, index;
+        uint16_t value;
+        uint8_t bytes[2];
+
+        line = tokenstream->tokens[tokenstream->position - 1].line;
+        extract_direxpression(tokenstream, line_status, &dir_arg);
+
+        if(directive == ATOM_PLACE) {
+                handle_place(&dir_arg, *location_counter, *symboltable_list, line);
+                return;
+        }
+
+        if(directive == ATOM_ENDS) {
+                if(current_section == NO_SECTION) {
+                        STDERR("line %u: ENDS without SECTION\n", line);
+                        EFAILURE;
+                }
+                if(dir_arg.n_tokens > 0) {
+                        STDERR("line %u: ENDS takes no argument\n", line);
+                        EFAILURE;
+                }
+                leave_section(*location_counter);
+                record_section(NO_SECTION);
+                current_section = NO_SECTION;
+                *location_counter = run_start = origin_counter;
+                set_addressbase(ATOM_NONE);
+                return;
+        }
+
+        if(testif_banked()) {
+                STDERR("line %u: SECTION cannot be used once a bank has been selected\n",
+                       line);
+                EFAILURE;
+        }
+
+        position = 0;
+        if(extract_dataitem(&dir_arg, &position, &name) != VALID ||
+           checkif_symbolworthy(&name) != VALID) {
+                STDERR("line %u: SECTION needs a name\n", line);
+                EFAILURE;
+        }
+        origin.n_tokens = 0;
+        if(position <= dir_arg.n_tokens &&
+           (extract_dataitem(&dir_arg, &position, &origin) != VALID ||
+            position <= dir_arg.n_tokens ||
+            evaluate_dirarg(&origin, *location_counter, *symboltable_list,
+                            &value) != VALID)) {
+                STDERR("line %u: the origin of SECTION must be known when it is met\n",
+                       line);
+                EFAILURE;
+        }
+
+        leave_section(*location_counter);
+
+        index = find_section(name.tokens[0].atom);
+        if(index == NO_SECTION) {
+                index = new_section(name.tokens[0].atom, line);
+                section = &sections[index];
+                if(origin.n_tokens > 0) {
+                        section->floating = 0;
+                        section->origin = section->counter = value;
+                        bytes[0] = (uint8_t) value;
+                        bytes[1] = (uint8_t) (value >> 8);
+                        storein_symboltable(section->name, MEMORY_16_BIT, 2, bytes,
+                                            symboltable_list, symboltable_currentsize,
+                                            symboltable_actualsize);
+                }
+        }
+        else if(origin.n_tokens > 0 && (sections[index].floating ||
+                                        sections[index].origin != value)) {
+                section = &sections[index];
+                STDERR("line %u: the origin of the section \"%s\" is given where it is "
+                       "first opened, on line %u\n", line, get_atomname(section->name),
+                       section->line);
+                EFAILURE;
+        }
+
+        section = &sections[index];
+        record_section(index);
+        current_section = index;
+        *location_counter = section->counter;
+        set_addressbase(section->floating ? section->name : ATOM_NONE);
+}
+
+/* Gives the symbol of the floating section that is open, or ATOM_NONE. */
+atom_t get_sectionbase(void) {
+        if(current_section != NO_SECTION && sections[current_section].floating)
+                return sections[current_section].name;
+
+        return ATOM_NONE;
+}
+
+/* Ends the run of code placed by the last ORG and starts a new one at the origin, for
+   an ORG or for the BANK that leaves the code outside banks. */
+void move_origin(uint32_t line, atom_t directive, uint16_t location_counter,
+                 uint16_t origin) {
+        if(current_section != NO_SECTION) {
+                STDERR("line %u: %s cannot be used in a section\n", line,
+                       get_atomname(directive));
+                EFAILURE;
+        }
+        if(testif_banked())
+                return;
+
+        record_memoryblock(run_start, (uint16_t) (location_counter - run_start),
+                           NO_SECTION);
+        run_start = origin;
+}
+
+static uint32_t get_gcd(uint32_t value1, uint32_t value2) {
+        uint32_t remainder;
+
+        while(value2 != 0) {
+                remainder = value1 % value2;
+                value1 = value2;
+                value2 = remainder;
+        }
+
+        return value1;
+}
+
+/* Makes the floating section that is open start on a multiple of the boundary of an
+   ALIGN in it. */
+void align_section(const tokenrange_t *dir_arg, uint16_t location_counter,
+                   symboltable_t *symboltable_list) {
+        section_t *section;
+        tokenrange_t item;
+        uint32_t position;
+        uint16_t boundary;
+
+        if(get_sectionbase() == ATOM_NONE)
+                return;
+        section = &sections[current_section];
+
+        position = 0;
+        extract_dataitem(dir_arg, &position, &item);
+        evaluate_dirarg(&item, location_counter, symboltable_list, &boundary);
+
+        section->alignment = section->alignment / get_gcd(section->alignment, boundary) *
+                boundary;
+        if(section->alignment > 0x10000) {
+                STDERR("line %u: the section \"%s\" cannot be aligned to every boundary "
+                       "of its ALIGNs\n", dir_arg->tokens[0].line,
+                       get_atomname(section->name));
+                EFAILURE;
+        }
+}
+
+static int compare_memoryblocks(const void *block1, const void *block2) {
+        const memoryblock_t *first1 = block1, *first2 = block2;
+
+        if(first1->first != first2->first)
+                return (first1->first > first2->first) - (first1->first < first2->first);
+
+        return (first1->section > first2->section) - (first1->section < first2->section);
+}
+
+/* Sorts the memory blocks by address and gives the holes between them inside the
+   bounds of PLACE. There is room for one hole more than there are blocks. */
+static uint32_t find_holes(memoryblock_t *holes) {
+        uint32_t index, n_holes, cursor, end;
+
+        if(memoryblocks_currentsize > 1)
+                qsort(memoryblocks, memoryblocks_currentsize, sizeof(*memoryblocks),
+                      compare_memoryblocks);
+
+        n_holes = 0;
+        cursor = place_first;
+        for(index = 0; index <= memoryblocks_currentsize && cursor < place_end; ++index) {
+                if(index < memoryblocks_currentsize)
+                        end = memoryblocks[index].first;
+                else
+                        end = place_end;
+                if(end > place_end)
+                        end = place_end;
+
+                if(end > cursor) {
+                        holes[n_holes].first = cursor;
+                        holes[n_holes].size = end - cursor;
+                        holes[n_holes++].section = NO_SECTION;
+                }
+                if(index < memoryblocks_currentsize &&
+                   memoryblocks[index].first + memoryblocks[index].size > cursor)
+                        cursor = memoryblocks[index].first + memoryblocks[index].size;
+        }
+
+        return n_holes;
+}
+
+static int compare_sectionsizes(const void *index1, const void *index2) {
+        const section_t *section1 = &sections[*(const uint32_t *) index1];
+        const section_t *section2 = &sections[*(const uint32_t *) index2];
+
+        if(section1->size != section2->size)
+                return (section1->size < section2->size) -
+                        (section1->size > section2->size);
+
+        return (section1->line > section2->line) - (section1->line < section2->line);
+}
+
+/* Places the section in the hole it leaves the least room in, and gives its origin. */
+static uint32_t fit_section(const section_t *section, memoryblock_t *holes,
+                            uint32_t *n_holes) {
+        uint32_t index, best, start, best_start, best_room;
+
+        best = NO_SECTION;
+        best_start = best_room = 0;
+        for(index = 0; index < *n_holes; ++index) {
+                start = (holes[index].first + section->alignment - 1) /
+                        section->alignment * section->alignment;
+                if(start + section->size > holes[index].first + holes[index].size)
+                        continue;
+
+                if(best == NO_SECTION || holes[index].size - section->size < best_room ||
+                   (holes[index].size - section->size == best_room && start < best_start)) {
+                        best = index;
+                        best_start = start;
+                        best_room = holes[index].size - section->size;
+                }
+        }
+
+        if(best == NO_SECTION) {
+                STDERR("line %u: the section \"%s\" of %u bytes does not fit in any gap "
+                       "from %04XH to %04XH\n", section->line,
+                       get_atomname(section->name), section->size, place_first,
+                       place_end - 1);
+                EFAILURE;
+        }
+
+        /* The bytes skipped to align the section are left as a hole of their own. */
+        if(best_start > holes[best].first) {
+                holes[*n_holes].first = holes[best].first;
+                holes[(*n_holes)++].size = best_start - holes[best].first;
+        }
+        holes[best].size -= best_start + section->size - holes[best].first;
+        holes[best].first = best_start + section->size;
+
+        return best_start;
+}
+
+/* Places every floating section and defines its symbol; the second pass then starts
+   every section at its origin. */
+void place_sections(uint16_t location_counter, symboltable_t **symboltable_list,
+                    uint32_t *symboltable_currentsize, uint32_t *symboltable_actualsize) {
+        memoryblock_t *holes;
+        uint32_t *order;
+        uint32_t index, n_holes, n_floating;
+        section_t *section;
+        uint8_t bytes[2];
+
+        leave_section(location_counter);
+        current_section = NO_SECTION;
+        set_addressbase(ATOM_NONE);
+
+        n_floating = 0;
+        for(index = 0; index < sections_currentsize; ++index) {
+                section = &sections[index];
+                if(section->floating)
+                        section->size = section->counter;
+                else
+                        section->size = (uint16_t) (section->counter - section->origin);
+                if(section->floating && testif_objectoutput())
+                        declare_relocatable(section->name, symboltable_list,
+                                            symboltable_currentsize,
+                                            symboltable_actualsize);
+                else if(section->floating)
+                        ++n_floating;
+                else
+                        record_memoryblock(section->origin, section->size, index);
+        }
+
+        if(n_floating > 0) {
+                holes = malloc((memoryblocks_currentsize + 1 + n_floating) *
+                               sizeof(*holes));
+                order = malloc(n_floating * sizeof(*order));
+                if(holes == NULL || order == NULL) {
+                        STDERR("the sections could not be placed\n");
+                        EFAILURE;
+                }
+
+                n_floating = 0;
+                for(index = 0; index < sections_currentsize; ++index)
+                        if(sections[index].floating)
+                                order[n_floating++] = index;
+                qsort(order, n_floating, sizeof(*order), compare_sectionsizes);
+
+                n_holes = find_holes(holes);
+                for(index = 0; index < n_floating; ++index) {
+                        section = &sections[order[index]];
+                        if(section->size == 0)
+                                section->origin = place_first;
+                        else
+                                section->origin = fit_section(section, holes, &n_holes);
+                        record_memoryblock(section->origin, section->size, order[index]);
+
+                        bytes[0] = (uint8_t) section->origin;
+                        bytes[1] = (uint8_t) (section->origin >> 8);
+                        storein_symboltable(section->name, MEMORY_16_BIT, 2, bytes,
+                                            symboltable_list, symboltable_currentsize,
+                                            symboltable_actualsize);
+                }
+
+                free(holes);
+                free(order);
+        }
+
+        for(index = 0; index < sections_currentsize; ++index)
+                sections[index].counter = sections[index].origin;
+}
+
+void replay_section(tokenstream_t *tokenstream, atom_t directive,
+                    outputimage_t *outputimage, uint16_t *current_address,
+                    line_status_t *line_status) {
+        tokenrange_t dir_arg;
+        uint32_t section;
+
+        extract_direxpression(tokenstream, line_status, &dir_arg);
+        if(directive == ATOM_PLACE)
+                return;
+
+        if(current_section == NO_SECTION)
+                origin_counter = *current_address;
+        else
+                sections[current_section].counter = *current_address;
+
+        section = sectionrecords[next_sectionrecord++];
+        current_section = section;
+        if(section == NO_SECTION)
+                *current_address = origin_counter;
+        else
+                *current_address = sections[section].counter;
+
+        /* The bytes of a floating section of a module are kept apart for the linker. */
+        outputimage->section = NO_SECTION;
+        if(section != NO_SECTION && sections[section].floating && testif_objectoutput())
+                outputimage->section = section;
+}
+
+/* Gives the floating section at the index, for the object file of a module; ATOM_NONE
+   is given for a section at a fixed address. */
+atom_t describe_section(uint32_t index, uint32_t *size, uint32_t *alignment,
+                        uint32_t *line) {
+        if(index >= sections_currentsize || !sections[index].floating)
+                return ATOM_NONE;
+
+        *size = sections[index].size;
+        *alignment = sections[index].alignment;
+        *line = sections[index].line;
+
+        return sections[index].name;
+}
+
+uint32_t count_sections(void) {
+        return sections_currentsize;
+}
+
+/* Gives the bounds of PLACE, if it was given. */
+int get_placebounds(uint32_t *first, uint32_t *end) {
+        *first = place_first;
+        *end = place_end;
+
+        return place_line != 0;
+}
+
+/* Takes the bytes at a fixed address of a module that is linked. */
+void reserve_memoryblock(uint32_t first, uint32_t size) {
+        record_memoryblock(first, size, NO_SECTION);
+}
+
+/* Takes a floating section of a module that is linked, to be placed with the others. */
+void add_floatingsection(atom_t name, uint32_t line, uint32_t size, uint32_t alignment) {
+        uint32_t index;
+
+        index = new_section(name, line);
+        sections[index].counter = (uint16_t) size;
+        sections[index].alignment = alignment;
+}
+
+/* Bounds the placement of the floating sections of the modules that are linked by the
+   PLACE of a module; every module that gives one must give the same. */
+void bound_placement(uint32_t first, uint32_t end, uint32_t line) {
+        if(place_line != 0 && (place_first != first || place_end != end)) {
+                STDERR("the modules give different bounds to PLACE\n");
+                EFAILURE;
+        }
+
+        place_first = first;
+        place_end = end;
+        place_line = line;
+}
+
+static const char *get_blockkind(const memoryblock_t *block) {
+        if(block->section == NO_SECTION)
+                return "org";
+
+        return sections[block->section].floating ? "floating" : "fixed";
+}
+
+void report_memorymap(FILE *report_handle, report_format_t report_format) {
+        memoryblock_t *holes;
+        uint32_t index, hole, section, n_holes, n_free, largest;
+
+        holes = malloc((memoryblocks_currentsize + 1) * sizeof(*holes));
+        if(holes == NULL) {
+                STDERR("the memory map could not be reported\n");
+                EFAILURE;
+        }
+        n_holes = find_holes(holes);
+
+        n_free = largest = 0;
+        for(hole = 0; hole < n_holes; ++hole) {
+                n_free += holes[hole].size;
+                if(holes[hole].size > largest)
+                        largest = holes[hole].size;
+        }
+
+        if(report_format == REPORT_JSON) {
+                fprintf(report_handle, "{\"bounds\": {\"first\": %u, \"end\": %u},\n "
+                        "\"blocks\": [", place_first, place_end);
+                for(index = 0; index < memoryblocks_currentsize; ++index) {
+                        fprintf(report_handle, "%s\n  {\"first\": %u, \"size\": %u, "
+                                "\"kind\": \"%s\"", (index == 0) ? "" : ",",
+                                memoryblocks[index].first, memoryblocks[index].size,
+                                get_blockkind(&memoryblocks[index]));
+                        section = memoryblocks[index].section;
+                        if(section != NO_SECTION)
+                                fprintf(report_handle, ", \"section\": \"%s\"",
+                                        get_atomname(sections[section].name));
+                        fputc('}', report_handle);
+                }
+                fputs("\n ],\n \"holes\": [", report_handle);
+                for(hole = 0; hole < n_holes; ++hole)
+                        fprintf(report_handle, "%s\n  {\"first\": %u, \"size\": %u}",
+                                (hole == 0) ? "" : ",", holes[hole].first,
+                                holes[hole].size);
+                fprintf(report_handle, "\n ],\n \"used\": %u, \"free\": %u, "
+                        "\"utilization\": %.4f, \"largest_hole\": %u}\n",
+                        place_end - place_first - n_free, n_free,
+                        (double) (place_end - place_first - n_free) /
+                        (place_end - place_first), largest);
+        }
+        else {
+                fprintf(report_handle, "%-6s %-6s %10s  %-9s %s\n", "first", "last",
+                        "size", "kind", "section");
+
+                /* The blocks and the holes are listed together in the order of their
+                   addresses. */
+                index = hole = 0;
+                while(index < memoryblocks_currentsize || hole < n_holes) {
+                        if(hole < n_holes && (index == memoryblocks_currentsize ||
+                                              holes[hole].first <
+                                              memoryblocks[index].first)) {
+                                fprintf(report_handle, "%04XH  %04XH  %10u  %s\n",
+                                        holes[hole].first,
+                                        holes[hole].first + holes[hole].size - 1,
+                                        holes[hole].size, "free");
+                                ++hole;
+                                continue;
+                        }
+
+                        section = memoryblocks[index].section;
+                        fprintf(report_handle, "%04XH  %04XH  %10u  ",
+                                memoryblocks[index].first,
+                                memoryblocks[index].first + memoryblocks[index].size - 1,
+                                memoryblocks[index].size);
+                        if(section == NO_SECTION)
+                                fprintf(report_handle, "%s\n",
+                                        get_blockkind(&memoryblocks[index]));
+                        else
+                                fprintf(report_handle, "%-9s %s\n",
+                                        get_blockkind(&memoryblocks[index]),
+                                        get_atomname(sections[section].name));
+                        ++index;
+                }
+
+                fprintf(report_handle, "\nused %u of the %u bytes from %04XH to %04XH "
+                        "(%.1f%%), %u hole%s, the largest %u bytes\n",
+                        place_end - place_first - n_free, place_end - place_first,
+                        place_first, place_end - 1,
+                        100.0 * (place_end - place_first - n_free) /
+                        (place_end - place_first), n_holes, (n_holes == 1) ? "" : "s",
+                        largest);
+        }
+
+        free(holes);
+}
+
+void free_sections(void) {
+        free(sections);
+        sections = NULL;
+        sections_currentsize = sections_actualsize = 0;
+        current_section = NO_SECTION;
+
+        free(sectionrecords);
+        sectionrecords = NULL;
+        sectionrecords_currentsize = sectionrecords_actualsize = next_sectionrecord = 0;
+
+        free(memoryblocks);
+        memoryblocks = NULL;
+        memoryblocks_currentsize = memoryblocks_actualsize = 0;
+
+        origin_counter = run_start = 0;
+        place_first = place_line = 0;
+        place_end = 0x10000;
+}
@@ -0,0 +1,74 @@
+// File: section.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the sections. A section is a named run of code with an origin of
+ * its own, either fixed in the source or left floating; once the first pass is over the
+ * floating sections are placed in the gaps left free by the rest of the program, and
+ * the resulting memory map can be reported.
+ */
+
+#ifndef SECTION_H
+#define SECTION_H
+
+#include <stdio.h>
+#include "defines.h"
+#include "lexer.h"
+#include "image.h"
+
+void handle_section(tokenstream_t *tokenstream, atom_t directive,
+                    symboltable_t **symboltable_list, uint16_t *location_counter,
+                    uint32_t *symboltable_currentsize, uint32_t *symboltable_actualsize,
+                    line_status_t *line_status);
+
+atom_t get_sectionbase(void);
+
+void move_origin(uint32_t line, atom_t directive, uint16_t location_counter,
+                 uint16_t origin);
+
+void align_section(const tokenrange_t *dir_arg, uint16_t location_counter,
+                   symboltable_t *symboltable_list);
+
+void place_sections(uint16_t location_counter, symboltable_t **symboltable_list,
+                    uint32_t *symboltable_currentsize, uint32_t *symboltable_actualsize);
+
+void replay_section(tokenstream_t *tokenstream, atom_t directive,
+                    outputimage_t *outputimage, uint16_t *current_address,
+                    line_status_t *line_status);
+
+atom_t describe_section(uint32_t index, uint32_t *size, uint32_t *alignment,
+                        uint32_t *line);
+
+uint32_t count_sections(void);
+
+int get_placebounds(uint32_t *first, uint32_t *end);
+
+void reserve_memoryblock(uint32_t first, uint32_t size);
+
+void add_floatingsection(atom_t name, uint32_t line, uint32_t size, uint32_t alignment);
+
+void bound_placement(uint32_t first, uint32_t end, uint32_t line);
+
+void report_memorymap(FILE *report_handle, report_format_t report_format);
+
+void free_sections(void);
+
+#endif
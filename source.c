@@ -0,0 +1,626 @@
+// File: source.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the source files. An INCLUDE must be the first word of its line
+ * and is followed by the name of the file in quotes:
+ *
+ *      INCLUDE "tables.s"
+ *
+ * The file is looked for next to the file that includes it and then in every include
+ * path, in the order they were given. A file that includes itself, directly or not, is
+ * an error. Including the same file again costs a copy of its tokens and nothing more.
+ *
+ * The tokens of a file point into its mapping and hold atoms, so the cache must be
+ * released after the last token is used and before the intern table is.
+ *
+ * Since the cache holds every source that was read, and the other files read are noted
+ * beside it, the dependency file for make is written from here.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "defines.h"
+#include "arena.h"
+#include "hash.h"
+#include "intern.h"
+#include "lexer.h"
+#include "trace.h"
+#include "source.h"
+
+typedef struct sourcefile_t {
+        char *path;
+        time_t mtime;
+        off_t size;
+        char *text;
+        token_t *tokens;
+        uint32_t n_tokens;
+        uint32_t n_includes;
+        /* Set while the tokens of the file are being expanded, to catch cycles. */
+        int including;
+        /* Set for a file that is only named in messages and was never read. */
+        int named;
+} sourcefile_t;
+
+typedef struct tokenbuffer_t {
+        token_t *tokens;
+        uint32_t n_tokens, capacity;
+} tokenbuffer_t;
+
+/* Every file loaded so far, including those replaced by a newer version of the same
+   file, whose tokens may still be in use. */
+static sourcefile_t **sourcefiles;
+static uint32_t sourcefiles_currentsize, sourcefiles_actualsize;
+static hashtable_t sourcefile_index;
+
+static const char **include_paths;
+static uint32_t n_includepaths;
+
+/* The files read besides the sources, such as binary files, symbol files and object
+   files, each once. */
+static char **inputfiles;
+static uint32_t inputfiles_currentsize, inputfiles_actualsize;
+static hashtable_t inputfile_index;
+
+status_t add_includepath(const char *path) {
+        const char **include_newpaths;
+
+        include_newpaths = realloc(include_paths,
+                                   (n_includepaths + 1) * sizeof(*include_newpaths));
+        if(include_newpaths == NULL)
+                return ERROR;
+
+        include_paths = include_newpaths;
+        include_paths[n_includepaths++] = path;
+
+        return NO_ERROR;
+}
+
+static int testif_includeline(const token_t *tokens, uint32_t index) {
+        return tokens[index].atom == ATOM_INCLUDE &&
+                (index == 0 || tokens[index - 1].type == TOKEN_NEWLINE);
+}
+
+static sourcefile_t *map_sourcefile(const char *path, const struct stat *file_status,
+                                    uint16_t file) {
+        sourcefile_t *sourcefile;
+        tokenstream_t tokenstream;
+        int descriptor;
+        uint32_t index;
+
+        sourcefile = calloc(1, sizeof(*sourcefile));
+        if(sourcefile == NULL)
+                return NULL;
+        sourcefile->path = malloc(strlen(path) + 1);
+        if(sourcefile->path == NULL) {
+                free(sourcefile);
+                return NULL;
+        }
+        strcpy(sourcefile->path, path);
+        sourcefile->mtime = file_status->st_mtime;
+        sourcefile->size = file_status->st_size;
+
+        /* An empty file cannot be mapped, and has no text to map anyway. */
+        sourcefile->text = NULL;
+        if(sourcefile->size > 0) {
+                descriptor = open(path, O_RDONLY);
+                if(descriptor >= 0) {
+                        sourcefile->text = mmap(NULL, sourcefile->size, PROT_READ,
+                                                MAP_PRIVATE, descriptor, 0);
+                        close(descriptor);
+                }
+                if(sourcefile->text == NULL || sourcefile->text == MAP_FAILED) {
+                        free(sourcefile->path);
+                        free(sourcefile);
+                        return NULL;
+                }
+        }
+
+        if(tokenize_buffer(sourcefile->text ? sourcefile->text : "", sourcefile->size,
+                           &tokenstream) == ERROR) {
+                if(sourcefile->text != NULL)
+                        munmap(sourcefile->text, sourcefile->size);
+                free(sourcefile->path);
+                free(sourcefile);
+                return NULL;
+        }
+        sourcefile->tokens = tokenstream.tokens;
+        sourcefile->n_tokens = tokenstream.n_tokens;
+
+        for(index = 0; index < sourcefile->n_tokens; ++index) {
+                sourcefile->tokens[index].file = file;
+                if(testif_includeline(sourcefile->tokens, index))
+                        ++sourcefile->n_includes;
+        }
+
+        return sourcefile;
+}
+
+static void unmap_sourcefile(sourcefile_t *sourcefile) {
+        if(sourcefile->text != NULL)
+                munmap(sourcefile->text, sourcefile->size);
+        free(sourcefile->tokens);
+        free(sourcefile->path);
+        free(sourcefile);
+}
+
+/* Gives the file at the full path from the cache, or NULL if it is not there or has
+   changed since it was tokenized. */
+static sourcefile_t *lookup_sourcefile(const char *path, const struct stat *file_status) {
+        sourcefile_t *sourcefile;
+        uint32_t index;
+
+        if(lookup_hashtable(&sourcefile_index, path, strlen(path), &index) == VALID) {
+                sourcefile = sourcefiles[index];
+                if(sourcefile->mtime == file_status->st_mtime &&
+                   sourcefile->size == file_status->st_size)
+                        return sourcefile;
+        }
+
+        return NULL;
+}
+
+/* Gives the file at the full path, from the cache if it has not changed since it was
+   tokenized. */
+static sourcefile_t *load_sourcefile(const char *path) {
+        struct stat file_status;
+        sourcefile_t *sourcefile, **sourcefiles_newlist;
+
+        if(stat(path, &file_status) != 0)
+                return NULL;
+
+        sourcefile = lookup_sourcefile(path, &file_status);
+        if(sourcefile != NULL)
+                return sourcefile;
+
+        if(sourcefiles_currentsize > UINT16_MAX)
+                return NULL;
+        if(sourcefiles_currentsize == sourcefiles_actualsize) {
+                sourcefiles_newlist = realloc(sourcefiles, (sourcefiles_actualsize * 2 + 8) *
+                                              sizeof(*sourcefiles_newlist));
+                if(sourcefiles_newlist == NULL)
+                        return NULL;
+                sourcefiles = sourcefiles_newlist;
+                sourcefiles_actualsize = sourcefiles_actualsize * 2 + 8;
+        }
+
+        sourcefile = map_sourcefile(path, &file_status, sourcefiles_currentsize);
+        if(sourcefile == NULL)
+                return NULL;
+
+        if(insert_hashtable(&sourcefile_index, sourcefile->path, strlen(sourcefile->path),
+                            sourcefiles_currentsize) == ERROR) {
+                unmap_sourcefile(sourcefile);
+                return NULL;
+        }
+        sourcefiles[sourcefiles_currentsize++] = sourcefile;
+
+        return sourcefile;
+}
+
+/* Gives the full path of the file named by an INCLUDE, or NULL if there is no such
+   file. */
+static char *find_includefile(const char *including_path, const char *name) {
+        char *candidate, *path;
+        const char *directory;
+        size_t directory_length;
+        uint32_t index;
+
+        if(name[0] == '/')
+                return realpath(name, NULL);
+
+        path = NULL;
+        for(index = 0; path == NULL && index <= n_includepaths; ++index) {
+                if(index == 0) {
+                        directory = including_path;
+                        directory_length = strrchr(including_path, '/') - including_path;
+                }
+                else {
+                        directory = include_paths[index - 1];
+                        directory_length = strlen(directory);
+                }
+
+                candidate = malloc(directory_length + strlen(name) + 2);
+                if(candidate == NULL)
+                        return NULL;
+                memcpy(candidate, directory, directory_length);
+                candidate[directory_length] = '/';
+                strcpy(&candidate[directory_length + 1], name);
+
+                path = realpath(candidate, NULL);
+                free(candidate);
+        }
+
+        return path;
+}
+
+/* Gives the full path of the file named by the string token, which is looked for as
+   an included file of the file the token was read from. A name that cannot be found
+   is a fatal error. */
+static char *find_namedfile(const token_t *name_token) {
+        const char *including_path;
+        char *name, *path;
+        uint32_t length;
+
+        including_path = sourcefiles[name_token->file]->path;
+        if(get_stringtext(name_token, NULL, &length) != VALID) {
+                STDERR("%s: line %u: the name of a file must be in quotes\n",
+                       including_path, name_token->line);
+                EFAILURE;
+        }
+
+        name = malloc(length + 1);
+        if(name == NULL) {
+                STDERR("the included files could not be joined\n");
+                EFAILURE;
+        }
+        get_stringtext(name_token, (uint8_t *) name, &length);
+        name[length] = '\0';
+
+        path = find_includefile(including_path, name);
+        if(path == NULL) {
+                STDERR("%s: line %u: the included file (%s) could not be found\n",
+                       including_path, name_token->line, name);
+                EFAILURE;
+        }
+        free(name);
+
+        return path;
+}
+
+/* Gives the size of the binary file named by the string token, without reading it. */
+status_t get_binaryfilesize(const token_t *name_token, uint32_t *size) {
+        struct stat file_status;
+        char *path;
+        int result;
+
+        path = find_namedfile(name_token);
+        result = stat(path, &file_status);
+        if(note_inputfile(path) == ERROR)
+                result = -1;
+        free(path);
+        if(result != 0 || file_status.st_size > UINT32_MAX)
+                return ERROR;
+
+        *size = file_status.st_size;
+
+        return NO_ERROR;
+}
+
+/* Copies length bytes of the binary file named by the string token, from the offset
+   on, straight from its mapping into the output. */
+status_t copy_binaryfile(const token_t *name_token, uint32_t offset, uint32_t length,
+                         uint8_t *output) {
+        struct stat file_status;
+        char *path, *mapping;
+        int descriptor;
+
+        if(length == 0)
+                return NO_ERROR;
+
+        path = find_namedfile(name_token);
+        descriptor = open(path, O_RDONLY);
+        free(path);
+        if(descriptor < 0)
+                return ERROR;
+
+        mapping = MAP_FAILED;
+        if(fstat(descriptor, &file_status) == 0 &&
+           (uint64_t) offset + length <= (uint64_t) file_status.st_size)
+                mapping = mmap(NULL, file_status.st_size, PROT_READ, MAP_PRIVATE,
+                               descriptor, 0);
+        close(descriptor);
+        if(mapping == MAP_FAILED)
+                return ERROR;
+
+        memcpy(output, mapping + offset, length);
+        munmap(mapping, file_status.st_size);
+
+        return NO_ERROR;
+}
+
+static void append_tokens(tokenbuffer_t *tokenbuffer, const token_t *tokens,
+                          uint32_t n_tokens) {
+        token_t *new_tokens;
+        uint32_t capacity;
+
+        if(tokenbuffer->n_tokens + n_tokens > tokenbuffer->capacity) {
+                capacity = tokenbuffer->capacity ? tokenbuffer->capacity : 1024;
+                while(capacity < tokenbuffer->n_tokens + n_tokens)
+                        capacity *= 2;
+                new_tokens = realloc(tokenbuffer->tokens, capacity * sizeof(*new_tokens));
+                if(new_tokens == NULL) {
+                        STDERR("the included files could not be joined\n");
+                        EFAILURE;
+                }
+                tokenbuffer->tokens = new_tokens;
+                tokenbuffer->capacity = capacity;
+        }
+
+        memcpy(&tokenbuffer->tokens[tokenbuffer->n_tokens], tokens,
+               n_tokens * sizeof(*tokens));
+        tokenbuffer->n_tokens += n_tokens;
+}
+
+/* Appends the tokens of the file, without its end token, with every INCLUDE line
+   replaced by the tokens of the file it names. */
+static void expand_sourcefile(sourcefile_t *sourcefile, tokenbuffer_t *tokenbuffer) {
+        const token_t *tokens = sourcefile->tokens;
+        sourcefile_t *included_file;
+        struct stat file_status;
+        uint32_t index, start;
+        const char *category;
+        char *path;
+
+        sourcefile->including = 1;
+
+        start = 0;
+        for(index = 0; index + 1 < sourcefile->n_tokens; ++index) {
+                if(sourcefile->n_includes == 0 || !testif_includeline(tokens, index))
+                        continue;
+
+                if(tokens[index + 1].type != TOKEN_STRING ||
+                   (tokens[index + 2].type != TOKEN_NEWLINE &&
+                    tokens[index + 2].type != TOKEN_COMMENT &&
+                    tokens[index + 2].type != TOKEN_END)) {
+                        STDERR("%s: line %u: INCLUDE needs the name of a file in quotes\n",
+                               sourcefile->path, tokens[index].line);
+                        EFAILURE;
+                }
+
+                path = find_namedfile(&tokens[index + 1]);
+
+                /* Every include is a span of the trace, which tells a file taken from
+                   the cache apart from one that was mapped and tokenized. */
+                category = "include";
+                if(stat(path, &file_status) == 0 &&
+                   lookup_sourcefile(path, &file_status) != NULL)
+                        category = "include (cached)";
+                begin_tracespan(path, category);
+
+                included_file = load_sourcefile(path);
+                if(included_file == NULL) {
+                        STDERR("the included file (%s) could not be read\n", path);
+                        EFAILURE;
+                }
+                if(included_file->including) {
+                        STDERR("%s: line %u: the file (%s) includes itself\n",
+                               sourcefile->path, tokens[index].line, path);
+                        EFAILURE;
+                }
+
+                append_tokens(tokenbuffer, &tokens[start], index - start);
+                expand_sourcefile(included_file, tokenbuffer);
+                end_tracespan(path, category);
+                free(path);
+                start = index + 2;
+        }
+
+        append_tokens(tokenbuffer, &tokens[start], sourcefile->n_tokens - 1 - start);
+
+        sourcefile->including = 0;
+}
+
+status_t tokenize_sourcefile(const char *sourcefile_name, arena_t *arena,
+                             tokenstream_t *tokenstream) {
+        sourcefile_t *sourcefile;
+        tokenbuffer_t tokenbuffer;
+        char *path;
+
+        path = realpath(sourcefile_name, NULL);
+        if(path == NULL)
+                return ERROR;
+        sourcefile = load_sourcefile(path);
+        free(path);
+        if(sourcefile == NULL)
+                return ERROR;
+
+        /* A file without any INCLUDE is walked in the cache as it is. */
+        if(sourcefile->n_includes == 0) {
+                tokenstream->tokens = sourcefile->tokens;
+                tokenstream->n_tokens = sourcefile->n_tokens;
+                tokenstream->position = 0;
+                return NO_ERROR;
+        }
+
+        tokenbuffer.tokens = NULL;
+        tokenbuffer.n_tokens = tokenbuffer.capacity = 0;
+        expand_sourcefile(sourcefile, &tokenbuffer);
+        append_tokens(&tokenbuffer, &sourcefile->tokens[sourcefile->n_tokens - 1], 1);
+
+        if(adopt_inarena(arena, tokenbuffer.tokens) == ERROR) {
+                free(tokenbuffer.tokens);
+                return ERROR;
+        }
+        tokenstream->tokens = tokenbuffer.tokens;
+        tokenstream->n_tokens = tokenbuffer.n_tokens;
+        tokenstream->position = 0;
+
+        return NO_ERROR;
+}
+
+/* Numbers a file that is not read, such as the source of a module being linked, so that
+   messages about its lines can name it. */
+status_t name_sourcefile(const char *path, uint16_t *file) {
+        sourcefile_t *sourcefile, **sourcefiles_newlist;
+        uint32_t index;
+
+        if(lookup_hashtable(&sourcefile_index, path, strlen(path), &index) == VALID) {
+                *file = index;
+                return NO_ERROR;
+        }
+
+        if(sourcefiles_currentsize > UINT16_MAX)
+                return ERROR;
+        if(sourcefiles_currentsize == sourcefiles_actualsize) {
+                sourcefiles_newlist = realloc(sourcefiles, (sourcefiles_actualsize * 2 + 8) *
+                                              sizeof(*sourcefiles_newlist));
+                if(sourcefiles_newlist == NULL)
+                        return ERROR;
+                sourcefiles = sourcefiles_newlist;
+                sourcefiles_actualsize = sourcefiles_actualsize * 2 + 8;
+        }
+
+        sourcefile = calloc(1, sizeof(*sourcefile));
+        if(sourcefile == NULL)
+                return ERROR;
+        sourcefile->path = malloc(strlen(path) + 1);
+        if(sourcefile->path == NULL) {
+                free(sourcefile);
+                return ERROR;
+        }
+        strcpy(sourcefile->path, path);
+        sourcefile->named = 1;
+
+        if(insert_hashtable(&sourcefile_index, sourcefile->path, strlen(sourcefile->path),
+                            sourcefiles_currentsize) == ERROR) {
+                unmap_sourcefile(sourcefile);
+                return ERROR;
+        }
+        *file = sourcefiles_currentsize;
+        sourcefiles[sourcefiles_currentsize++] = sourcefile;
+
+        return NO_ERROR;
+}
+
+/* Notes a file that is read besides the sources, for the dependency file. */
+status_t note_inputfile(const char *path) {
+        char **inputfiles_newlist;
+        uint32_t index;
+
+        if(lookup_hashtable(&inputfile_index, path, strlen(path), &index) == VALID)
+                return NO_ERROR;
+
+        if(inputfiles_currentsize == inputfiles_actualsize) {
+                inputfiles_newlist = realloc(inputfiles, (inputfiles_actualsize * 2 + 8) *
+                                             sizeof(*inputfiles_newlist));
+                if(inputfiles_newlist == NULL)
+                        return ERROR;
+                inputfiles = inputfiles_newlist;
+                inputfiles_actualsize = inputfiles_actualsize * 2 + 8;
+        }
+
+        inputfiles[inputfiles_currentsize] = malloc(strlen(path) + 1);
+        if(inputfiles[inputfiles_currentsize] == NULL)
+                return ERROR;
+        strcpy(inputfiles[inputfiles_currentsize], path);
+        if(insert_hashtable(&inputfile_index, inputfiles[inputfiles_currentsize],
+                            strlen(path), inputfiles_currentsize) == ERROR) {
+                free(inputfiles[inputfiles_currentsize]);
+                return ERROR;
+        }
+        ++inputfiles_currentsize;
+
+        return NO_ERROR;
+}
+
+/* Writes a name for make, with the characters make would take apart escaped. */
+static void put_makename(FILE *dependfile_handle, const char *name) {
+        for(; *name != '\0'; ++name) {
+                if(*name == ' ' || *name == '#')
+                        fputc('\\', dependfile_handle);
+                else if(*name == '$')
+                        fputc('$', dependfile_handle);
+                fputc(*name, dependfile_handle);
+        }
+}
+
+/* Gives the name of the file at the index among the files read, the sources first; a
+   source read again after it changed is given once. */
+static const char *get_dependency(uint32_t index) {
+        sourcefile_t *sourcefile;
+        uint32_t latest;
+
+        if(index >= sourcefiles_currentsize)
+                return inputfiles[index - sourcefiles_currentsize];
+
+        sourcefile = sourcefiles[index];
+        if(sourcefile->named ||
+           (lookup_hashtable(&sourcefile_index, sourcefile->path, strlen(sourcefile->path),
+                             &latest) == VALID && latest != index))
+                return NULL;
+
+        return sourcefile->path;
+}
+
+/* Writes a rule for make that has the target depend on every file read, as gcc -MD
+   does, with an empty rule for each of them so that make does not stop when one of
+   them is removed. */
+status_t write_dependencies(const char *target, FILE *dependfile_handle) {
+        const char *name;
+        uint32_t index, n_files;
+
+        n_files = sourcefiles_currentsize + inputfiles_currentsize;
+
+        put_makename(dependfile_handle, target);
+        fputc(':', dependfile_handle);
+        for(index = 0; index < n_files; ++index) {
+                name = get_dependency(index);
+                if(name == NULL)
+                        continue;
+                fputs(" \\\n  ", dependfile_handle);
+                put_makename(dependfile_handle, name);
+        }
+        fputc('\n', dependfile_handle);
+
+        for(index = 0; index < n_files; ++index) {
+                name = get_dependency(index);
+                if(name == NULL)
+                        continue;
+                fputc('\n', dependfile_handle);
+                put_makename(dependfile_handle, name);
+                fputs(":\n", dependfile_handle);
+        }
+
+        return ferror(dependfile_handle) ? ERROR : NO_ERROR;
+}
+
+/* Gives the path of the file as numbered by the file cache. */
+const char *get_sourcefilename(uint16_t file) {
+        return sourcefiles[file]->path;
+}
+
+void free_sourcefiles(void) {
+        uint32_t index;
+
+        for(index = 0; index < sourcefiles_currentsize; ++index)
+                unmap_sourcefile(sourcefiles[index]);
+        free(sourcefiles);
+        sourcefiles = NULL;
+        sourcefiles_currentsize = sourcefiles_actualsize = 0;
+        free_hashtable(&sourcefile_index);
+
+        free(include_paths);
+        include_paths = NULL;
+        n_includepaths = 0;
+
+        for(index = 0; index < inputfiles_currentsize; ++index)
+                free(inputfiles[index]);
+        free(inputfiles);
+        inputfiles = NULL;
+        inputfiles_currentsize = inputfiles_actualsize = 0;
+        free_hashtable(&inputfile_index);
+}
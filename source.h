@@ -0,0 +1,59 @@
+// File: source.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the source files and the INCLUDE directive. Every file is mapped
+ * into memory and tokenized once; its tokens are kept in a cache keyed by the full path
+ * of the file, and are used again for as long as the size and modification time of the
+ * file stay the same. An INCLUDE line is replaced by the tokens of the file it names,
+ * so the passes see one stream of tokens.
+ */
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "defines.h"
+#include "arena.h"
+#include "lexer.h"
+
+status_t add_includepath(const char *path);
+
+status_t tokenize_sourcefile(const char *sourcefile_name, arena_t *arena,
+                             tokenstream_t *tokenstream);
+
+status_t get_binaryfilesize(const token_t *name_token, uint32_t *size);
+
+status_t copy_binaryfile(const token_t *name_token, uint32_t offset, uint32_t length,
+                         uint8_t *output);
+
+status_t name_sourcefile(const char *path, uint16_t *file);
+
+status_t note_inputfile(const char *path);
+
+status_t write_dependencies(const char *target, FILE *dependfile_handle);
+
+const char *get_sourcefilename(uint16_t file);
+
+void free_sourcefiles(void);
+
+#endif
@@ -0,0 +1,116 @@
+// File: sourcemap.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the source map. It is written in the command file format of the
+ * NoICE debugger, which emulators and other debuggers for the Z80 read as well:
+ *
+ *      FILE /path/to/main.s
+ *      LINE 12 0x8000
+ *      LINE 13 0x8003
+ *      ...
+ *      DEF START 0x8000
+ *
+ * A FILE command is written whenever the lines come from another file. The bytes of a
+ * line run up to the address of the next LINE, so lines whose bytes follow on from
+ * those of the line before are only written once per line, and the bytes that REPT
+ * copies belong to the line before them.
+ *
+ * Every line is written out as soon as its bytes are reserved in the second pass, and
+ * the symbols once the program is assembled, so the map is written in one sweep with
+ * nothing held back but the line it is at.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "defines.h"
+#include "lexer.h"
+#include "source.h"
+#include "symfile.h"
+#include "sourcemap.h"
+
+static FILE *sourcemap_handle;
+
+/* The last line written, and the address its bytes run up to. */
+static uint32_t last_line;
+static uint16_t last_file;
+static uint16_t last_end;
+static int file_written;
+
+status_t open_sourcemap(const char *sourcemap_name) {
+        sourcemap_handle = fopen(sourcemap_name, "w");
+        if(sourcemap_handle == NULL)
+                return ERROR;
+
+        file_written = 0;
+
+        return NO_ERROR;
+}
+
+/* Maps the length bytes at the address to the line of the statement they were
+   assembled from. */
+void map_sourceline(const token_t *statement, uint16_t address, uint32_t length) {
+        if(sourcemap_handle == NULL || length == 0)
+                return;
+
+        if(!file_written || statement->file != last_file) {
+                fprintf(sourcemap_handle, "FILE %s\n",
+                        get_sourcefilename(statement->file));
+                file_written = 1;
+                last_file = statement->file;
+        }
+        else if(statement->line == last_line && address == last_end) {
+                last_end = (uint16_t) (address + length);
+                return;
+        }
+
+        fprintf(sourcemap_handle, "LINE %u 0x%04X\n", statement->line, address);
+        last_line = statement->line;
+        last_end = (uint16_t) (address + length);
+}
+
+/* Writes the symbols the program defines and closes the source map. */
+status_t close_sourcemap(const symboltable_t *symboltable_list,
+                         uint32_t symboltable_currentsize) {
+        const symboltable_t *symbol;
+        uint32_t index;
+        status_t status;
+
+        if(sourcemap_handle == NULL)
+                return NO_ERROR;
+
+        for(index = 0; index < symboltable_currentsize; ++index) {
+                symbol = &symboltable_list[index];
+                if(testif_ownsymbol(symboltable_list, index))
+                        fprintf(sourcemap_handle, "DEF %s 0x%04X\n", symbol->name,
+                                (symbol->value_nbytes == 2) ?
+                                (symbol->value[0] | (symbol->value[1] << 8)) :
+                                symbol->value[0]);
+        }
+
+        status = ferror(sourcemap_handle) ? ERROR : NO_ERROR;
+        if(fclose(sourcemap_handle) != 0)
+                status = ERROR;
+        sourcemap_handle = NULL;
+
+        return status;
+}
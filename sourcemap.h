@@ -0,0 +1,42 @@
+// File: sourcemap.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the source map, which gives a debugger the line of the source every
+ * address was assembled from, and the symbols of the program.
+ */
+
+#ifndef SOURCEMAP_H
+#define SOURCEMAP_H
+
+#include <stdint.h>
+#include "defines.h"
+#include "lexer.h"
+
+status_t open_sourcemap(const char *sourcemap_name);
+
+void map_sourceline(const token_t *statement, uint16_t address, uint32_t length);
+
+status_t close_sourcemap(const symboltable_t *symboltable_list,
+                         uint32_t symboltable_currentsize);
+
+#endif
@@ -0,0 +1,499 @@
+// File: stats.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the statistics of the assembler. The phase timers and counters
+ * show where the assembler spends its time. The instruction mix records every
+ * instruction assembled in the second pass against its entry in the instruction set
+ * together with the number of bytes and T-states it costs, so that the expensive
+ * addressing modes of a program can be found.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "defines.h"
+#include "stats.h"
+
+typedef struct mixentry_t {
+        uint32_t count;
+        uint32_t nbytes;
+        uint32_t tstates;
+} mixentry_t;
+
+typedef struct mixreport_t {
+        instruction_parameters_t *instruction;
+        mixentry_t *entry;
+} mixreport_t;
+
+typedef enum category_t {CATEGORY_LOAD = 0, CATEGORY_ARITHMETIC, CATEGORY_ROTATE,
+                         CATEGORY_BIT, CATEGORY_JUMP, CATEGORY_IO, CATEGORY_CONTROL,
+                         N_CATEGORIES} category_t;
+
+static const char *category_names[N_CATEGORIES] = {"load/exchange", "arithmetic/logic",
+                                                   "rotate/shift", "bit", "jump/call",
+                                                   "input/output", "control"};
+
+static const struct {
+        const char *instruction_name;
+        category_t category;
+} instruction_categories[] = {
+        {"LD", CATEGORY_LOAD}, {"LDI", CATEGORY_LOAD}, {"LDIR", CATEGORY_LOAD},
+        {"LDD", CATEGORY_LOAD}, {"LDDR", CATEGORY_LOAD}, {"PUSH", CATEGORY_LOAD},
+        {"POP", CATEGORY_LOAD}, {"EX", CATEGORY_LOAD}, {"EXX", CATEGORY_LOAD},
+        {"ADD", CATEGORY_ARITHMETIC}, {"ADC", CATEGORY_ARITHMETIC},
+        {"SUB", CATEGORY_ARITHMETIC}, {"SBC", CATEGORY_ARITHMETIC},
+        {"AND", CATEGORY_ARITHMETIC}, {"OR", CATEGORY_ARITHMETIC},
+        {"XOR", CATEGORY_ARITHMETIC}, {"CP", CATEGORY_ARITHMETIC},
+        {"CPI", CATEGORY_ARITHMETIC}, {"CPIR", CATEGORY_ARITHMETIC},
+        {"CPD", CATEGORY_ARITHMETIC}, {"CPDR", CATEGORY_ARITHMETIC},
+        {"INC", CATEGORY_ARITHMETIC}, {"DEC", CATEGORY_ARITHMETIC},
+        {"DAA", CATEGORY_ARITHMETIC}, {"CPL", CATEGORY_ARITHMETIC},
+        {"NEG", CATEGORY_ARITHMETIC}, {"CCF", CATEGORY_ARITHMETIC},
+        {"SCF", CATEGORY_ARITHMETIC},
+        {"RLCA", CATEGORY_ROTATE}, {"RLA", CATEGORY_ROTATE}, {"RRCA", CATEGORY_ROTATE},
+        {"RRA", CATEGORY_ROTATE}, {"RLC", CATEGORY_ROTATE}, {"RL", CATEGORY_ROTATE},
+        {"RRC", CATEGORY_ROTATE}, {"RR", CATEGORY_ROTATE}, {"SLA", CATEGORY_ROTATE},
+        {"SRA", CATEGORY_ROTATE}, {"SRL", CATEGORY_ROTATE}, {"RLD", CATEGORY_ROTATE},
+        {"RRD", CATEGORY_ROTATE},
+        {"BIT", CATEGORY_BIT}, {"SET", CATEGORY_BIT}, {"RES", CATEGORY_BIT},
+        {"JP", CATEGORY_JUMP}, {"JR", CATEGORY_JUMP}, {"DJNZ", CATEGORY_JUMP},
+        {"CALL", CATEGORY_JUMP}, {"RET", CATEGORY_JUMP}, {"RETI", CATEGORY_JUMP},
+        {"RETN", CATEGORY_JUMP}, {"RST", CATEGORY_JUMP},
+        {"IN", CATEGORY_IO}, {"INI", CATEGORY_IO}, {"INIR", CATEGORY_IO},
+        {"IND", CATEGORY_IO}, {"INDR", CATEGORY_IO}, {"OUT", CATEGORY_IO},
+        {"OUTI", CATEGORY_IO}, {"OTIR", CATEGORY_IO}, {"OUTD", CATEGORY_IO},
+        {"OTDR", CATEGORY_IO},
+        {NULL, CATEGORY_CONTROL}
+};
+
+/* T-states of the unprefixed opcodes. Conditional jumps, calls and returns are listed
+   with their not-taken timing. Prefix bytes are zero and handled separately. */
+static const uint8_t tstates_unprefixed[256] = {
+         4, 10,  7,  6,  4,  4,  7,  4,  4, 11,  7,  6,  4,  4,  7,  4,
+         8, 10,  7,  6,  4,  4,  7,  4, 12, 11,  7,  6,  4,  4,  7,  4,
+         7, 10, 16,  6,  4,  4,  7,  4,  7, 11, 16,  6,  4,  4,  7,  4,
+         7, 10, 13,  6, 11, 11, 10,  4,  7, 11, 13,  6,  4,  4,  7,  4,
+         4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+         4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+         4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+         7,  7,  7,  7,  7,  7,  4,  7,  4,  4,  4,  4,  4,  4,  7,  4,
+         4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+         4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+         4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+         4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+         5, 10, 10, 10, 10, 11,  7, 11,  5, 10, 10,  0, 10, 17,  7, 11,
+         5, 10, 10, 11, 10, 11,  7, 11,  5,  4, 10, 11, 10,  0,  7, 11,
+         5, 10, 10, 19, 10, 11,  7, 11,  5,  4, 10,  4, 10,  0,  7, 11,
+         5, 10, 10,  4, 10, 11,  7, 11,  5,  6, 10,  4, 10,  0,  7, 11
+};
+
+static const char *phase_names[N_PHASES] = {"lexing", "pass one", "symbol validation",
+                                            "pass two", "hex emission"};
+
+counters_t stats_counters;
+
+static enum timer_status_t {TIMERS_DISABLED = 0, TIMERS_ENABLED} timer_status;
+static struct timespec phase_start[N_PHASES], program_start;
+static uint64_t phase_elapsed[N_PHASES];
+
+static mixentry_t *mix_entries[26];
+/* The number of times every instruction assembled now appears in the output. */
+static uint32_t mix_weight = 1;
+
+static uint64_t get_elapsedns(struct timespec *start) {
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        return (uint64_t) (now.tv_sec - start->tv_sec) * 1000000000 +
+                (now.tv_nsec - start->tv_nsec);
+}
+
+void enable_phasetimers(void) {
+        timer_status = TIMERS_ENABLED;
+        clock_gettime(CLOCK_MONOTONIC, &program_start);
+}
+
+/* Phases may nest (hex emission happens inside pass two), so every phase keeps its own
+   start time. */
+void begin_phasetimer(phase_t phase) {
+        if(timer_status == TIMERS_ENABLED)
+                clock_gettime(CLOCK_MONOTONIC, &phase_start[phase]);
+}
+
+void end_phasetimer(phase_t phase) {
+        if(timer_status == TIMERS_ENABLED)
+                phase_elapsed[phase] += get_elapsedns(&phase_start[phase]);
+}
+
+void report_stats(FILE *report_handle, report_format_t report_format) {
+        struct rusage usage;
+        uint64_t total_elapsed;
+        long peak_memory;
+        phase_t phase;
+
+        total_elapsed = get_elapsedns(&program_start);
+
+        /* ru_maxrss is reported in kilobytes. */
+        if(getrusage(RUSAGE_SELF, &usage) == 0)
+                peak_memory = usage.ru_maxrss;
+        else
+                peak_memory = -1;
+
+        if(report_format == REPORT_JSON) {
+                fputs("{\"phases\": {", report_handle);
+                for(phase = 0; phase < N_PHASES; ++phase)
+                        fprintf(report_handle, "%s\"%s\": %.6f", (phase == 0) ? "" : ", ",
+                                phase_names[phase], phase_elapsed[phase] / 1e9);
+                fprintf(report_handle, "},\n \"total\": %.6f,\n", total_elapsed / 1e9);
+                fprintf(report_handle, " \"counters\": {\"symbol_lookups\": %llu, "
+                        "\"strcmp_calls\": %llu, \"instruction_probes\": %llu, "
+                        "\"bytes_emitted\": %llu},\n",
+                        (unsigned long long) stats_counters.symbol_lookups,
+                        (unsigned long long) stats_counters.strcmp_calls,
+                        (unsigned long long) stats_counters.instruction_probes,
+                        (unsigned long long) stats_counters.bytes_emitted);
+                fprintf(report_handle, " \"peak_memory_kb\": %ld}\n", peak_memory);
+        }
+        else {
+                for(phase = 0; phase < N_PHASES; ++phase)
+                        fprintf(report_handle, "%-20s %12.3f ms\n", phase_names[phase],
+                                phase_elapsed[phase] / 1e6);
+                fprintf(report_handle, "%-20s %12.3f ms\n\n", "total",
+                        total_elapsed / 1e6);
+                fprintf(report_handle, "%-20s %12llu\n", "symbol lookups",
+                        (unsigned long long) stats_counters.symbol_lookups);
+                fprintf(report_handle, "%-20s %12llu\n", "strcmp calls",
+                        (unsigned long long) stats_counters.strcmp_calls);
+                fprintf(report_handle, "%-20s %12llu\n", "instruction probes",
+                        (unsigned long long) stats_counters.instruction_probes);
+                fprintf(report_handle, "%-20s %12llu\n", "bytes emitted",
+                        (unsigned long long) stats_counters.bytes_emitted);
+                fprintf(report_handle, "%-20s %12ld kB\n", "peak memory", peak_memory);
+        }
+}
+
+status_t init_instructionmix(instruction_parameters_t **instruction_set) {
+        int index1, size;
+
+        for(index1 = 0; index1 < 26; ++index1) {
+                if(instruction_set[index1] == NULL)
+                        continue;
+
+                size = 0;
+                while(instruction_set[index1][size].instruction_name != NULL)
+                        ++size;
+
+                mix_entries[index1] = calloc(size + 1, sizeof(*mix_entries[index1]));
+                if(mix_entries[index1] == NULL) {
+                        free_instructionmix();
+                        return ERROR;
+                }
+        }
+
+        return NO_ERROR;
+}
+
+void record_instructionmix(int index1, int index2, uint8_t instruction_length,
+                           uint8_t value[]) {
+        mixentry_t *entry;
+
+        if(mix_entries[index1] == NULL)
+                return;
+
+        entry = &mix_entries[index1][index2];
+        entry->count += mix_weight;
+        entry->nbytes += instruction_length * mix_weight;
+        entry->tstates += get_tstates(instruction_length, value) * mix_weight;
+}
+
+/* Instructions that are assembled once and copied, as those of REPT are, are counted
+   once for every copy. */
+void set_instructionmixweight(uint32_t weight) {
+        mix_weight = weight;
+}
+
+void free_instructionmix(void) {
+        int index1;
+
+        for(index1 = 0; index1 < 26; ++index1) {
+                free(mix_entries[index1]);
+                mix_entries[index1] = NULL;
+        }
+}
+
+/* Determine the T-states of an encoded instruction from its opcode bytes. Indexed
+   instructions cost 4 T-states more than their HL counterparts, or 12 more (9 for
+   LD (IX+d),n) when the HL counterpart addresses memory through (HL). Repeating block
+   instructions are counted per iteration. */
+uint8_t get_tstates(uint8_t instruction_length, uint8_t value[]) {
+        uint8_t opcode;
+
+        if(instruction_length == 0)
+                return 0;
+
+        switch(value[0]) {
+        case 0xCB:
+                opcode = value[1];
+                if((opcode & 0x07) != 0x06)
+                        return 8;
+                return ((opcode & 0xC0) == 0x40) ? 12 : 15;
+        case 0xED:
+                opcode = value[1];
+                if(opcode >= 0xA0 && opcode <= 0xBB && (opcode & 0x04) == 0)
+                        return (opcode >= 0xB0) ? 21 : 16;
+                if(opcode < 0x40 || opcode > 0x7F)
+                        return 8;
+                switch(opcode & 0x07) {
+                case 0: case 1:
+                        return 12;
+                case 2:
+                        return 15;
+                case 3:
+                        return 20;
+                case 5:
+                        return 14;
+                case 7:
+                        return (opcode == 0x67 || opcode == 0x6F) ? 18 : 9;
+                default:
+                        return 8;
+                }
+        case 0xDD:
+        case 0xFD:
+                opcode = value[1];
+                if(opcode == 0xCB)
+                        return ((value[3] & 0xC0) == 0x40) ? 20 : 23;
+                if(opcode == 0x34 || opcode == 0x35)
+                        return 23;
+                if(opcode == 0x36)
+                        return 19;
+                if(opcode != 0x76 && (opcode & 0xC0) == 0x40 &&
+                   ((opcode & 0x07) == 0x06 || (opcode & 0xF8) == 0x70))
+                        return 19;
+                if((opcode & 0xC0) == 0x80 && (opcode & 0x07) == 0x06)
+                        return 19;
+                return tstates_unprefixed[opcode] + 4;
+        default:
+                return tstates_unprefixed[value[0]];
+        }
+}
+
+const char *operandtype_tostring(uint8_t operand_type) {
+        switch(operand_type) {
+        case BIT:                 return "b";
+        case C_REGISTER_MEMREF:   return "(C)";
+        case VALUE_8_BIT:         return "n";
+        case REGISTER_8_BIT:      return "r";
+        case ACCUMULATOR:         return "A";
+        case IX_REGISTER:         return "IX";
+        case IY_REGISTER:         return "IY";
+        case IX_REGISTER_WOFFSET: return "(IX+d)";
+        case IY_REGISTER_WOFFSET: return "(IY+d)";
+        case HL_REGISTER:         return "HL";
+        case DE_REGISTER:         return "DE";
+        case BC_REGISTER:         return "BC";
+        case MEMORY_16_BIT:       return "(nn)";
+        case VALUE_16_BIT:        return "nn";
+        case REGISTER_16_BIT:     return "rr";
+        case SP_REGISTER:         return "SP";
+        case INTVECT_REGISTER:    return "I";
+        case MEMREFRSH_REGISTER:  return "R";
+        case CONDITION:           return "cc";
+        case CARRY_SET:           return "C";
+        case CARRY_NOTSET:        return "NC";
+        case ZERO_SET:            return "Z";
+        case ZERO_NOTSET:         return "NZ";
+        case AF_REGISTER:         return "AF";
+        case _AF_REGISTER:        return "AF'";
+        case BC_REGISTER_MEMREF:  return "(BC)";
+        case DE_REGISTER_MEMREF:  return "(DE)";
+        case HL_REGISTER_MEMREF:  return "(HL)";
+        case SP_REGISTER_MEMREF:  return "(SP)";
+        default:                  return "";
+        }
+}
+
+static category_t get_category(const char *instruction_name) {
+        int index;
+
+        for(index = 0; instruction_categories[index].instruction_name != NULL; ++index)
+                if(!strcmp(instruction_categories[index].instruction_name,
+                           instruction_name))
+                        return instruction_categories[index].category;
+
+        return CATEGORY_CONTROL;
+}
+
+static int compare_mixreport(const void *a, const void *b) {
+        const mixreport_t *report1 = a, *report2 = b;
+
+        if(report1->entry->tstates != report2->entry->tstates)
+                return (report1->entry->tstates < report2->entry->tstates) ? 1 : -1;
+        if(report1->entry->count != report2->entry->count)
+                return (report1->entry->count < report2->entry->count) ? 1 : -1;
+        return strcmp(report1->instruction->instruction_name,
+                      report2->instruction->instruction_name);
+}
+
+static void format_operands(char *buffer, size_t buffer_size,
+                            instruction_parameters_t *instruction) {
+        if(instruction->operand_type[0] == NONE)
+                buffer[0] = '\0';
+        else if(instruction->operand_type[1] == NONE)
+                snprintf(buffer, buffer_size, "%s",
+                         operandtype_tostring(instruction->operand_type[0]));
+        else
+                snprintf(buffer, buffer_size, "%s, %s",
+                         operandtype_tostring(instruction->operand_type[0]),
+                         operandtype_tostring(instruction->operand_type[1]));
+}
+
+static double get_percentage(uint32_t part, uint32_t whole) {
+        return (whole == 0) ? 0.0 : (100.0 * part) / whole;
+}
+
+void report_instructionmix(FILE *report_handle,
+                           instruction_parameters_t **instruction_set,
+                           report_format_t report_format) {
+        mixreport_t *reports;
+        mixentry_t *entry, total, indexed, category_totals[N_CATEGORIES];
+        category_t category;
+        int index1, index2, n_reports, index;
+        char operands[20];
+
+        n_reports = 0;
+        for(index1 = 0; index1 < 26; ++index1) {
+                if(mix_entries[index1] == NULL)
+                        continue;
+                for(index2 = 0; instruction_set[index1][index2].instruction_name != NULL;
+                    ++index2)
+                        if(mix_entries[index1][index2].count != 0)
+                                ++n_reports;
+        }
+
+        reports = malloc((n_reports + 1) * sizeof(*reports));
+        if(reports == NULL) {
+                STDERR("the instruction mix report could not be created\n");
+                return;
+        }
+
+        memset(&total, 0, sizeof(total));
+        memset(&indexed, 0, sizeof(indexed));
+        memset(category_totals, 0, sizeof(category_totals));
+
+        index = 0;
+        for(index1 = 0; index1 < 26; ++index1) {
+                if(mix_entries[index1] == NULL)
+                        continue;
+                for(index2 = 0; instruction_set[index1][index2].instruction_name != NULL;
+                    ++index2) {
+                        entry = &mix_entries[index1][index2];
+                        if(entry->count == 0)
+                                continue;
+
+                        reports[index].instruction = &instruction_set[index1][index2];
+                        reports[index].entry = entry;
+                        ++index;
+
+                        category = get_category(
+                                instruction_set[index1][index2].instruction_name);
+                        category_totals[category].count += entry->count;
+                        category_totals[category].nbytes += entry->nbytes;
+                        category_totals[category].tstates += entry->tstates;
+
+                        total.count += entry->count;
+                        total.nbytes += entry->nbytes;
+                        total.tstates += entry->tstates;
+
+                        if(instruction_set[index1][index2].instruction_value[0] == 0xDD ||
+                           instruction_set[index1][index2].instruction_value[0] == 0xFD) {
+                                indexed.count += entry->count;
+                                indexed.nbytes += entry->nbytes;
+                                indexed.tstates += entry->tstates;
+                        }
+                }
+        }
+
+        qsort(reports, n_reports, sizeof(*reports), compare_mixreport);
+
+        if(report_format == REPORT_JSON) {
+                fputs("{\"instructions\": [", report_handle);
+                for(index = 0; index < n_reports; ++index) {
+                        format_operands(operands, sizeof(operands),
+                                        reports[index].instruction);
+                        fprintf(report_handle, "%s\n  {\"mnemonic\": \"%s\", "
+                                "\"operands\": \"%s\", \"count\": %u, \"bytes\": %u, "
+                                "\"tstates\": %u}", (index == 0) ? "" : ",",
+                                reports[index].instruction->instruction_name, operands,
+                                reports[index].entry->count,
+                                reports[index].entry->nbytes,
+                                reports[index].entry->tstates);
+                }
+                fputs("\n ],\n \"categories\": [", report_handle);
+                for(category = 0; category < N_CATEGORIES; ++category)
+                        fprintf(report_handle, "%s\n  {\"category\": \"%s\", "
+                                "\"count\": %u, \"bytes\": %u, \"tstates\": %u}",
+                                (category == 0) ? "" : ",", category_names[category],
+                                category_totals[category].count,
+                                category_totals[category].nbytes,
+                                category_totals[category].tstates);
+                fprintf(report_handle, "\n ],\n \"total\": {\"count\": %u, "
+                        "\"bytes\": %u, \"tstates\": %u},\n", total.count, total.nbytes,
+                        total.tstates);
+                fprintf(report_handle, " \"indexed\": {\"count\": %u, \"bytes\": %u, "
+                        "\"tstates\": %u, \"count_share\": %.2f, "
+                        "\"tstates_share\": %.2f}\n}\n", indexed.count, indexed.nbytes,
+                        indexed.tstates, get_percentage(indexed.count, total.count),
+                        get_percentage(indexed.tstates, total.tstates));
+        }
+        else {
+                fprintf(report_handle, "%-6s %-14s %10s %10s %10s\n", "mnem",
+                        "operands", "count", "bytes", "T-states");
+                for(index = 0; index < n_reports; ++index) {
+                        format_operands(operands, sizeof(operands),
+                                        reports[index].instruction);
+                        fprintf(report_handle, "%-6s %-14s %10u %10u %10u\n",
+                                reports[index].instruction->instruction_name, operands,
+                                reports[index].entry->count,
+                                reports[index].entry->nbytes,
+                                reports[index].entry->tstates);
+                }
+                fprintf(report_handle, "\n%-21s %10s %10s %10s\n", "category", "count",
+                        "bytes", "T-states");
+                for(category = 0; category < N_CATEGORIES; ++category)
+                        fprintf(report_handle, "%-21s %10u %10u %10u\n",
+                                category_names[category],
+                                category_totals[category].count,
+                                category_totals[category].nbytes,
+                                category_totals[category].tstates);
+                fprintf(report_handle, "%-21s %10u %10u %10u\n\n", "total", total.count,
+                        total.nbytes, total.tstates);
+                fprintf(report_handle, "IX/IY prefixed: %u of %u instructions (%.1f%%), "
+                        "%u of %u T-states (%.1f%%)\n", indexed.count, total.count,
+                        get_percentage(indexed.count, total.count), indexed.tstates,
+                        total.tstates, get_percentage(indexed.tstates, total.tstates));
+        }
+
+        free(reports);
+}
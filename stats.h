@@ -0,0 +1,76 @@
+// File: stats.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the functions used to gather and report statistics about the
+ * program being assembled and about the assembler itself.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <string.h>
+#include "defines.h"
+
+typedef enum phase_t {PHASE_LEXING = 0, PHASE_PASSONE, PHASE_VALIDATION,
+                      PHASE_PASSTWO, PHASE_HEXEMISSION, N_PHASES} phase_t;
+
+typedef struct counters_t {
+        uint64_t symbol_lookups;
+        uint64_t strcmp_calls;
+        uint64_t instruction_probes;
+        uint64_t bytes_emitted;
+} counters_t;
+
+extern counters_t stats_counters;
+
+/* The counters are bumped unconditionally; an increment is cheaper than testing
+   whether statistics were requested. */
+#define COUNT(counter) (++stats_counters.counter)
+#define STRCMP(str1, str2) (COUNT(strcmp_calls), strcmp((str1), (str2)))
+
+void enable_phasetimers(void);
+
+void begin_phasetimer(phase_t phase);
+
+void end_phasetimer(phase_t phase);
+
+void report_stats(FILE *report_handle, report_format_t report_format);
+
+status_t init_instructionmix(instruction_parameters_t **instruction_set);
+
+void record_instructionmix(int index1, int index2, uint8_t instruction_length,
+                           uint8_t value[]);
+
+void set_instructionmixweight(uint32_t weight);
+
+void report_instructionmix(FILE *report_handle,
+                           instruction_parameters_t **instruction_set,
+                           report_format_t report_format);
+
+void free_instructionmix(void);
+
+uint8_t get_tstates(uint8_t instruction_length, uint8_t value[]);
+
+const char *operandtype_tostring(uint8_t operand_type);
+
+#endif
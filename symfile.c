@@ -0,0 +1,282 @@
+// File: symfile.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the symbol files. A symbol file holds every symbol the source
+ * defines, with its type and value, in a layout that can be mapped into memory and used
+ * as it is:
+ *
+ *      "Z80SYM", 2 zero bytes      8 bytes
+ *      version, 2 zero bytes       4 bytes
+ *      count                       4 bytes
+ *      symbols                     count entries of 12 bytes: the offset and length of
+ *                                  the name (4 and 2 bytes), the type, the number of
+ *                                  bytes of the value, the value (2 bytes), the bank
+ *                                  and a zero byte
+ *      names                       the names one after the other, without terminators
+ *
+ * Numbers are little-endian, and the symbols are sorted by name so that a symbol can be
+ * found by bisection. The registers and the symbols read from other symbol files are
+ * left out, as are the symbols of a module that the linker gives values to.
+ *
+ * The symbol files given with --import-symbols are read into the symbol table before the
+ * source is, as a layer beneath it: a symbol the source defines hides the one of the
+ * same name from a symbol file, while a symbol given by two symbol files is an error.
+ * A symbol the source defines hides the imported one in the lines before its definition
+ * as well, since the values of imported symbols are not taken as final before the first
+ * pass is over.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "defines.h"
+#include "intern.h"
+#include "task.h"
+#include "source.h"
+#include "symfile.h"
+
+#define SYMBOLFILE_VERSION 1
+#define SYMBOLFILE_HEADER 16
+#define SYMBOLFILE_ENTRY 12
+
+static const char **symbolfiles;
+static uint32_t n_symbolfiles;
+
+/* The symbols before this index are the registers and the other predefined symbols. */
+static uint32_t first_symbol;
+
+/* The symbol table being written, for compare_symbolnames(). */
+static const symboltable_t *sorted_symbols;
+
+status_t add_symbolfile(const char *symbolfile_name) {
+        const char **symbolfiles_newlist;
+
+        symbolfiles_newlist = realloc(symbolfiles,
+                                      (n_symbolfiles + 1) * sizeof(*symbolfiles_newlist));
+        if(symbolfiles_newlist == NULL)
+                return ERROR;
+
+        symbolfiles = symbolfiles_newlist;
+        symbolfiles[n_symbolfiles++] = symbolfile_name;
+
+        return NO_ERROR;
+}
+
+static uint32_t get_symbolbytes(const uint8_t *data, int n_bytes) {
+        uint32_t value;
+        int i;
+
+        value = 0;
+        for(i = 0; i < n_bytes; ++i)
+                value |= (uint32_t) data[i] << (8 * i);
+
+        return value;
+}
+
+static status_t load_symbolfile(const char *symbolfile_name,
+                                symboltable_t **symboltable_list,
+                                uint32_t *symboltable_currentsize,
+                                uint32_t *symboltable_actualsize) {
+        struct stat file_status;
+        const uint8_t *data, *entry;
+        uint32_t count, index, name_offset, names_size, symbol_index;
+        uint16_t name_length;
+        atom_t name;
+        status_t status;
+        int descriptor;
+        size_t size;
+
+        descriptor = open(symbolfile_name, O_RDONLY);
+        if(descriptor < 0 || fstat(descriptor, &file_status) != 0 ||
+           file_status.st_size < SYMBOLFILE_HEADER) {
+                if(descriptor >= 0)
+                        close(descriptor);
+                STDERR("the symbol file (%s) could not be read\n", symbolfile_name);
+                return ERROR;
+        }
+        if(note_inputfile(symbolfile_name) == ERROR) {
+                close(descriptor);
+                STDERR("the symbol file (%s) could not be read\n", symbolfile_name);
+                return ERROR;
+        }
+        size = file_status.st_size;
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        close(descriptor);
+        if(data == MAP_FAILED) {
+                STDERR("the symbol file (%s) could not be read\n", symbolfile_name);
+                return ERROR;
+        }
+
+        if(memcmp(data, "Z80SYM\0\0", 8) != 0 ||
+           get_symbolbytes(&data[8], 2) != SYMBOLFILE_VERSION) {
+                munmap((void *) data, size);
+                STDERR("%s is not a symbol file of this version of z80asm\n",
+                       symbolfile_name);
+                return ERROR;
+        }
+
+        count = get_symbolbytes(&data[12], 4);
+        if(count > (size - SYMBOLFILE_HEADER) / SYMBOLFILE_ENTRY) {
+                munmap((void *) data, size);
+                STDERR("the symbol file (%s) is damaged\n", symbolfile_name);
+                return ERROR;
+        }
+        names_size = size - SYMBOLFILE_HEADER - count * SYMBOLFILE_ENTRY;
+
+        status = NO_ERROR;
+        for(index = 0; index < count; ++index) {
+                entry = &data[SYMBOLFILE_HEADER + index * SYMBOLFILE_ENTRY];
+                name_offset = get_symbolbytes(&entry[0], 4);
+                name_length = get_symbolbytes(&entry[4], 2);
+                if(name_length == 0 || name_offset > names_size ||
+                   name_length > names_size - name_offset || entry[7] > 2) {
+                        STDERR("the symbol file (%s) is damaged\n", symbolfile_name);
+                        status = ERROR;
+                        break;
+                }
+
+                name = intern_string((const char *) &data[SYMBOLFILE_HEADER +
+                                                          count * SYMBOLFILE_ENTRY +
+                                                          name_offset], name_length);
+                if(name == ATOM_NONE) {
+                        STDERR("the symbol file (%s) could not be read\n",
+                               symbolfile_name);
+                        status = ERROR;
+                        break;
+                }
+                if(lookup_symbol(name, &symbol_index) == VALID &&
+                   (*symboltable_list)[symbol_index].value_status != UNDEFINED) {
+                        STDERR("the symbol \"%s\" of %s is defined more than once\n",
+                               get_atomname(name), symbolfile_name);
+                        status = ERROR;
+                        continue;
+                }
+
+                storein_symboltable(name, entry[6], entry[7], (uint8_t *) &entry[8],
+                                    symboltable_list, symboltable_currentsize,
+                                    symboltable_actualsize);
+                lookup_symbol(name, &symbol_index);
+                (*symboltable_list)[symbol_index].bank = entry[10];
+                (*symboltable_list)[symbol_index].imported = 1;
+        }
+
+        munmap((void *) data, size);
+
+        return status;
+}
+
+/* Reads the symbol files given so far into the symbol table, which holds nothing but the
+   predefined symbols yet. */
+status_t load_symbolfiles(symboltable_t **symboltable_list,
+                          uint32_t *symboltable_currentsize,
+                          uint32_t *symboltable_actualsize) {
+        uint32_t index;
+        status_t status;
+
+        first_symbol = *symboltable_currentsize;
+
+        status = NO_ERROR;
+        for(index = 0; index < n_symbolfiles; ++index)
+                if(load_symbolfile(symbolfiles[index], symboltable_list,
+                                   symboltable_currentsize,
+                                   symboltable_actualsize) == ERROR)
+                        status = ERROR;
+
+        return status;
+}
+
+/* Tells whether the symbol at the index is one the program defines, rather than a
+   register, a symbol of a symbol file or a symbol the linker is yet to give a value. */
+int testif_ownsymbol(const symboltable_t *symboltable_list, uint32_t index) {
+        return index >= first_symbol && symboltable_list[index].value_status == DEFINED &&
+                !symboltable_list[index].imported;
+}
+
+static int compare_symbolnames(const void *index1, const void *index2) {
+        return strcmp(sorted_symbols[*(const uint32_t *) index1].name,
+                      sorted_symbols[*(const uint32_t *) index2].name);
+}
+
+static void put_symbolbytes(FILE *symbolfile_handle, uint32_t value, int n_bytes) {
+        int i;
+
+        for(i = 0; i < n_bytes; ++i)
+                fputc((uint8_t) (value >> (8 * i)), symbolfile_handle);
+}
+
+/* Writes the symbols the source defines to the symbol file. */
+status_t write_symbolfile(const symboltable_t *symboltable_list,
+                          uint32_t symboltable_currentsize, FILE *symbolfile_handle) {
+        const symboltable_t *symbol;
+        uint32_t *order;
+        uint32_t index, n_symbols, name_offset;
+
+        order = malloc((symboltable_currentsize + 1) * sizeof(*order));
+        if(order == NULL)
+                return ERROR;
+
+        n_symbols = 0;
+        for(index = 0; index < symboltable_currentsize; ++index)
+                if(testif_ownsymbol(symboltable_list, index))
+                        order[n_symbols++] = index;
+        sorted_symbols = symboltable_list;
+        qsort(order, n_symbols, sizeof(*order), compare_symbolnames);
+
+        fwrite("Z80SYM\0\0", 1, 8, symbolfile_handle);
+        put_symbolbytes(symbolfile_handle, SYMBOLFILE_VERSION, 4);
+        put_symbolbytes(symbolfile_handle, n_symbols, 4);
+
+        name_offset = 0;
+        for(index = 0; index < n_symbols; ++index) {
+                symbol = &symboltable_list[order[index]];
+                put_symbolbytes(symbolfile_handle, name_offset, 4);
+                put_symbolbytes(symbolfile_handle, strlen(symbol->name), 2);
+                put_symbolbytes(symbolfile_handle, symbol->value_type, 1);
+                put_symbolbytes(symbolfile_handle, symbol->value_nbytes, 1);
+                put_symbolbytes(symbolfile_handle, (symbol->value_nbytes > 0) ?
+                                symbol->value[0] : 0, 1);
+                put_symbolbytes(symbolfile_handle, (symbol->value_nbytes == 2) ?
+                                symbol->value[1] : 0, 1);
+                put_symbolbytes(symbolfile_handle, symbol->bank, 1);
+                put_symbolbytes(symbolfile_handle, 0, 1);
+                name_offset += strlen(symbol->name);
+        }
+
+        for(index = 0; index < n_symbols; ++index)
+                fputs(symboltable_list[order[index]].name, symbolfile_handle);
+
+        free(order);
+
+        return ferror(symbolfile_handle) ? ERROR : NO_ERROR;
+}
+
+void free_symbolfiles(void) {
+        free(symbolfiles);
+        symbolfiles = NULL;
+        n_symbolfiles = 0;
+        first_symbol = 0;
+}
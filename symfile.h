@@ -0,0 +1,50 @@
+// File: symfile.h
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Description:
+
+/* This file contains the symbol files. The symbols a program defines can be written to a
+ * symbol file once it is assembled, and the symbol files of other programs read before a
+ * source is assembled, so that an overlay can use the entry points of a ROM without the
+ * ROM being assembled again.
+ */
+
+#ifndef SYMFILE_H
+#define SYMFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "defines.h"
+
+status_t add_symbolfile(const char *symbolfile_name);
+
+status_t load_symbolfiles(symboltable_t **symboltable_list,
+                          uint32_t *symboltable_currentsize,
+                          uint32_t *symboltable_actualsize);
+
+int testif_ownsymbol(const symboltable_t *symboltable_list, uint32_t index);
+
+status_t write_symbolfile(const symboltable_t *symboltable_list,
+                          uint32_t symboltable_currentsize, FILE *symbolfile_handle);
+
+void free_symbolfiles(void);
+
+#endif
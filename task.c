@@ -26,12 +26,97 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
-#include <math.h>
 #include "defines.h"
+#include "stats.h"
+#include "intern.h"
+#include "lexer.h"
+#include "task.h"
+
+#define NO_SYMBOL UINT32_MAX
+
+/* Gives the position in the symbol table of the symbol named by every atom, or
+   NO_SYMBOL. */
+static uint32_t *symbol_indices;
+static uint32_t symbolindices_size;
+
+/* The atom of every entry of the instruction set, in the same layout as the set, and
+   the range of atoms that name a mnemonic. The mnemonics are interned right after the
+   predefined atoms, so they are numbered contiguously. */
+static atom_t *instruction_atoms[26];
+static atom_t first_mnemonicatom, last_mnemonicatom;
+
+static status_t index_symbol(atom_t atom, uint32_t index) {
+        uint32_t *symbol_newindices;
+        uint32_t size, i;
+
+        if(atom >= symbolindices_size) {
+                size = symbolindices_size ? symbolindices_size : 1024;
+                while(size <= atom)
+                        size *= 2;
+                symbol_newindices = realloc(symbol_indices,
+                                            size * sizeof(*symbol_newindices));
+                if(symbol_newindices == NULL)
+                        return ERROR;
+                for(i = symbolindices_size; i < size; ++i)
+                        symbol_newindices[i] = NO_SYMBOL;
+                symbol_indices = symbol_newindices;
+                symbolindices_size = size;
+        }
+
+        symbol_indices[atom] = index;
+
+        return NO_ERROR;
+}
+
+status_t init_instructionatoms(instruction_parameters_t **instruction_set) {
+        int index1, index2;
+        atom_t atom;
+        const char *name;
+
+        first_mnemonicatom = get_natoms();
+
+        for(index1 = 0; index1 < 26; ++index1) {
+                if(instruction_set[index1] == NULL)
+                        continue;
+                for(index2 = 0; instruction_set[index1][index2].instruction_name != NULL;
+                    ++index2)
+                        ;
+                instruction_atoms[index1] = malloc(index2 *
+                                                   sizeof(*instruction_atoms[index1]));
+                if(instruction_atoms[index1] == NULL)
+                        return ERROR;
+                for(index2 = 0; instruction_set[index1][index2].instruction_name != NULL;
+                    ++index2) {
+                        name = instruction_set[index1][index2].instruction_name;
+                        atom = intern_string(name, strlen(name));
+                        if(atom == ATOM_NONE)
+                                return ERROR;
+                        instruction_atoms[index1][index2] = atom;
+                }
+        }
+
+        last_mnemonicatom = get_natoms() - 1;
+
+        return NO_ERROR;
+}
+
+atom_t get_instructionatom(int index1, int index2) {
+        return instruction_atoms[index1][index2];
+}
+
+void free_instructionatoms(void) {
+        int index;
+
+        for(index = 0; index < 26; ++index) {
+                free(instruction_atoms[index]);
+                instruction_atoms[index] = NULL;
+        }
+}
 
 void init_symboltable(symboltable_t **symboltable_list, symboltable_t *defined_symbols,
-                     uint8_t *symboltable_currentsize, uint8_t *symboltable_actualsize) {
+                     uint32_t *symboltable_currentsize, uint32_t *symboltable_actualsize) {
         int index = 0, size = 0;
+        atom_t atom;
         
         while(defined_symbols[index].name != NULL) {
                 ++size;
@@ -57,6 +142,16 @@ void init_symboltable(symboltable_t **symboltable_list, symboltable_t *defined_s
                                 defined_symbols[index].value[1];
                         (*symboltable_list)[index].value_status =
                                 defined_symbols[index].value_status;
+                        (*symboltable_list)[index].value_expression = NULL;
+                        (*symboltable_list)[index].bank = 0;
+                        (*symboltable_list)[index].imported = 0;
+                        atom = intern_string(defined_symbols[index].name,
+                                             strlen(defined_symbols[index].name));
+                        if(atom == ATOM_NONE || index_symbol(atom, index) == ERROR) {
+                                free(*symboltable_list);
+                                *symboltable_list = NULL;
+                                return;
+                        }
                         ++index;
                         ++(*symboltable_currentsize);
                 }
@@ -65,144 +160,103 @@ void init_symboltable(symboltable_t **symboltable_list, symboltable_t *defined_s
 
 void free_symboltable(symboltable_t **symboltable_list) {
         free(*symboltable_list);
+        free(symbol_indices);
+        symbol_indices = NULL;
+        symbolindices_size = 0;
 }
 
-void goto_nextline(FILE *file_handle, line_status_t line_status) {
-        int c;
-        if(line_status == CARRIAGERETURN_DETECTED ||
-           line_status == COMMNTDELIM_DETECTED) {
-                do {
-                        c = fgetc(file_handle);
-                } while(c != EOF && c != '\n');
+data_status_t lookup_symbol(atom_t symbol, uint32_t *index) {
+        COUNT(symbol_lookups);
+
+        if(symbol >= symbolindices_size || symbol_indices[symbol] == NO_SYMBOL)
+                return INVALID;
+        *index = symbol_indices[symbol];
+
+        return VALID;
+}
+
+void goto_nextline(tokenstream_t *tokenstream, line_status_t line_status) {
+        if(line_status == COMMNTDELIM_DETECTED) {
+                while(tokenstream->tokens[tokenstream->position].type != TOKEN_NEWLINE &&
+                      tokenstream->tokens[tokenstream->position].type != TOKEN_END)
+                        ++tokenstream->position;
         }
 }
 
-program_status_t extract_nearestword(FILE *file_handle, char *buffer,
-                                     unsigned char max_buffersize,
+program_status_t extract_nearestword(tokenstream_t *tokenstream, tokenrange_t *word,
                                      line_status_t *line_status) {
-        action_status_t action_status;
-        program_status_t program_status;
-        int c;
-        unsigned char index;
-        
-        /* Look for the first non-whitespace character on the current line. If the first
-           non-whitespace character is a semicolon, then the rest of the current line is
-           part of a comment and the program should analyze immediately after the
-           current line. This continues until something can be analyzed that is not part
-           of a comment. When that happens, the following do-loop terminates and program
-           execution continues thereafter. */
-        action_status = LOOKFOR_NONWHITESPACE;
-
-        do {
-                do {
-                        c = fgetc(file_handle);
-                } while(c != EOF && (c == ' ' || c == '\r' || c == '\n' || c == '\t'));
-
-                if(c == ';') {
-                        do {
-                                c = fgetc(file_handle);
-                        } while(c != EOF && c != '\n');
-                        if(c == EOF)
-                                action_status = STOP_ACTION;
-                        else
-                                action_status = LOOKFOR_NONWHITESPACE;
-                }
-                else if(c == EOF)
-                        action_status = STOP_ACTION;
-                else
-                        action_status = BEGIN_PARSING;
-        } while(action_status == LOOKFOR_NONWHITESPACE);
-
-        switch(action_status) {
-        case BEGIN_PARSING:
-                index = 0;
-                do {
-                        buffer[index++] = c;
-                        c = fgetc(file_handle);
-                } while(c != EOF && c != ';' && c != ' ' && c != '\n' && c != '\r' &&
-                        c != '\t');
-                buffer[index] = '\0';
-
-                if(c == EOF)
-                        *line_status = ENDOFFILE_DETECTED;
-                else if(c == ';')
-                        *line_status = COMMNTDELIM_DETECTED;
-                else if(c == ' ' || c == '\t')
-                        *line_status = NONE_DETECTED;
-                else if(c == '\n')
-                        *line_status = NEWLINE_DETECTED;
-                else if(c == '\r')
-                        *line_status = CARRIAGERETURN_DETECTED;
-                program_status = CONTINUE_PARSE;
-                break;
-        case STOP_ACTION:
+        token_t *token;
+
+        /* Skip over comments and line ends to the first token that can be analyzed. A
+           label is taken as one word together with the colon that follows it. */
+        token = &tokenstream->tokens[tokenstream->position];
+        while(token->type == TOKEN_NEWLINE || token->type == TOKEN_COMMENT)
+                ++token;
+        tokenstream->position = token - tokenstream->tokens;
+
+        if(token->type == TOKEN_END) {
                 *line_status = ENDOFFILE_DETECTED;
-                program_status = STOP_PARSE;
-                break;
+                return STOP_PARSE;
         }
-        
-        return program_status;
+
+        word->tokens = token;
+        word->n_tokens = 1;
+        if(token->type == TOKEN_IDENTIFIER && token[1].type == TOKEN_PUNCTUATION &&
+           token[1].text[0] == ':' && !(token[1].flags & TOKEN_SPACED))
+                word->n_tokens = 2;
+
+        tokenstream->position += word->n_tokens;
+        *line_status = get_linestatus(tokenstream);
+
+        return CONTINUE_PARSE;
 }
 
-word_type_t parse_wordtype(const char *buffer,
-                           instruction_parameters_t **instruction_set) {
+/* Classifies the word. A word that starts with a letter is an identifier, which the
+   lexer has already interned; a label is its identifier followed by a colon. */
+word_type_t parse_wordtype(const tokenrange_t *word,
+                           instruction_parameters_t **instruction_set, atom_t *atom) {
         word_type_t word_type = UNKNOWN;
-        int index1, index2;
 
-        if(buffer[0] < 'A' || buffer[0] > 'Z')
+        *atom = ATOM_NONE;
+
+        if(word->tokens[0].text[0] < 'A' || word->tokens[0].text[0] > 'Z')
                 return word_type;
 
-        if(buffer[(strlen(buffer)) - 1] == ':') {
+        if(word->n_tokens == 2)
                 word_type = LABEL;
-        }
+
+        *atom = word->tokens[0].atom;
 
         if(word_type == UNKNOWN) {
-                if((!strcmp("ORG", buffer)) || (!strcmp("EQU", buffer)))
+                if(*atom >= ATOM_ORG && *atom < N_PREDEFINEDATOMS)
                         word_type = DIRECTIVE;
+                else if(*atom >= first_mnemonicatom && *atom <= last_mnemonicatom)
+                        word_type = INSTRUCTION;
         }
-        
 
-        if(word_type == UNKNOWN) {
-                index1 = buffer[0] - 65;
-                index2 = 0;
-                if(instruction_set[index1] != NULL) {
-                        while(instruction_set[index1][index2].instruction_name !=
-                              NULL) {
-                             if(!strcmp(instruction_set[index1][index2].instruction_name,
-                                           buffer)) {
-                                        word_type = INSTRUCTION;
-                                }
-                                ++index2;
-                        }
-                }
-        }
         return word_type;
 }
 
-void storein_symboltable(char *entry, uint8_t entry_type, uint8_t entry_nbytes,
+void storein_symboltable(atom_t entry, uint8_t entry_type, uint8_t entry_nbytes,
                          uint8_t entry_value[], symboltable_t **symboltable_list,
-                         uint8_t *symboltable_currentsize, 
-                         uint8_t *symboltable_actualsize) {
+                         uint32_t *symboltable_currentsize, 
+                         uint32_t *symboltable_actualsize) {
         symboltable_t *symboltable_newlist;
-        int index, mainindex, size, i;
-        enum entry_status_t {NOT_FOUND = 0, FOUND} entry_status;
-
-        entry_status = NOT_FOUND;
-
-        for(index = 0; index < *symboltable_currentsize; ++index) 
-                if(!strcmp((*symboltable_list)[index].name, entry)) {
-                        entry_status = FOUND;
-                        mainindex = index;
-                }
-
-        if(entry_status == FOUND) {
-                if((*symboltable_list)[mainindex].value_status == DEFINED) {
+        uint32_t index, mainindex;
+        int i;
+
+        if(lookup_symbol(entry, &mainindex) == VALID) {
+                /* A symbol read from a symbol file is hidden by the one the source
+                   defines. */
+                if((*symboltable_list)[mainindex].value_status != UNDEFINED &&
+                   !(*symboltable_list)[mainindex].imported) {
                         /* If the symbol is already found and is already defined in the
                            symbol table, the this is an error since storing the symbol
                            table will define the symbol more than once. In that case
                            program execution must be terminated. */
                         free(*symboltable_list);
-                        STDERR("the symbol \"%s\" is defined more than once\n", entry);
+                        STDERR("the symbol \"%s\" is defined more than once\n",
+                               get_atomname(entry));
                         EFAILURE;
                 }
                 else {
@@ -213,15 +267,19 @@ void storein_symboltable(char *entry, uint8_t entry_type, uint8_t entry_nbytes,
                                 (*symboltable_list)[mainindex].value[i] = entry_value[i];
                         
                         (*symboltable_list)[mainindex].value_status = DEFINED;
+                        (*symboltable_list)[mainindex].value_expression = NULL;
+                        (*symboltable_list)[mainindex].bank = 0;
+                        (*symboltable_list)[mainindex].imported = 0;
                 }
         }
         else {
                 /* The following if-block is entered only when there is no more room in
                    the symbol table to store additional symbols. In that case, the symbol
-                   table has to be dynamically extended to make room. */
+                   table has to be dynamically extended to make room. The table is
+                   doubled so that the cost of copying it stays linear overall. */
                 if(*symboltable_currentsize == *symboltable_actualsize) {
                         symboltable_newlist = realloc(*symboltable_list,
-                                                      (*symboltable_actualsize + 10) *
+                                                      (*symboltable_actualsize * 2 + 10) *
                                                       sizeof(*symboltable_newlist));
                         if(symboltable_newlist == NULL) {
                                 free(*symboltable_list);
@@ -231,25 +289,14 @@ void storein_symboltable(char *entry, uint8_t entry_type, uint8_t entry_nbytes,
                         }
                         else {
                                 *symboltable_list = symboltable_newlist;
-                                *symboltable_actualsize += 10;
+                                *symboltable_actualsize = *symboltable_actualsize * 2 + 10;
                         }
                 }
 
+                /* The name is the spelling of the atom, which lives as long as the
+                   intern table. */
                 index = (*symboltable_currentsize)++;
-                size = strlen(entry) + 1;
-                (*symboltable_list)[index].name = malloc(size *
-                                             sizeof(*((*symboltable_list)[index].name)));
-                if((*symboltable_list)[index].name == NULL) {
-                        free(*symboltable_list);
-                        STDERR("could not allocate space to store the symbol \"%s\"\n",
-                               entry);
-                        EFAILURE;
-                }
-
-                /* This point will not be reached if space could not be allocated to
-                   store the entry string. */
-
-                strcpy((*symboltable_list)[index].name, entry);
+                (*symboltable_list)[index].name = get_atomname(entry);
                 (*symboltable_list)[index].value_type = entry_type;
                 (*symboltable_list)[index].value_nbytes = entry_nbytes;
                 
@@ -257,297 +304,75 @@ void storein_symboltable(char *entry, uint8_t entry_type, uint8_t entry_nbytes,
                         (*symboltable_list)[index].value[i] = entry_value[i];
 
                 (*symboltable_list)[index].value_status = DEFINED;
-                
-        }
-        
-}
+                (*symboltable_list)[index].value_expression = NULL;
+                (*symboltable_list)[index].bank = 0;
+                (*symboltable_list)[index].imported = 0;
 
-uint16_t asciistr_to16bitnum(char *buffer) {
-        int index, boundary;
-        uint16_t value = 0;
-        uint8_t exponent, multiplicand;
-
-        index = strlen(buffer) - 1;
-
-        if(buffer[index] == 'H' || buffer[index] == 'h') {
-                index = strlen(buffer) - 2;
-                boundary = 0;
-                exponent = 0;
-                for(; index >= boundary; --index) {
-                        if(buffer[index] >= '0' && buffer[index] <= '9') 
-                                multiplicand = buffer[index] - 48;
-                        else if(buffer[index] >= 'A' && buffer[index] <= 'F')
-                                multiplicand = buffer[index] - 55;
-                        else if(buffer[index] >= 'a' && buffer[index] <= 'f')
-                                multiplicand = buffer[index] - 87;
-                        
-                        value += multiplicand * pow(16, exponent);
-                        ++exponent;
-                }
-        }
-        else {
-                index = strlen(buffer) - 1;
-                boundary = 0;
-                exponent = 0;
-                for(; index >= boundary; --index) {
-                        value += (buffer[index] - 48) * pow(10, exponent);
-                        ++exponent;
+                if(index_symbol(entry, index) == ERROR) {
+                        free(*symboltable_list);
+                        STDERR("could not index the symbol \"%s\"\n",
+                               get_atomname(entry));
+                        EFAILURE;
                 }
         }
-
-        return value;
+        
 }
 
-void extract_operands(FILE *file_handle, char *operand1, char *operand2,
-                      line_status_t *line_status, uint8_t *n_operands) {
-        int c, index;
-        char buffer[20];
-
-        /* Find the nearest non-whitespace character to determine from what location to
-           start the extraction. */
-        do {
-                c = fgetc(file_handle);
-        } while(c != EOF && (c == ' ' || c == '\t'));
-
-        if(c == EOF || c == '\n' || c == '\r' || c == ';') {
-                *n_operands = 0;
-                
-                if(c == EOF)
-                        *line_status = ENDOFFILE_DETECTED;
-                else if(c == '\n')
-                        *line_status = NEWLINE_DETECTED;
-                else if(c == '\r')
-                        *line_status = CARRIAGERETURN_DETECTED;
-                else
-                        *line_status = COMMNTDELIM_DETECTED;
-        }
-        else {
-                index = 0;
-                /* Once the first non-whitespace character is found, then store it in a
-                   buffer to be later analyzed. Gather all characters up until either a
-                   whitespace character, end of file indicator, carriage return, newline,
-                   or comment delimiter is encountered. */
-                do {
-                        buffer[index++] = c;
-                        c = fgetc(file_handle);
-                } while(c != EOF && c != ' ' && c != '\t' && c != '\n' && c != '\r' &&
-                        c != ';');
-                buffer[index] = '\0';
-
-// development start area
-                if(!strcmp(buffer, "(IX") || !strcmp(buffer, "(IY") ||
-                   !strcmp(buffer, "(IX+") || !strcmp(buffer, "(IY+")) {
-                        if(c == ' ' || c == '\t')
-                                        buffer[index++] = c;
-                        do {
-                                c = fgetc(file_handle);
-                                if(c != EOF && c != '\n' && c != '\r' && c != ';') 
-                                        buffer[index++] = c;
-                        } while(c != EOF && c != '\n' && c != '\r' && c != ';' &&
-                                c != ')');
-                        buffer[index] = '\0';
-
-                        if(c == ')') {
-                                do {
-                                        c = fgetc(file_handle);
-                                        if(c != EOF && c != '\n' && c != '\r' &&
-                                           c != ';' && c != ' ' && c != '\t')
-                                                buffer[index++] = c;
-                                } while(c != EOF && c != '\n' && c != '\r' &&
-                                        c != ';' && c != ' ' && c != '\t');
-                                buffer[index] = '\0';
-                        }
-                }
-                
-// devlopment end area
-                *n_operands = 1;
-
-                if(c == EOF)
-                        *line_status = ENDOFFILE_DETECTED;
-                else if(c == '\n')
-                        *line_status = NEWLINE_DETECTED;
-                else if(c == '\r')
-                        *line_status = CARRIAGERETURN_DETECTED;
-                else if(c == ';')
-                        *line_status = COMMNTDELIM_DETECTED;
-                else
-                        *line_status = NONE_DETECTED;
-
-                strcpy(operand1, buffer);
-        }
+/* An operand is the run of tokens up to a comma or the end of the line. Whitespace
+   inside an operand is insignificant, so "(IX + 5)" and "(IX+5)" are the same. */
+static void extract_operand(tokenstream_t *tokenstream, tokenrange_t *operand) {
+        token_t *token;
 
-        index = strlen(buffer) - 1;
+        token = &tokenstream->tokens[tokenstream->position];
+        operand->tokens = token;
+        while(token->type != TOKEN_NEWLINE && token->type != TOKEN_COMMENT &&
+              token->type != TOKEN_END &&
+              !(token->type == TOKEN_PUNCTUATION && token->text[0] == ','))
+                ++token;
 
-        /* Determine whether a comma exists at the end of the characters previously
-           extracted. If the comma exists, then this means that 2 operands are being
-           supplied and that the second operand must also be extracted as the same way as
-           before. */
-        if(*line_status == NONE_DETECTED && buffer[index] == ',') {
-                operand1[index] = '\0';
-                
-                do {
-                        c = fgetc(file_handle);
-                } while(c != EOF && (c == ' ' || c == '\t'));
-
-                if(c == EOF)
-                        *line_status = ENDOFFILE_DETECTED;
-                else if(c == '\n')
-                        *line_status = NEWLINE_DETECTED;
-                else if(c == '\r')
-                        *line_status = CARRIAGERETURN_DETECTED;
-                else if(c == ';')
-                        *line_status = COMMNTDELIM_DETECTED;
-                else {
-                        index = 0;
-                        do {
-                                buffer[index++] = c;
-                                c = fgetc(file_handle);
-                        } while(c != EOF && c != ' ' && c != '\t' && c != '\n' &&
-                                c != '\r' && c != ';');
-                        buffer[index] = '\0';
-
-// development start area
-                        if(!strcmp(buffer, "(IX") || !strcmp(buffer, "(IY") ||
-                           !strcmp(buffer, "(IX+") || !strcmp(buffer, "(IY+")) {
-                                if(c == ' ' || c == '\t')
-                                        buffer[index++] = c;
-                                do {
-                                        c = fgetc(file_handle);
-                                        if(c != EOF && c != '\n' && c != '\r' && c != ';') 
-                                                buffer[index++] = c;
-                                } while(c != EOF && c != '\n' && c != '\r' && c != ';' &&
-                                        c != ')');
-                                buffer[index] = '\0';
-                        }
-                
-// devlopment end area
-                        
-                        ++(*n_operands);
-
-                        strcpy(operand2, buffer);
-
-                        if(c == EOF)
-                                *line_status = ENDOFFILE_DETECTED;
-                        else if(c == '\n')
-                                *line_status = NEWLINE_DETECTED;
-                        else if(c == '\r')
-                                *line_status = CARRIAGERETURN_DETECTED;
-                        else if(c == ';')
-                                *line_status = COMMNTDELIM_DETECTED;
-                        else
-                                *line_status = NONE_DETECTED;
-                }
-        }
+        operand->n_tokens = token - operand->tokens;
+        tokenstream->position = token - tokenstream->tokens;
 }
 
-data_status_t testif_numvalid(char *buffer, uint8_t *byte_length) {
-        data_status_t data_status;
-        int index, boundary;
-        uint16_t value = 0;
-        uint8_t exponent;
-        uint8_t multiplicand;
-
-        index = strlen(buffer) - 1;
+void extract_operands(tokenstream_t *tokenstream, tokenrange_t *operand1,
+                      tokenrange_t *operand2, line_status_t *line_status,
+                      uint8_t *n_operands) {
+        token_t *token;
 
-        if(strlen(buffer) == 1 && (buffer[index] == 'H' || buffer[index] == 'h')) {
-                return INVALID;
-        }
-
-        data_status = VALID;
-
-        if(buffer[index] == 'H' || buffer[index] == 'h') {
-                boundary = strlen(buffer) - 1;
-                for(index = 0; index < boundary; ++index)
-                        if((buffer[index] < '0' || buffer[index] > '9') &&
-                           (buffer[index] < 'A' || buffer[index] > 'F') &&
-                           (buffer[index] < 'a' || buffer[index] > 'f'))
-                                data_status = INVALID;
-
-                if(data_status != INVALID) {
-                        index = boundary - 1;
-                        boundary = 0;
-                        exponent = 0;
-                        for(; index >= boundary; --index) {
-                                if((buffer[index] >= 'A' && buffer[index] <= 'F') ||
-                                   (buffer[index] >= 'a' && buffer[index] <= 'f'))
-                                        multiplicand = buffer[index] - 55;
-                                else
-                                        multiplicand = buffer[index] - 48;
-                                value += multiplicand * pow(16, exponent);
-                                ++exponent;
-                        }
-
-                        if(value < 256)
-                                *byte_length = 1;
-                        else
-                                *byte_length = 2;
+        *n_operands = 0;
 
-                        data_status = VALID;
-                }
-        }
-        else {
-                boundary = strlen(buffer);
-                for(index = 0; index < boundary; ++index)
-                        if(buffer[index] < '0' || buffer[index] > '9')
-                                data_status = INVALID;
-
-                if(data_status != INVALID) {
-                        index = boundary - 1;
-                        boundary = 0;
-                        exponent = 0;
-                        for(; index >= boundary; --index) {
-                                value += (buffer[index] - 48) * pow(10, exponent);
-                                ++exponent;
-                        }
+        *line_status = get_linestatus(tokenstream);
+        if(*line_status != NONE_DETECTED)
+                return;
 
-                        if(value < 256)
-                                *byte_length = 1;
-                        else
-                                *byte_length = 2;
+        extract_operand(tokenstream, operand1);
+        *n_operands = 1;
 
-                        data_status = VALID;
+        /* A comma after the first operand means that a second operand is supplied. */
+        token = &tokenstream->tokens[tokenstream->position];
+        if(token->type == TOKEN_PUNCTUATION && token->text[0] == ',') {
+                ++tokenstream->position;
+                if(get_linestatus(tokenstream) == NONE_DETECTED) {
+                        extract_operand(tokenstream, operand2);
+                        *n_operands = 2;
                 }
         }
 
-        return data_status;
-}
-
-void put8bitval_inhex(FILE *outputfile_handle, uint8_t value) {
-        uint8_t lval;
-        char c;
-
-        lval = (value >> 4);
-        if(lval >= 10)
-                c = lval + 55;
-        else
-                c = lval + 48;
-
-        fputc(c, outputfile_handle);
-
-        lval = value & 0x0F;
-        if(lval >= 10)
-                c = lval + 55;
-        else
-                c = lval + 48;
-
-        fputc(c, outputfile_handle);
+        *line_status = get_linestatus(tokenstream);
 }
 
-uint8_t hexstr_todecnum(char *hexliteral) {
-        uint8_t value;
-
-        if(hexliteral[1] >= 'A' && hexliteral[1] <= 'F') 
-                value = (hexliteral[1] - 55);
-
-        else 
-                value = (hexliteral[1] - 48);
-
+/* Gives the atom an operand is known by in the symbol table: the atom of its only
+   token, or the atom of a memory reference made through a register. */
+atom_t get_operandatom(const tokenrange_t *operand) {
+        const token_t *tokens = operand->tokens;
 
-        if(hexliteral[0] >= 'A' && hexliteral[0] <= 'F') 
-                value |= ((hexliteral[0] - 55) << 4);
+        if(operand->n_tokens == 1)
+                return tokens[0].atom;
 
-        else 
-                value |= ((hexliteral[0] - 48) << 4);
+        if(operand->n_tokens == 3 && tokens[0].type == TOKEN_PUNCTUATION &&
+           tokens[0].text[0] == '(' && tokens[1].type == TOKEN_REGISTER &&
+           tokens[2].type == TOKEN_PUNCTUATION && tokens[2].text[0] == ')')
+                return get_memrefatom(tokens[1].atom);
 
-        return value;
+        return ATOM_NONE;
 }
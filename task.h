@@ -20,37 +20,41 @@
 
 #include <stdint.h>
 #include "defines.h"
+#include "lexer.h"
 
 #ifndef TASK_H
 #define TASK_H
 
 void init_symboltable(symboltable_t **symboltable_list, symboltable_t *defined_symbols,
-                      uint8_t *symboltable_currentsize, uint8_t *symboltable_actualsize);
+                      uint32_t *symboltable_currentsize, uint32_t *symboltable_actualsize);
 
 void free_symboltable(symboltable_t **symboltable_list);
 
-void goto_nextline(FILE *file_handle, line_status_t);
+data_status_t lookup_symbol(atom_t symbol, uint32_t *index);
 
-program_status_t extract_nearestword(FILE *file_handle, char *buffer,
-                                     unsigned char max_buffersize,
-                                     line_status_t *line_status);
+status_t init_instructionatoms(instruction_parameters_t **instruction_set);
 
-word_type_t parse_wordtype(const char *buffer, instruction_parameters_t **instruction_set);
+atom_t get_instructionatom(int index1, int index2);
 
-void storein_symboltable(char *entry, uint8_t entry_type, uint8_t entry_nbytes,
-                         uint8_t entry_value[], symboltable_t **symboltable_list,
-                         uint8_t *symboltable_currentsize,
-                         uint8_t *symboltable_actualsize);
+void free_instructionatoms(void);
 
-uint16_t asciistr_to16bitnum(char *buffer);
+void goto_nextline(tokenstream_t *tokenstream, line_status_t line_status);
 
-void extract_operands(FILE *file_handle, char *operand1, char *operand2,
-                      line_status_t *line_status, uint8_t *n_operands);
+program_status_t extract_nearestword(tokenstream_t *tokenstream, tokenrange_t *word,
+                                     line_status_t *line_status);
 
-data_status_t testif_numvalid(char *operand, uint8_t *byte_length);
+word_type_t parse_wordtype(const tokenrange_t *word,
+                           instruction_parameters_t **instruction_set, atom_t *atom);
+
+void storein_symboltable(atom_t entry, uint8_t entry_type, uint8_t entry_nbytes,
+                         uint8_t entry_value[], symboltable_t **symboltable_list,
+                         uint32_t *symboltable_currentsize,
+                         uint32_t *symboltable_actualsize);
 
-void put8bitval_inhex(FILE *outputfile_handle, uint8_t value);
+void extract_operands(tokenstream_t *tokenstream, tokenrange_t *operand1,
+                      tokenrange_t *operand2, line_status_t *line_status,
+                      uint8_t *n_operands);
 
-uint8_t hexstr_todecnum(char *hexliteral);
+atom_t get_operandatom(const tokenrange_t *operand);
 
 #endif
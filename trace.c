@@ -0,0 +1,107 @@
+// File: trace.c
+// Created: 19, October 2026
+
+/* Copyright (C) 2014 Jarielle Catbagan
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Description:
+
+/* This file contains the trace writer. Spans are written as begin/end event pairs as
+ * soon as they happen, so the trace of a run that is interrupted can still be loaded
+ * once the closing brackets are added by hand. Every event carries the process and
+ * thread that produced it so that traces of several assembler runs can be merged and
+ * still show one timeline per job.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "defines.h"
+#include "trace.h"
+
+static FILE *tracefile_handle;
+static struct timespec trace_start;
+static long trace_pid;
+static unsigned long n_events;
+
+static void put_jsonstring(FILE *file_handle, const char *str) {
+        fputc('"', file_handle);
+        for(; *str != '\0'; ++str) {
+                if(*str == '"' || *str == '\\')
+                        fputc('\\', file_handle);
+                if((unsigned char) *str < 0x20)
+                        fprintf(file_handle, "\\u%04x", (unsigned char) *str);
+                else
+                        fputc(*str, file_handle);
+        }
+        fputc('"', file_handle);
+}
+
+static void put_traceevent(const char *name, const char *category, char phase) {
+        struct timespec now;
+        double timestamp;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        timestamp = (now.tv_sec - trace_start.tv_sec) * 1e6 +
+                (now.tv_nsec - trace_start.tv_nsec) / 1e3;
+
+        fputs((n_events++ == 0) ? "\n" : ",\n", tracefile_handle);
+        fputs("{\"name\": ", tracefile_handle);
+        put_jsonstring(tracefile_handle, name);
+        fputs(", \"cat\": ", tracefile_handle);
+        put_jsonstring(tracefile_handle, category);
+        fprintf(tracefile_handle, ", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": %ld, "
+                "\"tid\": %ld}", phase, timestamp, trace_pid, trace_pid);
+}
+
+status_t open_trace(const char *tracefile_name) {
+        tracefile_handle = fopen(tracefile_name, "w");
+        if(tracefile_handle == NULL)
+                return ERROR;
+
+        clock_gettime(CLOCK_MONOTONIC, &trace_start);
+        trace_pid = (long) getpid();
+        n_events = 0;
+
+        fputs("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [", tracefile_handle);
+        fputs("\n{\"name\": \"process_name\", \"ph\": \"M\", ", tracefile_handle);
+        fprintf(tracefile_handle, "\"pid\": %ld, \"tid\": %ld, \"args\": {\"name\": "
+                "\"z80asm\"}}", trace_pid, trace_pid);
+        ++n_events;
+
+        return NO_ERROR;
+}
+
+void begin_tracespan(const char *name, const char *category) {
+        if(tracefile_handle != NULL)
+                put_traceevent(name, category, 'B');
+}
+
+void end_tracespan(const char *name, const char *category) {
+        if(tracefile_handle != NULL)
+                put_traceevent(name, category, 'E');
+}
+
+void close_trace(void) {
+        if(tracefile_handle == NULL)
+                return;
+
+        fputs("\n]}\n", tracefile_handle);
+        fclose(tracefile_handle);
+        tracefile_handle = NULL;
+}
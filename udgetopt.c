@@ -21,12 +21,19 @@
 // Code:
 
 #include <string.h>
+#include "udgetopt.h"
 
-extern char *optarg;
+char *optarg;
 static int args_index = 1;
 
 int udgetopt(int argc, char *const *argv, const char *options) {
+        return udgetopt_long(argc, argv, options, NULL);
+}
+
+int udgetopt_long(int argc, char *const *argv, const char *options,
+                  const udoption_t *long_options) {
         unsigned int options_length = 0, n_options = 0, opt_index;
+        size_t name_length;
         int retval;
         enum loop_status_t {EXIT = 0, CONTINUE} loop_status, subloop_status;
         enum option_status_t {INVALID = 0, VALID} option_status;
@@ -47,6 +54,34 @@ int udgetopt(int argc, char *const *argv, const char *options) {
 
                 switch(argument_status) {
                 case OPTION_DETECTED:
+                        if(argv[args_index][1] == '-' && long_options != NULL) {
+                                for(opt_index = 0; long_options[opt_index].name != NULL;
+                                    ++opt_index) {
+                                        name_length = strlen(long_options[opt_index].name);
+                                        if(!strncmp(&argv[args_index][2],
+                                                    long_options[opt_index].name,
+                                                    name_length) &&
+                                           (argv[args_index][2 + name_length] == '\0' ||
+                                            argv[args_index][2 + name_length] == '='))
+                                                break;
+                                }
+
+                                if(long_options[opt_index].name == NULL) {
+                                        ++args_index;
+                                        return '?';
+                                }
+
+                                optarg = NULL;
+                                if(long_options[opt_index].has_argument) {
+                                        if(argv[args_index][2 + name_length] == '=')
+                                                optarg = &argv[args_index][3 + name_length];
+                                        else if((args_index + 1) < argc)
+                                                optarg = argv[++args_index];
+                                }
+                                ++args_index;
+                                return long_options[opt_index].value;
+                        }
+
                         subloop_status = CONTINUE;
                         option_status = INVALID;
                         opt_index = 0;
@@ -66,8 +101,10 @@ int udgetopt(int argc, char *const *argv, const char *options) {
                                                 optarg = argv[args_index + 1];
                                         else
                                                 optarg = NULL;
-                                        ++args_index;
                                 }
+                                /* The argument of the option, if it has one, is stepped
+                                   over as an argument that is not an option. */
+                                ++args_index;
                                 return retval;
                         }
                         else
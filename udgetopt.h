@@ -25,9 +25,20 @@
 #ifndef UDGETOPT_H
 #define UDGETOPT_H
 
-char *optarg;
+extern char *optarg;
+
+/* Long options are matched against argv entries starting with "--". An option that
+   takes an argument accepts it either as the next entry or after an '=' sign. */
+typedef struct udoption_t {
+        const char *name;
+        int has_argument;
+        int value;
+} udoption_t;
 
 int udgetopt(int argc, char *const *argv, const char *options);
 
+int udgetopt_long(int argc, char *const *argv, const char *options,
+                  const udoption_t *long_options);
+
 
 #endif
@@ -30,17 +30,221 @@
 #include "defines.h"
 #include "parse.h"
 #include "task.h"
+#include "arena.h"
+#include "intern.h"
+#include "lexer.h"
 #include "assemble.h"
+#include "expr.h"
+#include "image.h"
+#include "source.h"
+#include "macro.h"
+#include "cond.h"
+#include "repeat.h"
+#include "page.h"
+#include "section.h"
+#include "bank.h"
+#include "object.h"
+#include "link.h"
+#include "symfile.h"
+#include "sourcemap.h"
+#include "stats.h"
+#include "trace.h"
 #include "z80instructionset.h"
 
+static const udoption_t long_options[] = {
+        {"source", 1, 's'},
+        {"mix", 1, 'm'},
+        {"stats", 1, 'S'},
+        {"trace", 1, 'T'},
+        {"include", 1, 'I'},
+        {"map", 1, 'M'},
+        {"allow-overlap", 0, 'O'},
+        {"object", 0, 'c'},
+        {"link", 1, 'l'},
+        {"export-symbols", 0, 'X'},
+        {"import-symbols", 1, 'R'},
+        {"source-map", 1, 'D'},
+        {"deps", 1, 'P'},
+        {NULL, 0, 0}
+};
+
+static report_format_t get_reportformat(const char *format) {
+        if(format == NULL)
+                return REPORT_NONE;
+        else if(!strcmp(format, "text"))
+                return REPORT_TEXT;
+        else if(!strcmp(format, "json"))
+                return REPORT_JSON;
+        else
+                return REPORT_NONE;
+}
+
+/* Writes the symbols to a symbol file named as the output file is, with the extension
+   of the output file replaced by "sym". */
+static void export_symbols(char *outputfile_name, uint32_t symboltable_currentsize) {
+        FILE *symbolfile_handle;
+        status_t status;
+
+        strcpy(&outputfile_name[strlen(outputfile_name) - 3], "sym");
+        symbolfile_handle = fopen(outputfile_name, "wb");
+        if(symbolfile_handle == NULL) {
+                STDERR("the symbol file (%s) could not be created\n", outputfile_name);
+                EFAILURE;
+        }
+        status = write_symbolfile(symboltable_list, symboltable_currentsize,
+                                  symbolfile_handle);
+        if(fclose(symbolfile_handle) != 0 || status == ERROR) {
+                STDERR("the symbol file (%s) could not be written\n", outputfile_name);
+                EFAILURE;
+        }
+}
+
+/* Writes the dependency file that has the output file depend on every file read. */
+static void write_dependfile(const char *dependfile_name, const char *outputfile_name) {
+        FILE *dependfile_handle;
+        status_t status;
+
+        dependfile_handle = fopen(dependfile_name, "w");
+        if(dependfile_handle == NULL) {
+                STDERR("the dependency file (%s) could not be created\n",
+                       dependfile_name);
+                EFAILURE;
+        }
+        status = write_dependencies(outputfile_name, dependfile_handle);
+        if(fclose(dependfile_handle) != 0 || status == ERROR) {
+                STDERR("the dependency file (%s) could not be written\n",
+                       dependfile_name);
+                EFAILURE;
+        }
+}
+
+/* Links the object files given with --link into a HEX file named after the first of
+   them. */
+static void link_program(report_format_t map_format, int allow_overlap,
+                         int export_flag, const char *sourcemap_name,
+                         const char *dependfile_name) {
+        uint32_t symboltable_currentsize = 0, symboltable_actualsize = 0;
+        outputimage_t outputimage;
+        FILE *outputfile_handle;
+        char *outputfile_name, *extension;
+        const char *objectfile_name;
+        arena_t arena;
+        status_t status;
+
+        init_arena(&arena);
+        if(init_interntable(&arena) == ERROR || init_expressions(&arena) == ERROR) {
+                STDERR("the intern table could not be created\n");
+                EFAILURE;
+        }
+        init_symboltable(&symboltable_list, z80_symbols, &symboltable_currentsize,
+                         &symboltable_actualsize);
+        if(symboltable_list == NULL) {
+                STDERR("the symbol table could not be created\n");
+                EFAILURE;
+        }
+        if(load_symbolfiles(&symboltable_list, &symboltable_currentsize,
+                            &symboltable_actualsize) == ERROR) {
+                STDERR("the symbol files could not be read\n");
+                EFAILURE;
+        }
+        init_outputimage(&outputimage);
+        if(sourcemap_name != NULL && open_sourcemap(sourcemap_name) == ERROR) {
+                STDERR("the source map (%s) could not be created\n", sourcemap_name);
+                EFAILURE;
+        }
+
+        status = link_objectfiles(&symboltable_list, &symboltable_currentsize,
+                                  &symboltable_actualsize, &outputimage);
+        if(status == ERROR) {
+                STDERR("the modules could not be linked\n");
+                EFAILURE;
+        }
+        if(!allow_overlap && check_imageoverlaps(&outputimage) == ERROR) {
+                STDERR("the program was emitted over itself\n");
+                EFAILURE;
+        }
+
+        objectfile_name = get_objectfilename(0);
+        outputfile_name = malloc(strlen(objectfile_name) + 5);
+        if(outputfile_name == NULL) {
+                STDERR("the output file can not be created\n");
+                EFAILURE;
+        }
+        strcpy(outputfile_name, objectfile_name);
+        extension = strrchr(outputfile_name, '.');
+        if(extension == NULL || strchr(extension, '/') != NULL)
+                extension = outputfile_name + strlen(outputfile_name);
+        strcpy(extension, ".hex");
+
+        outputfile_handle = fopen(outputfile_name, "w+");
+        if(outputfile_handle == NULL) {
+                STDERR("the output file created failed\n");
+                EFAILURE;
+        }
+        begin_tracespan("hex serialization", "output");
+        status = write_hexfile(&outputimage, outputfile_handle);
+        fclose(outputfile_handle);
+        end_tracespan("hex serialization", "output");
+        if(status == ERROR) {
+                STDERR("the output file could not be written\n");
+                EFAILURE;
+        }
+
+        if(close_sourcemap(symboltable_list, symboltable_currentsize) == ERROR) {
+                STDERR("the source map (%s) could not be written\n", sourcemap_name);
+                EFAILURE;
+        }
+        if(dependfile_name != NULL)
+                write_dependfile(dependfile_name, outputfile_name);
+        if(export_flag)
+                export_symbols(outputfile_name, symboltable_currentsize);
+
+        if(map_format != REPORT_NONE)
+                report_memorymap(stdout, map_format);
+
+        free(outputfile_name);
+        free_outputimage(&outputimage);
+        free_symboltable(&symboltable_list);
+        free_expressions();
+        free_sections();
+        free_links();
+        free_symbolfiles();
+        free_sourcefiles();
+        free_interntable();
+        free_arena(&arena);
+}
+
+/* Releases everything taken to assemble a source, on every way out of main(). */
+static void release_resources(atom_t **symbolstracked_list, arena_t *arena) {
+        free_symboltable(&symboltable_list);
+        free_symbolstracked(symbolstracked_list);
+        free_instructionatoms();
+        free_expressions();
+        free_sections();
+        free_banks();
+        free_objects();
+        free_symbolfiles();
+        free_pagetables();
+        free_repeats();
+        free_conditionals();
+        free_macros();
+        free_sourcefiles();
+        free_interntable();
+        free_arena(arena);
+}
+
 int main(int argc, char **argv) {
-        FILE *sourcefile_handle;
-        char *sourcefile_name, buffer[20];
+        tokenstream_t tokenstream;
+        char *sourcefile_name = NULL, *tracefile_name = NULL, *sourcemap_name = NULL;
+        char *dependfile_name = NULL;
         int c;
         unsigned char index;
-        enum flag_t {NOT_SET = 0, SET} s_flag, err_flag;
+        enum flag_t {NOT_SET = 0, SET} s_flag, err_flag, overlap_flag, c_flag,
+                x_flag;
+        report_format_t mix_format = REPORT_NONE, stats_format = REPORT_NONE;
+        report_format_t map_format = REPORT_NONE;
         word_type_t type;
-        uint8_t symboltable_currentsize = 0, symboltable_actualsize = 0;
+        uint32_t symboltable_currentsize = 0, symboltable_actualsize = 0;
         int16_t mainindex, subindex;
         
         line_status_t line_status;
@@ -49,28 +253,82 @@ int main(int argc, char **argv) {
         program_status_t program_status;
         status_t status;
         uint16_t location_counter = 0;
-        char **symbolstracked_list = NULL;
-        uint8_t symbolstracked_currentsize = 0, symbolstracked_actualsize = 0;
+        atom_t *symbolstracked_list = NULL;
+        atom_t atom;
+        tokenrange_t word;
+        uint32_t symbolstracked_currentsize = 0, symbolstracked_actualsize = 0;
+        arena_t arena;
 
         FILE *outputfile_handle;
         char *outputfile_name;
-        char dir_arg[20];
-        uint16_t current_address = 0, beginning_address = 0, previous_address = 0;
-        enum address_status_t {NOT_INITIALIZED = 0, INITIALIZED} address_status;
+        tokenrange_t dir_arg;
+        uint16_t current_address = 0;
+        outputimage_t outputimage;
 
-        s_flag = err_flag = NOT_SET;
+        s_flag = err_flag = overlap_flag = c_flag = x_flag = NOT_SET;
 
         if(argc == 1) {
                 STDERR("invalid number of arguments\n");
                 EFAILURE;
         }
 
-        while((c = udgetopt(argc, argv, "s:")) != -1) {
+        while((c = udgetopt_long(argc, argv, "s:m:I:cl:", long_options)) != -1) {
                 switch(c) {
                 case 's':
                         sourcefile_name = optarg;
                         s_flag = SET;
                         break;
+                case 'm':
+                        mix_format = get_reportformat(optarg);
+                        if(mix_format == REPORT_NONE)
+                                err_flag = SET;
+                        break;
+                case 'S':
+                        stats_format = get_reportformat(optarg);
+                        if(stats_format == REPORT_NONE)
+                                err_flag = SET;
+                        break;
+                case 'M':
+                        map_format = get_reportformat(optarg);
+                        if(map_format == REPORT_NONE)
+                                err_flag = SET;
+                        break;
+                case 'O':
+                        overlap_flag = SET;
+                        break;
+                case 'c':
+                        c_flag = SET;
+                        break;
+                case 'l':
+                        if(optarg == NULL || add_objectfile(optarg) == ERROR)
+                                err_flag = SET;
+                        break;
+                case 'X':
+                        x_flag = SET;
+                        break;
+                case 'D':
+                        sourcemap_name = optarg;
+                        if(sourcemap_name == NULL)
+                                err_flag = SET;
+                        break;
+                case 'P':
+                        dependfile_name = optarg;
+                        if(dependfile_name == NULL)
+                                err_flag = SET;
+                        break;
+                case 'R':
+                        if(optarg == NULL || add_symbolfile(optarg) == ERROR)
+                                err_flag = SET;
+                        break;
+                case 'T':
+                        tracefile_name = optarg;
+                        if(tracefile_name == NULL)
+                                err_flag = SET;
+                        break;
+                case 'I':
+                        if(optarg == NULL || add_includepath(optarg) == ERROR)
+                                err_flag = SET;
+                        break;
                 case '?':
                         err_flag = SET;
                         break;
@@ -83,37 +341,108 @@ int main(int argc, char **argv) {
                 EFAILURE;
         }
 
-        if(optarg == NULL) {
+        /* A source is assembled, or modules are linked; not both at once. */
+        if(count_objectfiles() > 0) {
+                if(s_flag == SET || c_flag == SET) {
+                        STDERR("--link cannot be given together with a source file\n");
+                        EFAILURE;
+                }
+                if(stats_format != REPORT_NONE)
+                        enable_phasetimers();
+                if(tracefile_name != NULL) {
+                        if(open_trace(tracefile_name) == ERROR) {
+                                STDERR("the trace file (%s) could not be created\n",
+                                       tracefile_name);
+                                EFAILURE;
+                        }
+                        atexit(close_trace);
+                }
+                link_program(map_format, overlap_flag == SET, x_flag == SET,
+                             sourcemap_name, dependfile_name);
+                if(stats_format != REPORT_NONE)
+                        report_stats(stdout, stats_format);
+                ESUCCESS;
+        }
+
+        if(s_flag == NOT_SET || sourcefile_name == NULL) {
                 STDERR("no source file specified\n");
                 EFAILURE;
         }
 
-        /* Open the source file specified on the command-line for reading only. This is
-           the source file that will be parsed and converted into machine code for the
-           Zilog Z80 CPU. */
-        sourcefile_handle = fopen(sourcefile_name, "r");
-        if(sourcefile_handle == NULL) {
-                STDERR("the specified file (%s) could not be opened\n", sourcefile_name);
+        if(stats_format != REPORT_NONE)
+                enable_phasetimers();
+        if(c_flag == SET)
+                enable_objectoutput();
+
+        /* The trace is closed on every exit so that it stays loadable when assembly
+           fails part way through. */
+        if(tracefile_name != NULL) {
+                if(open_trace(tracefile_name) == ERROR) {
+                        STDERR("the trace file (%s) could not be created\n",
+                               tracefile_name);
+                        EFAILURE;
+                }
+                atexit(close_trace);
+        }
+        begin_tracespan(sourcefile_name, "file");
+
+        /* Every name met while assembling is interned, and the spelling of every atom
+           is kept in the arena, which is released in one go together with the symbol
+           table. The mnemonics and the registers are interned first so that they can
+           be recognized by their atom. */
+        init_arena(&arena);
+        if(init_interntable(&arena) == ERROR ||
+           init_instructionatoms(instruction_set) == ERROR || init_lexer() == ERROR ||
+           init_expressions(&arena) == ERROR) {
+                STDERR("the intern table could not be created\n");
                 EFAILURE;
         }
+        init_macros(&arena);
 
+        /* The source file specified on the command-line is read and cut into tokens
+           once; both passes then walk the tokens. */
+        begin_phasetimer(PHASE_LEXING);
+        begin_tracespan("lexing", "pass");
+        if(tokenize_sourcefile(sourcefile_name, &arena, &tokenstream) == ERROR) {
+                STDERR("the specified file (%s) could not be read\n", sourcefile_name);
+                EFAILURE;
+        }
+        end_tracespan("lexing", "pass");
+        end_phasetimer(PHASE_LEXING);
         init_symboltable(&symboltable_list, z80_symbols, &symboltable_currentsize,
                          &symboltable_actualsize);
         if(symboltable_list == NULL) {
                 STDERR("the symbol table could not be created\n");
                 EFAILURE;
         }
+        /* The symbols of other programs are read beneath those of the source. */
+        if(load_symbolfiles(&symboltable_list, &symboltable_currentsize,
+                            &symboltable_actualsize) == ERROR) {
+                STDERR("the symbol files could not be read\n");
+                EFAILURE;
+        }
         
         program_status = CONTINUE_PARSE;
 
-        while(extract_nearestword(sourcefile_handle, buffer, 20,
-                                  &line_status) == CONTINUE_PARSE) {
+        begin_phasetimer(PHASE_PASSONE);
+        begin_tracespan("pass one", "pass");
 
-                type = parse_wordtype(buffer, instruction_set);
+        /* The end of the tokens of an expansion goes back to the line after the one
+           that used the macro. */
+        while(extract_nearestword(&tokenstream, &word, &line_status) == CONTINUE_PARSE ||
+              leave_expansion(&tokenstream, &word, &line_status) == CONTINUE_PARSE) {
+
+                type = parse_wordtype(&word, instruction_set, &atom);
+
+                /* A macro is expanded where the first pass meets it, and the pass goes
+                   on with the first line of the expansion. */
+                if((type == UNKNOWN || type == INSTRUCTION) &&
+                   expand_macro(&tokenstream, atom, &line_status) == VALID)
+                        continue;
                 
                 switch(type) {
                 case INSTRUCTION:
-                        parse_instruction(sourcefile_handle, buffer,
+                        parse_instruction(&tokenstream, atom,
                                           &line_status, instruction_set,
                                           &location_counter, &symboltable_list,
                                           symboltable_currentsize,
@@ -123,12 +452,12 @@ int main(int argc, char **argv) {
 
                         break;
                 case LABEL:
-                        handle_label(buffer, &symboltable_list,
+                        handle_label(atom, &symboltable_list,
                                      location_counter, &symboltable_currentsize,
                                      &symboltable_actualsize);
                         break;
                 case DIRECTIVE:
-                        handle_directive(sourcefile_handle, buffer, &symboltable_list,
+                        handle_directive(&tokenstream, atom, &symboltable_list,
                                          &location_counter, &symboltable_currentsize,
                                          &symboltable_actualsize, &line_status);
                         break;
@@ -138,20 +467,42 @@ int main(int argc, char **argv) {
                         break;
 
                 }
-                goto_nextline(sourcefile_handle, line_status);
+                goto_nextline(&tokenstream, line_status);
         }
 
+        end_conditionals();
+        end_repeats();
+
+        end_tracespan("pass one", "pass");
+        end_phasetimer(PHASE_PASSONE);
+
+        begin_phasetimer(PHASE_VALIDATION);
+        begin_tracespan("symbol validation", "pass");
+        /* The floating sections are placed first, since the addresses of their labels
+           depend on where they go. */
+        place_sections(location_counter, &symboltable_list, &symboltable_currentsize,
+                       &symboltable_actualsize);
         status = validate_symbolstracked(symbolstracked_list, symboltable_list,
                                          symbolstracked_currentsize,
                                          symboltable_currentsize);
+        /* Symbols defined by expressions that referred to later symbols are given
+           their values now that every symbol is known. */
+        if(status == NO_ERROR)
+                status = resolve_deferredsymbols(symboltable_list,
+                                                 symboltable_currentsize);
+        end_tracespan("symbol validation", "pass");
+        end_phasetimer(PHASE_VALIDATION);
         if(status == ERROR) {
-                free_symboltable(&symboltable_list);
-                free(symbolstracked_list);
+                release_resources(&symbolstracked_list, &arena);
                 STDERR("an invalid symbol was found as an operand\n");
                 EFAILURE;
         }
 
-        rewind(sourcefile_handle);
+        /* Every address is known now, so the page tables can be checked before the
+           second pass. */
+        check_pagetables(symboltable_list);
+
+        tokenstream.position = 0;
 
         program_status = CONTINUE_PARSE;
         type = UNKNOWN;
@@ -160,67 +511,143 @@ int main(int argc, char **argv) {
         outputfile_name = malloc((strlen(sourcefile_name) + 3) *
                                  sizeof(*outputfile_name));
         if(outputfile_name == NULL) {
-                free_symboltable(&symboltable_list);
-                free(symbolstracked_list);
+                release_resources(&symbolstracked_list, &arena);
                 STDERR("the output file can not be created\n");
                 EFAILURE;
         }
 
         index = strlen(sourcefile_name) - 1;
         strncpy(outputfile_name, sourcefile_name, index);
-        outputfile_name[index++] = 'h';
-        outputfile_name[index++] = 'e';
-        outputfile_name[index++] = 'x';
-        outputfile_name[index] = '\0';
+        /* A module gives an object file instead of a HEX file. */
+        strcpy(&outputfile_name[index], (c_flag == SET) ? "obj" : "hex");
 
-        outputfile_handle = fopen(outputfile_name, "w+");
-        if(outputfile_handle == NULL) {
-                free_symboltable(&symboltable_list);
-                free(symbolstracked_list);
-                STDERR("the output file created failed\n");
+        init_outputimage(&outputimage);
+
+        if(mix_format != REPORT_NONE &&
+           init_instructionmix(instruction_set) == ERROR) {
+                STDERR("the instruction mix could not be recorded\n");
                 EFAILURE;
         }
 
-        address_status = NOT_INITIALIZED;
+        /* The source map is written line by line as the second pass emits the bytes. */
+        if(sourcemap_name != NULL && open_sourcemap(sourcemap_name) == ERROR) {
+                STDERR("the source map (%s) could not be created\n", sourcemap_name);
+                EFAILURE;
+        }
+
+        begin_phasetimer(PHASE_PASSTWO);
+        begin_tracespan("pass two", "pass");
         
-        while(extract_nearestword(sourcefile_handle, buffer, 20, &line_status) ==
-              CONTINUE_PARSE) {
-                type = parse_wordtype(buffer, instruction_set);
+        while(extract_nearestword(&tokenstream, &word, &line_status) == CONTINUE_PARSE ||
+              leave_expansion(&tokenstream, &word, &line_status) == CONTINUE_PARSE) {
+                type = parse_wordtype(&word, instruction_set, &atom);
+
+                /* The macro lines are stepped over or into as the first pass did. */
+                if(replay_macro(&tokenstream, &line_status) == VALID)
+                        continue;
 
                 if(type == DIRECTIVE) {
-                        if(!strcmp("ORG", buffer)) {
-                                status = extract_dirarg(sourcefile_handle, 1, &line_status,
-                                                        dir_arg, NULL);
-                                current_address = asciistr_to16bitnum(dir_arg);
-                                if(address_status == NOT_INITIALIZED) {
-                                        previous_address = current_address;
-                                        beginning_address = current_address;
-                                        address_status = INITIALIZED;
-                                }
+                        if(atom == ATOM_ORG) {
+                                status = extract_direxpression(&tokenstream,
+                                                               &line_status, &dir_arg);
+                                evaluate_dirarg(&dir_arg, current_address,
+                                                symboltable_list, &current_address);
                         }
+                        else if(atom >= ATOM_DB && atom <= ATOM_ALIGN) {
+                                assemble_data(&tokenstream, &outputimage, atom,
+                                              symboltable_list, &line_status,
+                                              &current_address);
+                        }
+                        else if(atom >= ATOM_IF && atom <= ATOM_ENDIF)
+                                replay_conditional(&tokenstream, &line_status);
+                        else if(atom == ATOM_REPT || atom == ATOM_ENDR)
+                                replay_repeat(&tokenstream, atom, &outputimage,
+                                              &current_address, &line_status);
+                        else if(atom == ATOM_PAGETABLE || atom == ATOM_EXTERN ||
+                                atom == ATOM_PUBLIC)
+                                extract_direxpression(&tokenstream, &line_status,
+                                                      &dir_arg);
+                        else if(atom >= ATOM_SECTION && atom <= ATOM_PLACE)
+                                replay_section(&tokenstream, atom, &outputimage,
+                                               &current_address, &line_status);
+                        else if(atom == ATOM_BANK)
+                                replay_bank(&tokenstream, &outputimage, &current_address,
+                                            &line_status);
                 }
                 if(type == INSTRUCTION) {
-                        assemble_instruction(sourcefile_handle, outputfile_handle,
-                                             buffer, instruction_set,
+                        assemble_instruction(&tokenstream, &outputimage,
+                                             atom, instruction_set,
                                              symboltable_list, symboltable_currentsize,
-                                             &line_status, &current_address,
-                                             &beginning_address, &previous_address);
+                                             &line_status, &current_address);
                 }
 
-                goto_nextline(sourcefile_handle, line_status);
+                goto_nextline(&tokenstream, line_status);
         }
 
-        finish_outputhexfile(outputfile_handle);
- 
+        end_tracespan("pass two", "pass");
+
+        /* Of bytes emitted twice at the same address only the later would be loaded, so
+           this is an error unless it is asked for. */
+        status = NO_ERROR;
+        if(overlap_flag == NOT_SET && c_flag == NOT_SET)
+                status = check_imageoverlaps(&outputimage);
+        if(status == ERROR) {
+                free_outputimage(&outputimage);
+                STDERR("the program was emitted over itself\n");
+                EFAILURE;
+        }
+
+        /* The output file is created only once the program is known to be good, so that
+           a failed assembly leaves no output file for make to take as up to date. */
+        outputfile_handle = fopen(outputfile_name, (c_flag == SET) ? "wb" : "w+");
+        if(outputfile_handle == NULL) {
+                free_outputimage(&outputimage);
+                release_resources(&symbolstracked_list, &arena);
+                STDERR("the output file created failed\n");
+                EFAILURE;
+        }
+
+        begin_tracespan("hex serialization", "output");
+        if(c_flag == SET)
+                status = write_objectfile(&outputimage, symboltable_list,
+                                          outputfile_handle);
+        else
+                status = write_hexfile(&outputimage, outputfile_handle);
         fclose(outputfile_handle);
-        free(outputfile_name);
-        free_symboltable(&symboltable_list);
-        free(symbolstracked_list);
-        
+        free_outputimage(&outputimage);
+        if(status == ERROR) {
+                STDERR("the output file could not be written\n");
+                EFAILURE;
+        }
+        end_tracespan("hex serialization", "output");
 
-        if((fclose(sourcefile_handle)) == EOF) {
-                STDERR("the source file (%s) could not be closed\n", sourcefile_name);
+        if(close_sourcemap(symboltable_list, symboltable_currentsize) == ERROR) {
+                STDERR("the source map (%s) could not be written\n", sourcemap_name);
                 EFAILURE;
         }
+
+        end_phasetimer(PHASE_PASSTWO);
+        end_tracespan(sourcefile_name, "file");
+
+        if(mix_format != REPORT_NONE) {
+                report_instructionmix(stdout, instruction_set, mix_format);
+                free_instructionmix();
+        }
+
+        if(dependfile_name != NULL)
+                write_dependfile(dependfile_name, outputfile_name);
+        if(x_flag == SET)
+                export_symbols(outputfile_name, symboltable_currentsize);
+
+        if(map_format != REPORT_NONE)
+                report_memorymap(stdout, map_format);
+
+        if(stats_format != REPORT_NONE)
+                report_stats(stdout, stats_format);
+ 
+
+        free(outputfile_name);
+        release_resources(&symbolstracked_list, &arena);
+
         ESUCCESS;
 }